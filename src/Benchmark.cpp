@@ -0,0 +1,136 @@
+/**
+ * The Benchmark class measures the frame time of selected parts of the scene. It is started from
+ * the command line (see main) instead of the interactive loop, renders a fixed view of the meadow
+ * and prints a table of milliseconds per frame. Every frame ends with glFinish, so the numbers
+ * include the GPU work and not only the time to submit the commands. Levels of detail are picked
+ * for that view too, so runs with a different --lod-bias can be compared.
+ */
+
+#include "Benchmark.h"
+#include "CoreRenderer.h"
+#include "InstancedRenderer.h"
+#include "LevelOfDetail.h"
+#include "MatrixStack.h"
+#include "TreeImpostors.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <GL/freeglut.h>
+
+/**
+ * This method compares drawing a forest tree by tree against drawing it with instancing,
+ * for forests from 3 up to 100,000 trees spread over the meadow. Every tree is past the impostor
+ * distance from the benchmark view, so impostors are off for these two columns and timed apart,
+ * as a third column, when they are supported.
+ */
+void Benchmark::forest(Context& context)
+{
+    const int counts[] = { 3, 10, 100, 1000, 10000, 100000 };
+    const float pi = 3.14159265f;
+
+    std::cout << "Forest benchmark (milliseconds per frame)" << std::endl;
+    std::cout << std::setw(10) << "trees" << std::setw(12) << "per-tree" << std::setw(12) << "instanced"
+        << std::setw(12) << "impostors" << std::endl;
+
+    for (int count : counts) {
+        Forest forest(0);
+        std::srand(count);
+        for (int i = 0; i < count; ++i) {
+            const float x = -48.0f + 96.0f * std::rand() / RAND_MAX;
+            const float z = -48.0f + 96.0f * std::rand() / RAND_MAX;
+            const float rotation = 2.0f * pi * std::rand() / RAND_MAX;
+            const float scale = 0.7f + 0.6f * std::rand() / RAND_MAX;
+            const glm::vec3 tint(0.8f + 0.2f * std::rand() / RAND_MAX, 1.0f, 0.8f + 0.2f * std::rand() / RAND_MAX);
+            forest.addTree(x, z, rotation, scale, tint);
+        }
+
+        std::cout << std::setw(10) << count << std::fixed << std::setprecision(3);
+
+        forest.useImpostors = false;
+        forest.instanced = false;
+        std::cout << std::setw(12) << millisecondsPerFrame([&]() {
+            setupView(context);
+            forest.draw();
+        });
+
+        if (InstancedRenderer::available()) {
+            forest.instanced = true;
+            std::cout << std::setw(12) << millisecondsPerFrame([&]() {
+                setupView(context);
+                forest.draw();
+            });
+        }
+        else {
+            std::cout << std::setw(12) << "n/a";
+        }
+
+        if (TreeImpostors::supported()) {
+            forest.useImpostors = true;
+            forest.instanced = InstancedRenderer::available();
+            std::cout << std::setw(12) << millisecondsPerFrame([&]() {
+                setupView(context);
+                forest.draw();
+            });
+        }
+        else {
+            std::cout << std::setw(12) << "n/a";
+        }
+        std::cout << std::endl;
+    }
+}
+
+/**
+ * This helper clears the frame and sets a view over the whole meadow lit by the scene lights,
+ * and starts a level of detail frame for it.
+ */
+void Benchmark::setupView(Context& context)
+{
+    const int width = glutGet(GLUT_WINDOW_WIDTH);
+    const int height = glutGet(GLUT_WINDOW_HEIGHT);
+    glViewport(0, 0, width, height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    MatrixStack projection, view;
+    projection.perspective(40.0f, static_cast<float>(width) / height, 1.0f, 150.0f);
+    view.lookAt(glm::vec3(0.0f, 60.0f, 90.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    projection.apply(GL_PROJECTION);
+    view.apply(GL_MODELVIEW);
+    LevelOfDetail::beginFrame(view.top(), projection.top(), static_cast<float>(height));
+
+    glPushMatrix();
+    context.pointlight.addLight();
+    context.spotlight.addlight();
+    glPopMatrix();
+
+    if (CoreRenderer::active()) {
+        CoreRenderer::beginFrame(view.top(), projection.top(), context.globalAmbient);
+        CoreRenderer::lights(context.pointlight, context.spotlight);
+    }
+}
+
+/**
+ * This helper draws frames until one second has passed (at least 3 and at most 30 frames,
+ * after one warm-up frame) and returns the average time of a frame in milliseconds.
+ */
+double Benchmark::millisecondsPerFrame(const std::function<void()>& drawFrame)
+{
+    typedef std::chrono::steady_clock Clock;
+
+    drawFrame();
+    CoreRenderer::endFrame();
+    glFinish();
+
+    int frames = 0;
+    const Clock::time_point start = Clock::now();
+    double elapsed = 0.0;
+    while (frames < 30 && (frames < 3 || elapsed < 1000.0)) {
+        drawFrame();
+        CoreRenderer::endFrame();
+        glFinish();
+        glutSwapBuffers();
+        ++frames;
+        elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+    return elapsed / frames;
+}
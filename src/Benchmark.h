@@ -0,0 +1,17 @@
+#pragma once
+#include <functional>
+#include "Context.h"
+
+/*
+Benchmark runs headless-style timing loops over parts of the scene and prints the results,
+so performance changes can be compared between builds and machines.
+*/
+class Benchmark
+{
+public:
+	static void forest(Context& context);
+
+private:
+	static void setupView(Context& context);
+	static double millisecondsPerFrame(const std::function<void()>& drawFrame);
+};
@@ -4,6 +4,8 @@
 //
 #include "Camera.h"
 #include <GL/glut.h> 
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 // The constructor initializes a new instance of the Camera class.
 // It sets the camera's initial position and target viewing point using initializer lists.
@@ -14,19 +16,20 @@ Camera::Camera() :camera_position{ 8.0f, 5.0f, 16.0f },
 
 // You can add a method in your Camera class to update the view matrix
 void Camera::UpdateView() {
-	// Assuming up vector is constant and is (0, 1, 0)
-	GLfloat up[3] = {0.0f, 1.0f, 0.0f};
-
-	// set the matrix mode to modelview
+	// set the matrix mode to modelview and load the view matrix
 	glMatrixMode(GL_MODELVIEW);
+	glLoadMatrixf(glm::value_ptr(ViewMatrix()));
+}
 
-	// load identity matrix
-	glLoadIdentity();
+// ViewMatrix computes the view matrix on the CPU, like gluLookAt, from the eye position,
+// the center position and the up direction.
+glm::mat4 Camera::ViewMatrix() const {
+	// Assuming up vector is constant and is (0, 1, 0)
+	const glm::vec3 up(0.0f, 1.0f, 0.0f);
 
-	// gluLookAt sets the matrix based on eye position, center position, and up direction
-	gluLookAt(camera_position[0], camera_position[1], camera_position[2],  // camera position
-			  camera_target[0], camera_target[1], camera_target[2],        // lookat position (the cow)
-			  up[0], up[1], up[2]);                   // up vector
+	return glm::lookAt(glm::vec3(camera_position[0], camera_position[1], camera_position[2]),  // camera position
+		glm::vec3(camera_target[0], camera_target[1], camera_target[2]),                        // lookat position (the cow)
+		up);                                                                                    // up vector
 }
 
 // And also add methods to update camera's position and target
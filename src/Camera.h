@@ -1,5 +1,6 @@
 #pragma once
 #include <GL/freeglut.h>
+#include <glm/glm.hpp>
 
 /*
 The Camera controlling the external view point.
@@ -11,6 +12,7 @@ public:
 	GLfloat camera_position[3];
 	GLfloat camera_target[3];
 	void UpdateView();
+	glm::mat4 ViewMatrix() const;
 	void SetPosition(float x, float y, float z);
 	void SetTarget(float x, float y, float z);
 
@@ -2,12 +2,15 @@
 //
 // This file contains the implementation of the Context class. The Context class serves as a container
 // for all objects that are to be rendered in the scene. It also contains a camera object to capture the scene,
-// and settings like global ambient light and cow view toggle.
+// and settings like global ambient light and cow view toggle, the pacing and scheduling of the display loop,
+// the resolution the scene is drawn at, and the governor choosing the detail of the scene.
+// The static objects are also baked into a StaticBatch, which draws them grouped by material.
 // The contained objects include a ground plane, a cow, a point light, a spotlight, a fence, a forest, a farmhouse,
-// a lake, and a wheat field. All of these objects have their respective classes and functionalities.
+// a lake, and a wheat field, plus any number of local lights for the night scene. All of these objects have their respective classes and functionalities.
 //
 // Includes the necessary header files for scene objects and OpenGL.
 #pragma once
+#include <GL/glew.h>
 #include <vector>
 #include "Cow.h"
 #include "Ground.h"
@@ -18,7 +21,20 @@
 #include "Forest.h"
 #include "Farmhouse.h"
 #include "Wheat.h"
+#include "WheatField.h"
 #include "Lake.h"
+#include "StaticBatch.h"
+#include "ImmediateBatch.h"
+#include "RenderQueue.h"
+#include "MatrixStack.h"
+#include "SceneCulling.h"
+#include "LightManager.h"
+#include "NightLights.h"
+#include "ShadowMap.h"
+#include "FramePacer.h"
+#include "RedrawScheduler.h"
+#include "DynamicResolution.h"
+#include "QualityGovernor.h"
 
 /*
 Context class - container for all objects in the scene.
@@ -28,6 +44,9 @@ public:
 	GLfloat globalAmbient = 0.3f; // Global ambient light intensity
 	int isCowView = 0; // Flag to check if the camera is in cow's perspective
 	Camera camera; // Camera object to capture the scene
+	MatrixStack projection; // Projection matrix of the current frame, computed on the CPU
+	float farPlane = 150.0f; // Distance of the far clipping plane of the projection
+	MatrixStack view; // View matrix of the current frame, computed on the CPU
 	Ground ground; // Ground object represents the terrain
 	Cow cow; // Cow object 
 	PointLight pointlight; // Point light source in the scene
@@ -37,4 +56,19 @@ public:
 	Farmhouse farmhouse; // Farmhouse object
 	Lake lake; // Lake object
 	std::vector<Wheat> wheatField; // Vector of Wheat objects representing a field of wheat
+	WheatField wheatCrop{ glm::vec2(-50.0f), glm::vec2(50.0f) }; // Wheat field generated on the GPU
+	bool gpuWheat = true; // Flag to draw wheatCrop instead of the wheatField stalks when supported
+	StaticBatch staticScene; // Ground, farmhouse and lake baked into vertex buffers
+	bool staticBatching = true; // Flag to draw the static objects from staticScene instead of one by one
+	ImmediateBatch immediateBatch; // Records immediate-mode style drawing and flushes it as vertex arrays
+	RenderQueue renderQueue; // Collects the draw items of a frame and draws them sorted
+	SceneCulling culling; // Bounding boxes of the objects and their visibility in the current frame
+	LightManager lights; // Local point and spot lights, binned into view-space clusters every frame
+	NightLights nightLights; // Lanterns along the fence and fireflies over the lake
+	bool night = false; // Flag to light the scene with nightLights as well
+	ShadowMap shadows; // Depth of the scene seen from the spotlight, with the static casters cached
+	FramePacer framePacer; // Vertical sync, frames in flight and frame rate cap of the display loop
+	RedrawScheduler redraw; // Decides whether the next frame is drawn at once, later or only after a change
+	DynamicResolution resolution; // Offscreen target of the scene, scaled to keep its GPU time within a budget
+	QualityGovernor quality; // Scene detail preset, chosen from the frame times or pinned
 };
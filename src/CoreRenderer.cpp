@@ -0,0 +1,466 @@
+/**
+ * The CoreRenderer class is the shader-based backend of the scene. It needs nothing of the
+ * fixed-function pipeline: matrices, lights and the global ambient light go to the Frame uniform
+ * block (binding point 0) when they change, the model matrix and material of each draw to the Draw
+ * block (binding point 1), and meshes are read through their vertex array objects by a single
+ * GLSL 3.30 program. Both blocks are written into a StreamBuffer and bound as ranges of it, so a
+ * draw costs one memcpy and one glBindBufferRange instead of a series of glUniform calls.
+ *
+ * The program reproduces the lighting of the fixed-function path per pixel: the global ambient term
+ * (on a separate ambient color when the caller gives one) plus, per enabled light, a Lambert diffuse
+ * and a Blinn-Phong specular term for a local viewer, with the spotlight cone and exponent of
+ * GL_LIGHT1. Painted meshes take their ambient and diffuse color from the vertex colors (like
+ * GL_COLOR_MATERIAL), and instanced meshes read the InstanceBuffer attributes like
+ * InstancedRenderer does, including its screen-door fade-out with the distance.
+ *
+ * The local lights of a LightManager are added on top: the fragment shader finds the pixel's
+ * cluster from its window position and eye depth, and loops over that cluster's lights only. They
+ * fade out smoothly to nothing at their radius, so lights missing from a cluster add nothing there.
+ *
+ * The spotlight term is scaled by the light's visibility from the ShadowMap: four filtered depth
+ * comparisons around the pixel's position in the map, half a texel apart, for soft edges.
+ */
+
+#include "CoreRenderer.h"
+#include "GLState.h"
+#include "PointLight.h"
+#include "Spotlight.h"
+#include "LightManager.h"
+#include "ShadowMap.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+bool CoreRenderer::enabled = false;
+CoreRenderer::FrameUniforms CoreRenderer::frame;
+glm::vec2 CoreRenderer::fade_out(0.0f);
+bool CoreRenderer::frame_dirty = true;
+unsigned int CoreRenderer::frame_generation = 0;
+
+static const char* const uniform_blocks = R"(
+layout(std140) uniform Frame {
+    mat4 view;
+    mat4 projection;
+    vec4 globalAmbient;
+    vec4 lightPosition[2];
+    vec4 lightColor[2];
+    vec4 spotDirection[2];
+    vec4 lightParameters[2];
+    vec4 clusterScale;
+    ivec4 clusterGrid;
+    mat4 shadowMatrix;
+    vec4 shadowParameters;
+};
+
+layout(std140) uniform Draw {
+    mat4 model;
+    mat4 normalMatrix; // Inverse transpose of view * model, in the upper 3 x 3
+    vec4 ambient;
+    vec4 ambientDiffuse;
+    vec4 specular;
+    vec4 drawParameters; // x: shininess, y: instanced, z: vertex colors, w: lit
+    vec4 fadeOut; // x: distance where instances start to fade out, y: 1 / fade length, 0 for no fade
+};
+)";
+
+static const char* const vertex_body = R"(
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+layout(location = 2) in vec4 color;
+layout(location = 5) in vec4 instancePositionRotation;
+layout(location = 6) in vec4 instanceScale;
+layout(location = 7) in vec4 instanceTint;
+
+out vec3 eyePosition;
+out vec3 eyeNormal;
+out vec4 albedo;
+out vec4 ambientAlbedo;
+out float meshAlpha;
+
+vec3 rotateY(vec3 v, float c, float s)
+{
+    return vec3(c * v.x + s * v.z, v.y, -s * v.x + c * v.z);
+}
+
+void main()
+{
+    bool instanced = drawParameters.y != 0.0;
+    bool vertexColors = drawParameters.z != 0.0;
+    vec3 objectPosition = position;
+    vec3 objectNormal = normal;
+    albedo = vertexColors ? color : ambientDiffuse;
+    ambientAlbedo = vertexColors ? color : ambient;
+    if (instanced) {
+        float c = cos(instancePositionRotation.w);
+        float s = sin(instancePositionRotation.w);
+        objectPosition = rotateY(position * instanceScale.xyz, c, s) + instancePositionRotation.xyz;
+        objectNormal = rotateY(normal / instanceScale.xyz, c, s);
+        albedo *= instanceTint;
+        ambientAlbedo *= instanceTint;
+    }
+    meshAlpha = 1.0;
+    if (instanced && fadeOut.y > 0.0) {
+        float distance = length((view * model * vec4(instancePositionRotation.xyz, 1.0)).xyz);
+        meshAlpha = 1.0 - clamp((distance - fadeOut.x) * fadeOut.y, 0.0, 1.0);
+    }
+
+    vec4 eye = view * model * vec4(objectPosition, 1.0);
+    eyePosition = eye.xyz;
+    eyeNormal = mat3(normalMatrix) * objectNormal;
+    gl_Position = projection * eye;
+}
+)";
+
+static const char* const fragment_body = R"(
+uniform usamplerBuffer clusterRanges;
+uniform usamplerBuffer clusterLights;
+uniform samplerBuffer lightData;
+uniform sampler2DShadow shadowMap;
+
+in vec3 eyePosition;
+in vec3 eyeNormal;
+in vec4 albedo;
+in vec4 ambientAlbedo;
+in float meshAlpha;
+out vec4 fragmentColor;
+
+// Diffuse and specular light from a light of the given color in direction toLight
+vec4 shade(vec3 normal, vec3 toLight, vec3 toViewer, vec4 color)
+{
+    float diffuseFactor = max(dot(normal, toLight), 0.0);
+    vec4 term = color * albedo * diffuseFactor;
+    if (diffuseFactor > 0.0) {
+        float highlight = max(dot(normal, normalize(toLight + toViewer)), 0.0);
+        float shininess = drawParameters.x;
+        term += color * specular * (shininess > 0.0 ? pow(highlight, shininess) : 1.0);
+    }
+    return term;
+}
+
+// Spotlight attenuation for a cone with the given cos(cutoff), or 1 when cosCutoff is -2
+float spot(vec3 toLight, vec3 direction, float cosCutoff, float exponent)
+{
+    if (cosCutoff < -1.5)
+        return 1.0;
+    float spotCos = dot(-toLight, normalize(direction));
+    return spotCos < cosCutoff ? 0.0 : pow(spotCos, exponent);
+}
+
+// Fraction of the spotlight reaching this pixel past the shadow casters
+float spotVisibility()
+{
+    if (shadowParameters.x == 0.0)
+        return 1.0;
+    vec4 coordinates = shadowMatrix * vec4(eyePosition, 1.0);
+    if (coordinates.w <= 0.0)
+        return 1.0;
+    vec3 position = coordinates.xyz / coordinates.w;
+    float offset = 0.5 * shadowParameters.y;
+    return 0.25 * (texture(shadowMap, position + vec3(-offset, -offset, 0.0)) + texture(shadowMap, position + vec3(offset, -offset, 0.0))
+        + texture(shadowMap, position + vec3(-offset, offset, 0.0)) + texture(shadowMap, position + vec3(offset, offset, 0.0)));
+}
+
+void main()
+{
+    if (meshAlpha < 1.0 && screenDoor(gl_FragCoord.xy) >= meshAlpha)
+        discard;
+    if (drawParameters.w == 0.0) {
+        fragmentColor = albedo;
+        return;
+    }
+
+    vec3 normal = normalize(eyeNormal);
+    vec3 toViewer = normalize(-eyePosition);
+    vec4 color = globalAmbient * ambientAlbedo;
+    for (int i = 0; i < 2; ++i) {
+        if (lightParameters[i].y == 0.0)
+            continue;
+        vec3 toLight = lightPosition[i].xyz - eyePosition;
+        toLight = normalize(lightPosition[i].w != 0.0 ? toLight : lightPosition[i].xyz);
+
+        float attenuation = spot(toLight, spotDirection[i].xyz, spotDirection[i].w, lightParameters[i].x);
+        if (i == 1 && attenuation > 0.0)
+            attenuation *= spotVisibility();
+        color += attenuation * shade(normal, toLight, toViewer, lightColor[i]);
+    }
+
+    if (clusterGrid.w != 0) {
+        float slice = max(log(-eyePosition.z) * clusterScale.z + clusterScale.w, 0.0);
+        ivec3 cell = min(ivec3(vec3(gl_FragCoord.xy * clusterScale.xy, slice)), clusterGrid.xyz - 1);
+        uvec2 range = texelFetch(clusterRanges, (cell.z * clusterGrid.y + cell.y) * clusterGrid.x + cell.x).xy;
+        for (uint i = 0u; i < range.y; ++i) {
+            int light = 3 * int(texelFetch(clusterLights, int(range.x + i)).r);
+            vec4 positionRadius = texelFetch(lightData, light);
+            vec4 colorExponent = texelFetch(lightData, light + 1);
+            vec4 directionCutoff = texelFetch(lightData, light + 2);
+            vec3 toLight = positionRadius.xyz - eyePosition;
+            float lightDistance = length(toLight);
+            if (lightDistance >= positionRadius.w)
+                continue;
+            toLight /= lightDistance;
+            float fade = lightDistance / positionRadius.w;
+            fade = 1.0 - fade * fade;
+            float attenuation = fade * fade * spot(toLight, directionCutoff.xyz, directionCutoff.w, colorExponent.w);
+            color += attenuation * shade(normal, toLight, toViewer, vec4(colorExponent.rgb, 1.0));
+        }
+    }
+    fragmentColor = vec4(clamp(color.rgb, 0.0, 1.0), albedo.a);
+}
+)";
+
+/**
+ * This method tells whether the OpenGL context offers the 3.3 API the renderer is built on.
+ */
+bool CoreRenderer::supported()
+{
+    return GLEW_VERSION_3_3 != 0;
+}
+
+/**
+ * This method tells whether the renderer can draw, which also needs its program to build.
+ */
+bool CoreRenderer::available()
+{
+    return supported() && program().valid();
+}
+
+/**
+ * This method stores the matrices and the global ambient light of the frame.
+ */
+void CoreRenderer::beginFrame(const glm::mat4& view, const glm::mat4& projection, GLfloat global_ambient)
+{
+    frame.view = view;
+    frame.projection = projection;
+    frame.global_ambient = glm::vec4(global_ambient, global_ambient, global_ambient, 1.0f);
+    frame.light_parameters[0].y = frame.light_parameters[1].y = 0.0f;
+    frame.cluster_grid.w = 0;
+    frame.shadow_parameters.x = 0.0f;
+    frame_dirty = true;
+}
+
+/**
+ * This method stores the two lights of the scene, as GL_LIGHT0 and GL_LIGHT1. drawScene() sets
+ * each fixed-function light while the modelview matrix is translated to the light's position,
+ * so that translation is applied here as well, to light the scene the same way on both paths.
+ */
+void CoreRenderer::lights(const PointLight& point, const SpotLight& spot)
+{
+    const GLenum names[2] = { GL_LIGHT0, GL_LIGHT1 };
+    const GLfloat* positions[2] = { point.position, spot.position };
+    const GLfloat* colors[2] = { point.color, spot.color };
+
+    for (int i = 0; i < 2; ++i) {
+        const glm::vec3 origin(positions[i][0], positions[i][1], positions[i][2]);
+        const glm::mat4 modelview = glm::translate(frame.view, origin);
+        frame.light_position[i] = modelview * glm::vec4(origin, positions[i][3]);
+        frame.light_color[i] = glm::vec4(colors[i][0], colors[i][1], colors[i][2], 1.0f);
+        frame.spot_direction[i] = glm::vec4(0.0f, 0.0f, -1.0f, -2.0f);
+        frame.light_parameters[i] = glm::vec4(0.0f, GLState::isEnabled(names[i]) ? 1.0f : 0.0f, 0.0f, 0.0f);
+    }
+
+    const glm::vec3 direction(spot.target[0] - spot.position[0], spot.target[1] - spot.position[1], spot.target[2] - spot.position[2]);
+    if (spot.cutoff <= 90.0f)
+        frame.spot_direction[1] = glm::vec4(glm::mat3(frame.view) * direction, std::cos(glm::radians(spot.cutoff)));
+    frame.light_parameters[1].x = spot.exponent;
+    frame_dirty = true;
+}
+
+/**
+ * This method lights the frame with the local lights of the manager as well. Their clusters must
+ * have been updated for this frame's view. The cluster lists are bound to texture units 1 to 3.
+ */
+void CoreRenderer::clusters(const LightManager& lights)
+{
+    frame.cluster_scale = lights.clusterScale();
+    frame.cluster_grid = glm::ivec4(LightManager::tiles_x, LightManager::tiles_y, LightManager::slices,
+        lights.size() > 0 && LightManager::supported() ? 1 : 0);
+    lights.bind(1);
+    frame_dirty = true;
+}
+
+/**
+ * This method lets the spotlight cast the shadows of the map, or none when map is null. It must
+ * come after beginFrame(), as the map is read from eye coordinates. The map is bound to texture
+ * unit 4, and unbound when map is null.
+ */
+void CoreRenderer::shadow(const ShadowMap* map)
+{
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, map ? map->texture() : 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    frame.shadow_parameters = glm::vec4(map ? 1.0f : 0.0f, 1.0f / ShadowMap::size, 0.0f, 0.0f);
+    if (map) {
+        const glm::mat4 bias = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)) * glm::scale(glm::mat4(1.0f), glm::vec3(0.5f));
+        frame.shadow_matrix = bias * map->matrix() * glm::inverse(frame.view);
+    }
+    frame_dirty = true;
+}
+
+/**
+ * This method draws a whole mesh with the given model matrix and material. An ambient color
+ * different from the material's ambient and diffuse color may be given.
+ */
+void CoreRenderer::draw(const Mesh& mesh, const glm::mat4& model, const Material& material, const GLfloat* ambient)
+{
+    const MeshBuffer& buffer = mesh.buffers();
+    prepare(model, material, ambient, buffer.hasColors(), true, false);
+    buffer.bindVertexArray();
+    glDrawElements(GL_TRIANGLES, buffer.indexCount(), GL_UNSIGNED_INT, nullptr);
+    buffer.unbindVertexArray();
+}
+
+/**
+ * This method draws count indices of a mesh buffer, starting at first.
+ */
+void CoreRenderer::draw(const MeshBuffer& buffer, GLenum mode, GLsizei first, GLsizei count, const glm::mat4& model, const Material& material)
+{
+    prepare(model, material, nullptr, buffer.hasColors(), true, false);
+    buffer.bindVertexArray();
+    glDrawElements(mode, count, GL_UNSIGNED_INT, reinterpret_cast<const GLvoid*>(first * sizeof(GLuint)));
+    buffer.unbindVertexArray();
+}
+
+/**
+ * This method draws a mesh in a single color, without lighting (like the light gizmos).
+ */
+void CoreRenderer::drawUnlit(const Mesh& mesh, const glm::mat4& model, const GLfloat* color)
+{
+    const Material flat = { { color[0], color[1], color[2], 1.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, 0.0f, false };
+    const MeshBuffer& buffer = mesh.buffers();
+    prepare(model, flat, nullptr, false, false, false);
+    buffer.bindVertexArray();
+    glDrawElements(GL_TRIANGLES, buffer.indexCount(), GL_UNSIGNED_INT, nullptr);
+    buffer.unbindVertexArray();
+}
+
+/**
+ * This method uploads the changed instances and draws the mesh once per instance in the
+ * range [first, first + count).
+ */
+void CoreRenderer::drawInstanced(const Mesh& mesh, InstanceBuffer& instances, size_t first, size_t count, const Material& material)
+{
+    if (count == 0)
+        return;
+
+    const MeshBuffer& buffer = mesh.buffers();
+    prepare(glm::mat4(1.0f), material, nullptr, buffer.hasColors(), true, true);
+    instances.sync();
+    buffer.bindVertexArray();
+    instances.bind(first);
+    glDrawElementsInstanced(GL_TRIANGLES, buffer.indexCount(), GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(count));
+    instances.unbind();
+    buffer.unbindVertexArray();
+}
+
+/**
+ * This method draws painted, instanced meshes with a single glMultiDrawElementsIndirect call:
+ * draw_count DrawElementsIndirectCommands read from the commands buffer, with the vertex and
+ * instance attributes of the given vertex array object (see GpuCulling).
+ */
+void CoreRenderer::drawIndirect(GLuint vertex_array, GLuint commands, GLsizei draw_count, const Material& material)
+{
+    if (draw_count == 0)
+        return;
+
+    prepare(glm::mat4(1.0f), material, nullptr, true, true, true);
+    glBindVertexArray(vertex_array);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commands);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, draw_count, 0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+/**
+ * This method fades the instances of the following instanced draws out with a screen-door dither,
+ * from fully drawn at 'start' from the eye to gone at 'start + length', until end().
+ */
+void CoreRenderer::fadeOut(float start, float length)
+{
+    fade_out = glm::vec2(start, 1.0f / std::max(length, 0.01f));
+}
+
+/**
+ * This method returns to the fixed-function pipeline for the objects drawn next, and ends the
+ * fade-out of instances.
+ */
+void CoreRenderer::end()
+{
+    fade_out = glm::vec2(0.0f);
+    ShaderProgram::useFixedFunction();
+}
+
+/**
+ * This method ends the frame in the stream buffer, so the next frame writes into another region.
+ */
+void CoreRenderer::endFrame()
+{
+    stream().endFrame();
+}
+
+/**
+ * This method returns the ring buffer the uniform blocks are streamed through, 1 MB per frame.
+ */
+StreamBuffer& CoreRenderer::stream()
+{
+    static StreamBuffer buffer(GL_UNIFORM_BUFFER, 1 << 20);
+    return buffer;
+}
+
+/**
+ * This helper makes the program current and writes the uniform blocks of one draw into the
+ * stream buffer: the frame block only when it changed or the buffer moved on to a new region
+ * (which an orphaned buffer does not keep), the draw block every time. Each block is bound as a
+ * range of the stream buffer.
+ */
+void CoreRenderer::prepare(const glm::mat4& model, const Material& material, const GLfloat* ambient, bool vertex_colors, bool lit, bool instanced)
+{
+    program().use();
+    StreamBuffer& buffer = stream();
+
+    const auto writeFrame = [&buffer]() {
+        const GLintptr offset = buffer.write(&frame, sizeof(FrameUniforms));
+        glBindBufferRange(GL_UNIFORM_BUFFER, 0, buffer.id(), offset, sizeof(FrameUniforms));
+        frame_generation = buffer.generation();
+        frame_dirty = false;
+    };
+    if (frame_dirty || frame_generation != buffer.generation())
+        writeFrame();
+
+    const GLfloat* ambient_color = ambient ? ambient : material.ambient_diffuse;
+    const DrawUniforms draw = { model, glm::mat4(glm::transpose(glm::inverse(glm::mat3(frame.view * model)))),
+        glm::make_vec4(ambient_color), glm::make_vec4(material.ambient_diffuse), glm::make_vec4(material.specular),
+        glm::vec4(material.shininess, instanced ? 1.0f : 0.0f, vertex_colors ? 1.0f : 0.0f, lit ? 1.0f : 0.0f),
+        glm::vec4(fade_out, 0.0f, 0.0f) };
+    const GLintptr offset = buffer.write(&draw, sizeof(DrawUniforms));
+    glBindBufferRange(GL_UNIFORM_BUFFER, 1, buffer.id(), offset, sizeof(DrawUniforms));
+    if (frame_generation != buffer.generation())
+        writeFrame(); // The draw block started a new region, which always has room for the frame block
+}
+
+/**
+ * This helper returns the program, building it on first use, binding its Frame and Draw blocks
+ * to uniform buffer binding points 0 and 1, its cluster samplers to texture units 1 to 3 and its
+ * shadow map to unit 4.
+ */
+ShaderProgram& CoreRenderer::program()
+{
+    static ShaderProgram shader;
+    static bool built = false;
+    if (!built && supported()) {
+        built = true;
+        const std::string vertex_source = std::string("#version 330 core\n") + uniform_blocks + vertex_body;
+        const std::string fragment_source = std::string("#version 330 core\n") + uniform_blocks + ShaderProgram::screenDoor() + fragment_body;
+        if (shader.build(vertex_source.c_str(), fragment_source.c_str())) {
+            glUniformBlockBinding(shader.id(), glGetUniformBlockIndex(shader.id(), "Frame"), 0);
+            glUniformBlockBinding(shader.id(), glGetUniformBlockIndex(shader.id(), "Draw"), 1);
+            shader.use();
+            glUniform1i(shader.uniform("clusterRanges"), 1);
+            glUniform1i(shader.uniform("clusterLights"), 2);
+            glUniform1i(shader.uniform("lightData"), 3);
+            glUniform1i(shader.uniform("shadowMap"), 4);
+        }
+    }
+    return shader;
+}
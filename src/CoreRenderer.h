@@ -0,0 +1,84 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+#include "MeshBuffer.h"
+#include "Material.h"
+#include "InstanceBuffer.h"
+#include "ShaderProgram.h"
+#include "StreamBuffer.h"
+
+class PointLight;
+class SpotLight;
+class LightManager;
+class ShadowMap;
+
+/*
+CoreRenderer draws meshes with the OpenGL 3.3 core API only: vertex array objects, generic vertex
+attributes, GLSL 3.30 programs and uniform blocks for the data of the frame and of each draw,
+streamed through a ring buffer.
+Lighting is computed per pixel with the model of the fixed-function lights set up by PointLight and
+SpotLight, with the spotlight's shadow map, plus the local lights of a LightManager from the pixel's
+cluster. It is chosen at startup; objects without a core path keep drawing with fixed function.
+*/
+class CoreRenderer
+{
+public:
+	static bool supported();
+	static bool active() { return enabled && available(); }
+	static bool available();
+
+	static void beginFrame(const glm::mat4& view, const glm::mat4& projection, GLfloat global_ambient);
+	static void lights(const PointLight& point, const SpotLight& spot);
+	static void clusters(const LightManager& lights);
+	static void shadow(const ShadowMap* map);
+
+	static void draw(const Mesh& mesh, const glm::mat4& model, const Material& material, const GLfloat* ambient = nullptr);
+	static void draw(const MeshBuffer& buffer, GLenum mode, GLsizei first, GLsizei count, const glm::mat4& model, const Material& material);
+	static void drawUnlit(const Mesh& mesh, const glm::mat4& model, const GLfloat* color);
+	static void drawInstanced(const Mesh& mesh, InstanceBuffer& instances, size_t first, size_t count, const Material& material);
+	static void drawIndirect(GLuint vertex_array, GLuint commands, GLsizei draw_count, const Material& material);
+	static void fadeOut(float start, float length);
+	static void end();
+	static void endFrame();
+	static StreamBuffer& stream();
+	static glm::mat4 viewProjection() { return frame.projection * frame.view; }
+	static glm::vec3 eye() { return glm::vec3(glm::inverse(frame.view)[3]); }
+
+	static bool enabled; // Set from the command line before the window is created
+
+private:
+	// Per-frame data, laid out like the std140 Frame block of the shaders
+	struct FrameUniforms {
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec4 global_ambient;
+		glm::vec4 light_position[2]; // Eye coordinates
+		glm::vec4 light_color[2]; // Diffuse and specular color
+		glm::vec4 spot_direction[2]; // Eye coordinates, w is the cosine of the cutoff or -2 for no cone
+		glm::vec4 light_parameters[2]; // x: spot exponent, y: 1 when the light is enabled
+		glm::vec4 cluster_scale; // See LightManager::clusterScale()
+		glm::ivec4 cluster_grid; // Tiles in x and y, depth slices, and 1 when there are local lights
+		glm::mat4 shadow_matrix; // Eye coordinates to shadow map coordinates
+		glm::vec4 shadow_parameters; // x: 1 when the spotlight casts shadows, y: shadow map texel size
+	};
+
+	// Per-draw data, laid out like the std140 Draw block of the shaders
+	struct DrawUniforms {
+		glm::mat4 model;
+		glm::mat4 normal_matrix; // Inverse transpose of view * model in the upper 3 x 3
+		glm::vec4 ambient;
+		glm::vec4 ambient_diffuse;
+		glm::vec4 specular;
+		glm::vec4 parameters; // x: shininess, y: instanced, z: vertex colors, w: lit
+		glm::vec4 fade_out; // x: distance where instances start to fade out, y: 1 / fade length, 0 for no fade
+	};
+
+	static ShaderProgram& program();
+	static void prepare(const glm::mat4& model, const Material& material, const GLfloat* ambient, bool vertex_colors, bool lit, bool instanced);
+
+	static FrameUniforms frame;
+	static glm::vec2 fade_out; // Fade-out of the instances until end(), see fadeOut()
+	static bool frame_dirty;
+	static unsigned int frame_generation; // Stream buffer generation the frame block was written in
+};
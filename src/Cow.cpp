@@ -3,6 +3,9 @@
 // properties such as its current position, head and tail orientation, and leg movement.
 
 #include "Cow.h"
+#include "MeshLibrary.h"
+#include "GLState.h"
+#include "CoreRenderer.h"
 #include <GL/freeglut.h>
 #include <iostream>
 
@@ -10,7 +13,8 @@
 // orientation for its head, tail, and legs. Furthermore, the cow's orientation and position
 // can be updated through the updatePosition() method.
 
-Cow::Cow() : head_horizontal_angle(0.0f),
+Cow::Cow() : local_coords(1.0f),
+	head_horizontal_angle(0.0f),
 	head_vertical_angle(10.0f),
 	tail_horizontal_angle(0.0f),
 	tail_vertical_angle(-10.0f),
@@ -19,22 +23,18 @@ Cow::Cow() : head_horizontal_angle(0.0f),
 	legs_angle(0.0f),
 	legs_movement_direction_forward(true),
 	next_move(nullptr),
-	is_moving(false)
+	is_moving(false),
+	lod({ 150.0f, 40.0f })
 {};
 
 // The init() method is used to set up the local coordinates for the cow in the OpenGL scene.
 // It aligns the cow's initial position and orientation according to the scene's setup.
 
 void Cow::init() {
-    GLfloat view_model_matrix[16];
-	glGetFloatv(GL_MODELVIEW_MATRIX, view_model_matrix);
-	glLoadIdentity();
-
-	glRotatef(-90.0f, 0.0f, 1.0f, 0.0f);
-	glTranslatef(-0.5, 3.5f * 0.30f, -2.8f);
-
-	glGetFloatv(GL_MODELVIEW_MATRIX, local_coords);
-	glLoadMatrixf(view_model_matrix);
+	MatrixStack transform;
+	transform.rotate(-90.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+	transform.translate(glm::vec3(-0.5f, 3.5f * 0.30f, -2.8f));
+	local_coords = transform.top();
 }
 
 // The updatePosition(...) updates the position of the cow within the virtual environment. 
@@ -68,151 +68,142 @@ void Cow::update_position(float new_x, float new_y, float new_z) {
 // primitives to represent the different parts of the cow such as head, legs, tail, etc.
 // Each part is transformed to the appropriate position and orientation and then rendered.
 // The material properties and color for each part are also set during rendering.
+// The spheres are tessellated less as the cow gets smaller on screen.
+// The transformations are kept in a MatrixStack relative to the cow, so the same parts can be
+// drawn on the current modelview matrix or, with the CoreRenderer, from local_coords.
+// It does not animate the cow, so the shadow pass draws the same pose as the scene.
 
 void Cow::draw() {
-	
-	update_constant_movement();	
-	glPushMatrix();
-	// in Cow.h
-	constexpr GLfloat color[4] = { 0.92f, 0.814f, 0.382f, 1.0f };
-	constexpr GLfloat white_color[3] = { 1.0f, 1.0f, 1.0f };
-	constexpr GLfloat black_color[3] = { 0.0f, 0.0f, 0.0f };
-	constexpr GLfloat pink_color[3] = { 1.0f, 0.75f, 0.8f };
-
-	glColor4fv(color);
-
-	constexpr GLfloat cow_specular[] = { 0.1f, 0.1f, 0.1f };
-	constexpr GLfloat cow_shininess = 0.1f;
+	constexpr int level_slices[] = { 30, 16, 8 };
+	const int slices = level_slices[lod.select(glm::vec3(local_coords[3]), 1.5f)];
+	const Mesh& sphere = MeshLibrary::sphere(slices, slices);
+
+	constexpr Material white = { { 1.0f, 1.0f, 1.0f, 1.0f }, { 0.1f, 0.1f, 0.1f, 1.0f }, 0.1f, false };
+	constexpr Material black = { { 0.0f, 0.0f, 0.0f, 1.0f }, { 0.1f, 0.1f, 0.1f, 1.0f }, 0.1f, false };
+	constexpr Material pink = { { 1.0f, 0.75f, 0.8f, 1.0f }, { 0.1f, 0.1f, 0.1f, 1.0f }, 0.1f, false };
+	constexpr Material eyes = { { 0.0f, 0.0f, 0.0f, 1.0f }, { 0.4f, 0.4f, 0.4f, 1.0f }, 1.0f, false };
+
+	const bool core = CoreRenderer::active();
+	if (!core) {
+		constexpr GLfloat no_emission[] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		GLState::material(GL_FRONT, GL_EMISSION, no_emission);
+	}
 
-	glMaterialfv(GL_FRONT, GL_SPECULAR, cow_specular);
-	glMaterialf(GL_FRONT, GL_SHININESS, cow_shininess);
-	glMaterialf(GL_FRONT, GL_EMISSION, 0);
-	glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, color);
+	// Draws a part with the transformation on top of the stack
+	MatrixStack transform;
+	auto part = [&](const Mesh& mesh, const Material& material) {
+		if (core)
+			CoreRenderer::draw(mesh, local_coords * transform.top(), material);
+		else
+			mesh.draw(transform.top(), material);
+	};
 
 	// torso
-	glPushMatrix();
-	glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, white_color);
-	glScalef(2.0f * 0.3f, 2.0f * 0.3f, 4.0f * 0.3f);
-	glutSolidSphere(1, 30, 30);
-	glBindTexture(GL_TEXTURE_2D, 0);  // unbind the texture
-	glPopMatrix();
+	transform.push();
+	transform.scale(glm::vec3(2.0f * 0.3f, 2.0f * 0.3f, 4.0f * 0.3f));
+	part(sphere, white);
+	transform.pop();
 
 
 	//legs
-	glPushMatrix();
-	glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, black_color);
-	glRotatef(legs_angle, 1, 0, 0);
-	glTranslated(-1 * 0.3, -2.5 * 0.3, -2 * 0.3);
-	glScalef(0.5f * 0.3f, 2.0f * 0.3f, 0.5f * 0.3f);
-	glutSolidSphere(1, 30, 30);
-	glPopMatrix();
-
-	glPushMatrix();
-	glRotatef(-legs_angle, 1, 0, 0);
-	glTranslated(0.3f, -2.5f * 0.3f, -0.6);
-	glScalef(0.5f * 0.3f, 0.6f, 0.5f * 0.3f);
-	glutSolidSphere(1, 30, 30);
-	glPopMatrix();
-
-	glPushMatrix();
-	glRotatef(legs_angle, 1, 0, 0);
-	glTranslated(0.3f, -2.5f * 0.3f, 2.0 * 0.3f);
-	glScalef(0.5f * 0.3f, 2.0f * 0.3f, 0.5f * 0.3f);
-	glutSolidSphere(1, 30, 30);
-	glPopMatrix();
-
-	glPushMatrix();
-	glRotatef(-legs_angle, 1, 0, 0);
-	glTranslated(-0.3f, -2.5f * 0.3f, 0.6);
-	glScalef(0.5f * 0.3f, 2.0f * 0.3f, 0.5f * 0.3f);
-	glutSolidSphere(1, 30, 30);
-	glPopMatrix();
+	transform.push();
+	transform.rotate(legs_angle, glm::vec3(1, 0, 0));
+	transform.translate(glm::vec3(-1 * 0.3f, -2.5f * 0.3f, -2 * 0.3f));
+	transform.scale(glm::vec3(0.5f * 0.3f, 2.0f * 0.3f, 0.5f * 0.3f));
+	part(sphere, black);
+	transform.pop();
+
+	transform.push();
+	transform.rotate(-legs_angle, glm::vec3(1, 0, 0));
+	transform.translate(glm::vec3(0.3f, -2.5f * 0.3f, -0.6f));
+	transform.scale(glm::vec3(0.5f * 0.3f, 0.6f, 0.5f * 0.3f));
+	part(sphere, black);
+	transform.pop();
+
+	transform.push();
+	transform.rotate(legs_angle, glm::vec3(1, 0, 0));
+	transform.translate(glm::vec3(0.3f, -2.5f * 0.3f, 2.0f * 0.3f));
+	transform.scale(glm::vec3(0.5f * 0.3f, 2.0f * 0.3f, 0.5f * 0.3f));
+	part(sphere, black);
+	transform.pop();
+
+	transform.push();
+	transform.rotate(-legs_angle, glm::vec3(1, 0, 0));
+	transform.translate(glm::vec3(-0.3f, -2.5f * 0.3f, 0.6f));
+	transform.scale(glm::vec3(0.5f * 0.3f, 2.0f * 0.3f, 0.5f * 0.3f));
+	part(sphere, black);
+	transform.pop();
 
 	//tail
-	glPushMatrix();
-	glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, white_color);
-
-	glTranslated(0.0f, 0.0f, -3.8f * 0.3f);
-	glRotatef(-30, 1, 0, 0);
-	glRotatef(tail_vertical_angle, 1, 0, 0);
-	glRotatef(tail_horizontal_angle, 0, 1, 0);
-	glRotatef(tail_wiggle_angle, 0, 1, 0);
-	glScalef(0.3f * 0.3f, 0.3f * 0.3f, 2.5f * 0.3f); // Modify these values as necessary
-
-	glutSolidSphere(1, 30, 30);
+	transform.push();
+	transform.translate(glm::vec3(0.0f, 0.0f, -3.8f * 0.3f));
+	transform.rotate(-30, glm::vec3(1, 0, 0));
+	transform.rotate(tail_vertical_angle, glm::vec3(1, 0, 0));
+	transform.rotate(tail_horizontal_angle, glm::vec3(0, 1, 0));
+	transform.rotate(tail_wiggle_angle, glm::vec3(0, 1, 0));
+	transform.scale(glm::vec3(0.3f * 0.3f, 0.3f * 0.3f, 2.5f * 0.3f)); // Modify these values as necessary
+	part(sphere, white);
 
 	// tail end (black ball)
-	glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, black_color); // set color to black
-	glTranslatef(0.0f, 0.0f, -1.0f); // adjust this as necessary
-	glScalef(1.0f / (0.3f * 0.3f), 1.0f / (0.3f * 0.3f), 1.0f / (2.5f * 0.3f)); // reset the scaling
-	glutSolidSphere(0.2f, 30, 30); // black ball at the end of the tail, adjust size as necessary
-	glPopMatrix();
+	transform.translate(glm::vec3(0.0f, 0.0f, -1.0f)); // adjust this as necessary
+	transform.scale(glm::vec3(1.0f / (0.3f * 0.3f), 1.0f / (0.3f * 0.3f), 1.0f / (2.5f * 0.3f))); // reset the scaling
+	transform.scale(glm::vec3(0.2f)); // black ball at the end of the tail, adjust size as necessary
+	part(sphere, black);
+	transform.pop();
 	
 	//head rotation
-	glPushMatrix();
-	glRotatef(head_vertical_angle, 1, 0, 0);
-	glRotatef(head_horizontal_angle, 0, 1, 0);
+	transform.push();
+	transform.rotate(head_vertical_angle, glm::vec3(1, 0, 0));
+	transform.rotate(head_horizontal_angle, glm::vec3(0, 1, 0));
 
 	//head
-	glPushMatrix();
-	glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, white_color);
-
-	glTranslated(0.0f, 2.5f * 0.3f, 3.0f * 0.3f);
-	glScalef(2.0f * 0.3f, 1.5f * 0.3f, 2.0f * 0.3f); // Made the head longer and wider
-	glutSolidSphere(1, 30, 30);
-	glPopMatrix();
+	transform.push();
+	transform.translate(glm::vec3(0.0f, 2.5f * 0.3f, 3.0f * 0.3f));
+	transform.scale(glm::vec3(2.0f * 0.3f, 1.5f * 0.3f, 2.0f * 0.3f)); // Made the head longer and wider
+	part(sphere, white);
+	transform.pop();
 	
 	//nose
-	glPushMatrix();
-	glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, pink_color);
-
-	glTranslated(0.0f, 2.0f * 0.3f, 4.0f * 0.3f); // Slightly lowered and extended the nose
-	glScalef(1.0f * 0.3f, 0.7f * 0.3f, 2.0f * 0.3f); // Made the nose broader and longer
-	glutSolidSphere(1, 30, 30);
-	glPopMatrix();
+	transform.push();
+	transform.translate(glm::vec3(0.0f, 2.0f * 0.3f, 4.0f * 0.3f)); // Slightly lowered and extended the nose
+	transform.scale(glm::vec3(1.0f * 0.3f, 0.7f * 0.3f, 2.0f * 0.3f)); // Made the nose broader and longer
+	part(sphere, pink);
+	transform.pop();
 	
 	//ears
-	glPushMatrix();
-	glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, black_color);
-	glTranslated(-1.2f * 0.3f, 3.0f * 0.3f, 2.6f * 0.3f); // Positioned the ears more to the side and lower
-	glScalef(0.7f * 0.3f, 0.5f * 0.3f, 0.7f * 0.3f); // Made the ears larger and longer
-	glutSolidSphere(1, 30, 30);
-	glPopMatrix();
-
-	glPushMatrix();
-	glTranslated(1.2f * 0.3f, 3.0f * 0.3f, 2.6f * 0.3f); // Positioned the ears more to the side and lower
-	glScalef(0.7f * 0.3f, 0.5f * 0.3f, 0.7f * 0.3f); // Made the ears larger and longer
-	glutSolidSphere(1, 30, 30);
-	glPopMatrix();
+	transform.push();
+	transform.translate(glm::vec3(-1.2f * 0.3f, 3.0f * 0.3f, 2.6f * 0.3f)); // Positioned the ears more to the side and lower
+	transform.scale(glm::vec3(0.7f * 0.3f, 0.5f * 0.3f, 0.7f * 0.3f)); // Made the ears larger and longer
+	part(sphere, black);
+	transform.pop();
+
+	transform.push();
+	transform.translate(glm::vec3(1.2f * 0.3f, 3.0f * 0.3f, 2.6f * 0.3f)); // Positioned the ears more to the side and lower
+	transform.scale(glm::vec3(0.7f * 0.3f, 0.5f * 0.3f, 0.7f * 0.3f)); // Made the ears larger and longer
+	part(sphere, black);
+	transform.pop();
 	
-	constexpr GLfloat eyes_specular[] = { 0.4f, 0.4f, 0.4f };
-	constexpr GLfloat eyes_shininess = 1.0f;
-
 	//eyes
-	glColor4fv(black_color);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, eyes_specular);
-	glMaterialf(GL_FRONT, GL_SHININESS, eyes_shininess);
-	glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, black_color);
-
-	glPushMatrix();
-	glTranslated(1.5f * 0.3f, 3.0f * 0.3f, 4.4f * 0.3f);
-	glScalef(0.25f * 0.3f, 0.25f * 0.3f, 0.25f * 0.3f);
-	glutSolidCube(1);
-	glPopMatrix();
-
-	glPushMatrix();
-	glTranslated(-1.5f * 0.3f, 3.0f * 0.3f, 4.4f  * 0.3f);
-	glScalef(0.25f * 0.3f, 0.25f * 0.3f, 0.25f * 0.3f);
-	glutSolidCube(1);
-	glPopMatrix();
-
-	glPopMatrix();
-
-	glPopMatrix();
+	transform.push();
+	transform.translate(glm::vec3(1.5f * 0.3f, 3.0f * 0.3f, 4.4f * 0.3f));
+	transform.scale(glm::vec3(0.25f * 0.3f));
+	part(MeshLibrary::cube(), eyes);
+	transform.pop();
+
+	transform.push();
+	transform.translate(glm::vec3(-1.5f * 0.3f, 3.0f * 0.3f, 4.4f * 0.3f));
+	transform.scale(glm::vec3(0.25f * 0.3f));
+	part(MeshLibrary::cube(), eyes);
+	transform.pop();
+
+	transform.pop();
+
+	if (core)
+		CoreRenderer::end();
 }
 
 //The updateConstantMovement() method is used to animate the cow, providing a sense of
-// movement to its tail and legs.
+// movement to its tail and legs. It is called once per frame, before the cow is drawn.
 
 void Cow::update_constant_movement() {
 	if (tail_wiggle_angle > 8 || tail_wiggle_angle < -8)
@@ -1,6 +1,10 @@
 #pragma once
+#include <GL/glew.h>
 #include <GL/freeglut.h>
 #include <functional>
+#include <glm/glm.hpp>
+#include "MatrixStack.h"
+#include "LevelOfDetail.h"
 
 /*
 The Cow object, renders the cow and exposes the cow controls to the ui.
@@ -9,12 +13,12 @@ class Cow
 {
 public:
 	Cow();
-	GLfloat local_coords[16];	//local coordinate system transformation matrix
+	glm::mat4 local_coords;	//local coordinate system transformation matrix
 	GLfloat head_horizontal_angle;
 	GLfloat head_vertical_angle;
 	GLfloat tail_horizontal_angle;
 	GLfloat tail_vertical_angle;
-	std::function<void()> next_move;
+	std::function<void(MatrixStack&)> next_move; // Pending move, applied to a stack holding local_coords
 	void update_position(float new_x, float new_y, float new_z);
 
 	bool is_moving;
@@ -22,13 +26,14 @@ public:
 
 	void init();
 	void draw();
+	//update constant animation for tail wiggle and legs movement, once per frame
+	void update_constant_movement();
+	void setDetail(float detail) { lod.detail = detail; } // Scales the cow's size on screen when picking its tessellation
 	~Cow() = default;
 private:
-	//update constant animation for tail wiggle and legs movement
-	void update_constant_movement();
-
 	GLfloat tail_wiggle_angle;
 	bool tail_wiggle_direction_left;
 	GLfloat legs_angle;
 	bool legs_movement_direction_forward;
+	LevelOfDetail lod; // Picks the tessellation of the body parts from the cow's size on screen
 };
@@ -0,0 +1,223 @@
+/**
+ * The DynamicResolution class implements dynamic resolution scaling of the 3D scene.
+ *
+ * begin() binds a framebuffer of scale times the window's size and sets the viewport to it, and
+ * end() stretches it over the window with a linear filtered blit, so the menu drawn afterwards
+ * stays at the window's full resolution. The window asks for multisampling, so the offscreen target
+ * has as many samples as the window; a multisampled framebuffer can only be blitted at the same
+ * size, so it is first resolved into a single-sampled copy, which is then scaled.
+ *
+ * The scene between begin() and end() is timed with GL_TIME_ELAPSED queries. Their results arrive
+ * a frame or two later, so a small ring of queries is polled without waiting, and a frame whose
+ * query is still busy is simply not measured. Results measured at an earlier scale are dropped, and
+ * the scale is chosen from the median of the last few times rather than their average, so a single
+ * stalled frame does not lower it. The cost of the scene is mostly per pixel, that is proportional
+ * to the square of the scale, so:
+ * - over the budget, the scale drops at once to the one expected to fit;
+ * - under the budget, it grows by one step when the larger scale is expected to stay 10% under the
+ *   budget, which keeps it from flipping between two scales.
+ *
+ * Without timer queries the scale can only be set by hand.
+ */
+
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+DynamicResolution::DynamicResolution() : framebuffers{ 0, 0 }, renderbuffers{ 0, 0, 0 }, samples(0),
+    window_width(0), window_height(0), target_width(0), target_height(0), previous_framebuffer(0),
+    queries{}, query_scale{}, next_query(0), timing(false), history{}, gpu_ms(0.0), measured(0), resize_count(0) {}
+
+DynamicResolution::~DynamicResolution()
+{
+    if (framebuffers[0]) {
+        glDeleteFramebuffers(2, framebuffers);
+        glDeleteRenderbuffers(3, renderbuffers);
+    }
+    if (queries[0])
+        glDeleteQueries(query_count, queries);
+}
+
+/**
+ * This method tells whether the scene can be drawn offscreen and blitted (framebuffer objects).
+ */
+bool DynamicResolution::supported()
+{
+    return GLEW_VERSION_3_0 != 0;
+}
+
+/**
+ * This method tells whether the GPU time can be measured (OpenGL 3.3 or ARB_timer_query).
+ */
+bool DynamicResolution::timerSupported()
+{
+    return GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+}
+
+/**
+ * This method starts the scene: it sets the viewport to the window, or binds the offscreen target
+ * at the current scale, sets the viewport to it and starts timing.
+ */
+void DynamicResolution::begin(int window_width, int window_height)
+{
+    this->window_width = window_width;
+    this->window_height = window_height;
+    if (!active()) {
+        target_width = window_width;
+        target_height = window_height;
+        glViewport(0, 0, window_width, window_height);
+        return;
+    }
+
+    scale = std::min(std::max(scale, minScale), maxScale);
+    const int width = std::max(1, static_cast<int>(std::lround(window_width * scale)));
+    const int height = std::max(1, static_cast<int>(std::lround(window_height * scale)));
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+    if (!framebuffers[0] || width != target_width || height != target_height)
+        resize(width, height);
+    if (!enabled) {
+        begin(window_width, window_height); // The target could not be created
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[0]);
+    glViewport(0, 0, target_width, target_height);
+
+    timing = false;
+    if (timerSupported()) {
+        if (!queries[0])
+            glGenQueries(query_count, queries);
+        if (query_scale[next_query] == 0.0f) {
+            glBeginQuery(GL_TIME_ELAPSED, queries[next_query]);
+            query_scale[next_query] = scale;
+            timing = true;
+        }
+    }
+}
+
+/**
+ * This method ends the scene: it stops timing, scales the offscreen target up to the window and
+ * sets the viewport back to the window for the menu.
+ */
+void DynamicResolution::end()
+{
+    if (!active())
+        return;
+
+    if (timing) {
+        glEndQuery(GL_TIME_ELAPSED);
+        next_query = (next_query + 1) % query_count;
+        timing = false;
+    }
+    measure();
+
+    GLuint source = framebuffers[0];
+    if (samples > 0) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+        glBlitFramebuffer(0, 0, target_width, target_height, 0, 0, target_width, target_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        source = framebuffers[1];
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previous_framebuffer);
+    glBlitFramebuffer(0, 0, target_width, target_height, 0, 0, window_width, window_height, GL_COLOR_BUFFER_BIT,
+        target_width == window_width && target_height == window_height ? GL_NEAREST : GL_LINEAR);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+    glViewport(0, 0, window_width, window_height);
+}
+
+/**
+ * This helper (re)allocates the offscreen target at the given size, with the window's samples.
+ */
+void DynamicResolution::resize(int width, int height)
+{
+    if (!framebuffers[0]) {
+        glGetIntegerv(GL_SAMPLES, &samples); // Of the window, which is bound on the first call
+        GLint max_samples = 0;
+        glGetIntegerv(GL_MAX_SAMPLES, &max_samples);
+        samples = std::min(samples, max_samples);
+        glGenFramebuffers(2, framebuffers);
+        glGenRenderbuffers(3, renderbuffers);
+    }
+    target_width = width;
+    target_height = height;
+    ++resize_count;
+
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[2]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+    const bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[1]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[2]);
+    glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+
+    if (!complete) {
+        std::cout << "Dynamic resolution framebuffer is incomplete, drawing at the window's resolution" << std::endl;
+        enabled = false;
+    }
+}
+
+/**
+ * This helper reads back the timer queries whose results are available, without waiting for the
+ * others.
+ */
+void DynamicResolution::measure()
+{
+    for (int i = 0; i < query_count; ++i) {
+        const int index = (next_query + i) % query_count; // Oldest first
+        if (query_scale[index] == 0.0f)
+            continue;
+        GLint available = 0;
+        glGetQueryObjectiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &nanoseconds);
+        const bool current = query_scale[index] == scale;
+        query_scale[index] = 0.0f;
+        if (current)
+            adjust(nanoseconds / 1.0e6);
+    }
+}
+
+/**
+ * This helper records a GPU time measured at the current scale and, when automatic, picks the
+ * scale for the next frames from the median of the recent times.
+ */
+void DynamicResolution::adjust(double milliseconds)
+{
+    history[measured % history_size] = milliseconds;
+    ++measured;
+    double sorted[history_size];
+    const int count = std::min(measured, static_cast<int>(history_size));
+    std::copy(history, history + count, sorted);
+    std::nth_element(sorted, sorted + count / 2, sorted + count);
+    gpu_ms = sorted[count / 2];
+    if (!automatic || measured < history_size || gpu_ms <= 0.0)
+        return;
+
+    float wanted = scale;
+    if (gpu_ms > budgetMilliseconds) {
+        wanted = std::floor(scale * std::sqrt(static_cast<float>(budgetMilliseconds / gpu_ms)) / step) * step;
+    }
+    else {
+        const float larger = scale + step;
+        if (gpu_ms * (larger * larger) / (scale * scale) < budgetMilliseconds * 0.9f)
+            wanted = larger;
+    }
+    wanted = std::min(std::max(wanted, minScale), maxScale);
+    if (std::abs(wanted - scale) > 0.001f) {
+        scale = wanted;
+        measured = 0;
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <GL/glew.h>
+
+/*
+DynamicResolution renders the 3D scene into an offscreen target smaller than the window and scales
+it up to the window afterwards, before the menu is drawn. The scale follows the GPU time of the
+scene measured with timer queries, so the scene stays within a frame time budget.
+*/
+class DynamicResolution
+{
+public:
+	static constexpr int query_count = 4;
+	static constexpr int history_size = 9; // GPU times the scale is chosen from
+	static constexpr float step = 0.05f; // Scales are multiples of this, so the target is not resized every frame
+
+	DynamicResolution();
+	DynamicResolution(const DynamicResolution&) = delete;
+	DynamicResolution& operator=(const DynamicResolution&) = delete;
+	~DynamicResolution();
+
+	static bool supported();
+	static bool timerSupported();
+	bool active() const { return enabled && supported(); }
+
+	void begin(int window_width, int window_height);
+	void end();
+
+	int width() const { return target_width; }
+	int height() const { return target_height; }
+	double gpuMilliseconds() const { return gpu_ms; }
+	unsigned int resizes() const { return resize_count; }
+
+	bool enabled = false; // Draw the scene offscreen at 'scale' times the window's resolution
+	bool automatic = true; // Let the measured GPU time choose the scale
+	float budgetMilliseconds = 12.0f; // GPU time the scene should fit in
+	float minScale = 0.5f;
+	float maxScale = 1.0f;
+	float scale = 1.0f; // Fraction of the window's width and height rendered
+
+private:
+	void resize(int width, int height);
+	void measure();
+	void adjust(double milliseconds);
+
+	GLuint framebuffers[2]; // Scene target, and its resolved copy when the scene is multisampled
+	GLuint renderbuffers[3]; // Scene color, scene depth and stencil, resolved color
+	GLint samples;
+	int window_width, window_height;
+	int target_width, target_height;
+	GLint previous_framebuffer;
+
+	GLuint queries[query_count]; // Ring of GL_TIME_ELAPSED queries, read back once their results are available
+	float query_scale[query_count]; // Scale each query measured, 0 when the query is free
+	int next_query;
+	bool timing;
+	double history[history_size]; // Last GPU times of the scene at the current scale
+	double gpu_ms; // Median of the history
+	int measured; // Times measured since the scale last changed
+	unsigned int resize_count;
+};
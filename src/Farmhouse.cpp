@@ -3,8 +3,11 @@
 // 
 // Includes necessary headers from the OpenGL library and the Farmhouse class definition header file.
 
-#include <GL/glut.h>
 #include "Farmhouse.h"
+#include "MeshLibrary.h"
+#include "GLState.h"
+#include <GL/glut.h>
+#include <glm/gtc/matrix_transform.hpp>
 
 // This is a member function of the Farmhouse class that is responsible for drawing a 3D representation of a farmhouse.
 // The method sets up the necessary transformations, then draws each part of the farmhouse in turn:
@@ -24,48 +27,88 @@ void Farmhouse::draw() {
 
     // Draw main structure
     GLfloat main_structure_color[] = { 0.8f, 0.8f, 0.5f, 1.0f }; 
-    glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, main_structure_color);
-    glutSolidCube(1.0f);
+    GLState::material(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, main_structure_color);
+    MeshLibrary::solidCube(1.0f);
 
     // Draw roof
     GLfloat roof_color[] = { 0.5f, 0.25f, 0.0f, 1.0f };
-    glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, roof_color);
+    GLState::material(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, roof_color);
     glPushMatrix();
     glTranslatef(0.0f, 0.5f, 0.0f);
     glScalef(1.2f, 0.5f, 1.0f);
-    glutSolidCone(1.0f, 1.0f, 4, 2);
+    MeshLibrary::solidCone(1.0f, 1.0f, 4, 2);
     glPopMatrix();
 
     // Draw chimney
     GLfloat chimney_color[] = { 0.5f, 0.25f, 0.0f, 1.0f };
-    glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, chimney_color);
+    GLState::material(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, chimney_color);
     glPushMatrix();
     glTranslatef(0.35f, 0.4f, 0.0f);
     glScalef(0.1f, 0.4f, 0.2f);
-    glutSolidCube(1.0f);
+    MeshLibrary::solidCube(1.0f);
     glPopMatrix();
 
     // Draw door
     GLfloat door_color[] = { 0.4f, 0.2f, 0.1f, 1.0f };
-    glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, door_color);
+    GLState::material(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, door_color);
     glPushMatrix();
     glTranslatef(0.0f, -0.25f, 0.5f);
     glScalef(0.25f, 0.5f, 0.1f);
-    glutSolidCube(1.0f);
+    MeshLibrary::solidCube(1.0f);
     glPopMatrix();
 
     // Draw windows
     GLfloat windows_color[] = { 0.75f, 0.75f, 0.95f, 1.0f };
-    glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, windows_color);
+    GLState::material(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, windows_color);
     for (int i = -1; i <= 1; i += 2) {
         glPushMatrix();
         glTranslatef(i * 0.4f, 0.2f, 0.5f);
         glScalef(0.2f, 0.2f, 0.1f);
-        glutSolidCube(1.0f);
+        MeshLibrary::solidCube(1.0f);
         glPopMatrix();
     }
 
     glPopMatrix();
 }
 
+// This member function bakes the farmhouse into the static batch. It applies the same transformations
+// as draw(), but on the CPU, so the cubes and the roof cone become plain triangles in the batch.
+// The farmhouse keeps the shiny specular component of the ground, which draw() inherits from it.
+
+void Farmhouse::bake(StaticBatch& batch) const {
+    const glm::mat4 house = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(5.0f, 2.3f, -10.0f)), glm::vec3(5.0f));
+    const GLfloat specular[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    auto material = [&specular](GLfloat r, GLfloat g, GLfloat b) {
+        return Material{ { r, g, b, 1.0f }, { specular[0], specular[1], specular[2], specular[3] }, 128.0f, false };
+    };
+    auto part = [&house](const glm::vec3& offset, const glm::vec3& size) {
+        return glm::scale(glm::translate(house, offset), size);
+    };
+
+    // Main structure
+    batch.group(material(0.8f, 0.8f, 0.5f)).addBox(house);
+
+    // Roof and chimney
+    Geometry& roof = batch.group(material(0.5f, 0.25f, 0.0f));
+    roof.addCone(part(glm::vec3(0.0f, 0.5f, 0.0f), glm::vec3(1.2f, 0.5f, 1.0f)), 1.0f, 1.0f, 4, 2);
+    roof.addBox(part(glm::vec3(0.35f, 0.4f, 0.0f), glm::vec3(0.1f, 0.4f, 0.2f)));
+
+    // Door
+    batch.group(material(0.4f, 0.2f, 0.1f)).addBox(part(glm::vec3(0.0f, -0.25f, 0.5f), glm::vec3(0.25f, 0.5f, 0.1f)));
 
+    // Windows
+    Geometry& windows = batch.group(material(0.75f, 0.75f, 0.95f));
+    for (int i = -1; i <= 1; i += 2)
+        windows.addBox(part(glm::vec3(i * 0.4f, 0.2f, 0.5f), glm::vec3(0.2f, 0.2f, 0.1f)));
+}
+
+// This member function returns a box around the farmhouse: the house is a cube of size 5 centered at
+// (5, 2.3, -10), and the roof and chimney reach up to 5 units above its center and 1 unit past its sides.
+AABB Farmhouse::bounds() const {
+    return AABB{ glm::vec3(-1.0f, -0.2f, -16.0f), glm::vec3(11.0f, 7.3f, -4.0f) };
+}
+
+// This member function returns the solid cube of the house, which hides whatever is behind it.
+AABB Farmhouse::occluder() const {
+    return AABB{ glm::vec3(2.5f, -0.2f, -12.5f), glm::vec3(7.5f, 4.8f, -7.5f) };
+}
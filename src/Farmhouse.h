@@ -1,6 +1,12 @@
 #pragma once
+#include "StaticBatch.h"
+#include "Frustum.h"
+
 class Farmhouse {
 public:
     void draw();
+    void bake(StaticBatch& batch) const;
+    AABB bounds() const;
+    AABB occluder() const;
 };
 
@@ -6,76 +6,222 @@
  * The fence consists of posts and planks which are evenly distributed
  * to form a rectangular fence structure. The fence is brown in color.
  *
- * A Fence object is responsible for providing a method to draw itself,
- * given a list of indexes representing sections of the fence to draw.
+ * The perimeter is described as sections of ten fence segments. The posts and
+ * planks of all sections are placed once into two instance buffers, ordered by
+ * section, so any run of neighbouring sections is a contiguous range of instances.
+ * Each frame only the sections found visible by the scene culling are drawn,
+ * with one instanced call per mesh for every run of visible sections. With
+ * GpuCulling available, every post and plank is culled on the GPU instead.
+ * When local lights are given, each visible section is drawn on its own with the
+ * lights nearest to it.
+ *
+ * The posts are cylinders of postSlices sides; their mesh is built once for every
+ * number of slices used.
  */
 
 #include "Fence.h"
+#include "InstancedRenderer.h"
+#include "LightManager.h"
+#include "Material.h"
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+    const int segments_per_section = 10;
+    const Material brown = { { 0.55f, 0.27f, 0.075f, 1.0f }, { 0.1f, 0.1f, 0.1f, 1.0f }, 10.0f, false };
+}
+
 /**
  * Default Constructor: Fence::Fence()
  *
  * Description:
- * The default constructor initializes a Fence object.
+ * The default constructor lays out the sections of the fence around the meadow,
+ * from -50 to 50 on both axes.
+ */
+Fence::Fence() : culled_slices(0), visible_sections(0) {
+    for (int side = 0; side < 4; ++side) {
+        // Sides 0 and 1 run along the X axis, sides 2 and 3 along the Z axis
+        const bool along_x = side < 2;
+        const float fixed = side % 2 == 0 ? -50.0f : 50.0f;
+
+        for (int from = -50; from < 50; from += segments_per_section)
+            addSection(along_x, fixed, from, from + segments_per_section, from + segments_per_section == 50);
+    }
+}
+
+/**
+ * This method adds the posts and planks of the fence segments [from, to) of one side.
+ * The closing post at 'to' is only added to the last section of the side.
  */
-Fence::Fence() {}
+void Fence::addSection(bool along_x, float fixed, int from, int to, bool last) {
+    Section section;
+    section.first_post = posts.size();
+    section.first_plank = planks.size();
+
+    for (int i = from; i <= to; ++i) {
+        if (i == to && !last)
+            break;
+        const glm::vec3 post = along_x ? glm::vec3(i, 0, fixed) : glm::vec3(fixed, 0, i);
+        posts.add({ { post.x, post.y, post.z }, 0.0f, { 1.0f, 1.0f, 1.0f }, 0.0f, { 1.0f, 1.0f, 1.0f, 1.0f } });
+
+        if (i == to)
+            continue;
+        for (float y = 0.2; y <= 0.8; y += 0.3) {
+            const glm::vec3 plank = along_x ? glm::vec3(i + 0.5f, y, fixed) : glm::vec3(fixed, y, i + 0.5f);
+            const glm::vec3 size = along_x ? glm::vec3(1.0f, 0.1f, 0.05f) : glm::vec3(0.05f, 0.1f, 1.0f);
+            planks.add({ { plank.x, plank.y, plank.z }, 0.0f, { size.x, size.y, size.z }, 0.0f, { 1.0f, 1.0f, 1.0f, 1.0f } });
+        }
+    }
+
+    section.post_count = posts.size() - section.first_post;
+    section.plank_count = planks.size() - section.first_plank;
+
+    // Posts are 0.1 thick and 1 high
+    const glm::vec3 start = along_x ? glm::vec3(from, 0, fixed) : glm::vec3(fixed, 0, from);
+    const glm::vec3 end = along_x ? glm::vec3(to, 1, fixed) : glm::vec3(fixed, 1, to);
+    section.box_min = glm::min(start, end) - glm::vec3(0.1f, 0.0f, 0.1f);
+    section.box_max = glm::max(start, end) + glm::vec3(0.1f, 0.0f, 0.1f);
+    sections.push_back(section);
+}
 
 /**
-* This method draws the sections of the fence as specified by the indices 
-* in the provided list. It uses OpenGL to draw cylinders and cubes for the 
-* posts and planks respectively.
+* This method draws the sections of the fence whose entry in 'visible' is non-zero
+* (or all of them), merging neighbouring visible sections unless each is lit by its
+* own local lights. With GpuCulling all sections are submitted and 'visible' is not used.
 **/
+void Fence::draw(const std::vector<char>* visible, const LightManager* lights) {
+    if (GpuCulling::available()) {
+        drawCulled();
+        visible_sections = sections.size();
+        return;
+    }
+
+    const bool instanced = InstancedRenderer::available();
+
+    if (instanced)
+        InstancedRenderer::begin(brown);
+    else
+        brown.apply();
+
+    visible_sections = 0;
+    size_t run_start = 0;
+    for (size_t i = 0; i <= sections.size(); ++i) {
+        const bool shown = i < sections.size() && (!visible || (i < visible->size() && (*visible)[i]));
+        if (shown)
+            ++visible_sections;
+        if (shown && (!lights || run_start == i))
+            continue;
+        if (run_start < i)
+            drawRun(run_start, i, lights);
+        run_start = shown ? i : i + 1;
+    }
+
+    if (instanced)
+        InstancedRenderer::end();
+}
 
-void Fence::draw(std::vector<int> fenceIndexes) {
-    for (int i : fenceIndexes) {
-        glColor3f(0.55f, 0.27f, 0.075f);  // Brown color for fence
-
-        // Draw the fence posts and planks on each side of the fence
-        for (int side = 0; side < 2; ++side) {
-            // Set the Z value depending on the side of the fence
-            int z = side == 0 ? -50 : 50;
-
-            for (int x = -50; x <= 50; ++x) {
-                // Draw fence posts
-                glPushMatrix();
-                glTranslatef(x, 0, z);
-                glRotatef(-90, 1, 0, 0);
-                glutSolidCylinder(0.1, 1, 20, 20);
-                glPopMatrix();
-
-                // Draw fence planks
-                if (x != 50) {
-                    for (float y = 0.2; y <= 0.8; y += 0.3) {
-                        glPushMatrix();
-                        glTranslatef(x + 0.5, y, z);
-                        glScalef(1, 0.1, 0.05);
-                        glutSolidCube(1);
-                        glPopMatrix();
-                    }
-                }
-            }
+/**
+ * This method draws the sections [first, last), lit by the local lights nearest to them when
+ * given. With instancing these are two draw calls, otherwise every post and plank is drawn on its own.
+ */
+void Fence::drawRun(size_t first, size_t last, const LightManager* lights) {
+    const size_t first_post = sections[first].first_post;
+    const size_t post_count = sections[last - 1].first_post + sections[last - 1].post_count - first_post;
+    const size_t first_plank = sections[first].first_plank;
+    const size_t plank_count = sections[last - 1].first_plank + sections[last - 1].plank_count - first_plank;
+
+    if (lights) {
+        AABB bounds = sectionBounds(first);
+        for (size_t i = first + 1; i < last; ++i) {
+            bounds.min = glm::min(bounds.min, sections[i].box_min);
+            bounds.max = glm::max(bounds.max, sections[i].box_max);
+        }
+        lights->apply(bounds);
+    }
+
+    if (InstancedRenderer::available()) {
+        if (lights)
+            InstancedRenderer::updateLights();
+        InstancedRenderer::draw(postMesh(postSlices), posts, first_post, post_count);
+        InstancedRenderer::draw(plankMesh(), planks, first_plank, plank_count);
+        return;
+    }
+
+    const struct { const Mesh& mesh; const InstanceBuffer& instances; size_t first, count; } parts[] = {
+        { postMesh(postSlices), posts, first_post, post_count },
+        { plankMesh(), planks, first_plank, plank_count },
+    };
+    for (const auto& part : parts) {
+        for (size_t i = part.first; i < part.first + part.count; ++i) {
+            const InstanceData& instance = part.instances.get(i);
+            glPushMatrix();
+            glTranslatef(instance.position[0], instance.position[1], instance.position[2]);
+            glScalef(instance.scale[0], instance.scale[1], instance.scale[2]);
+            part.mesh.draw();
+            glPopMatrix();
         }
+    }
+}
 
-        // Draw the fence posts and planks on the remaining sides
-        for (int side = 0; side < 2; ++side) {
-            int x = side == 0 ? -50 : 50;
-
-            for (int z = -50; z <= 50; ++z) {
-                glPushMatrix();
-                glTranslatef(x, 0, z);
-                glRotatef(-90, 1, 0, 0);
-                glutSolidCylinder(0.1, 1, 20, 20);
-                glPopMatrix();
-
-                if (z != 50) {
-                    for (float y = 0.2; y <= 0.8; y += 0.3) {
-                        glPushMatrix();
-                        glTranslatef(x, y, z + 0.5);
-                        glScalef(0.05, 0.1, 1);
-                        glutSolidCube(1);
-                        glPopMatrix();
-                    }
-                }
-            }
+/**
+ * This method draws the posts and planks through the GpuCulling, which is filled on first use
+ * and again when the posts' number of slices changes.
+ */
+void Fence::drawCulled() {
+    if (culled.size() == 0 || culled_slices != postSlices) {
+        if (culled_posts.empty())
+            culled.addMesh(plankMesh()); // Mesh 0
+        auto post_mesh = culled_posts.find(postSlices);
+        if (post_mesh == culled_posts.end())
+            post_mesh = culled_posts.emplace(postSlices, culled.addMesh(postMesh(postSlices))).first;
+        const glm::uvec4 post_levels(static_cast<glm::uint>(post_mesh->second));
+        const glm::uvec4 plank_levels(0);
+        culled.clear();
+        culled_slices = postSlices;
+        for (size_t i = 0; i < posts.size(); ++i) {
+            const InstanceData& post = posts.get(i);
+            const glm::vec3 position(post.position[0], post.position[1], post.position[2]);
+            culled.add(post, position + glm::vec3(0.0f, 0.5f, 0.0f), glm::length(glm::vec2(0.1f, 0.5f)), post_levels);
         }
+        for (size_t i = 0; i < planks.size(); ++i) {
+            const InstanceData& plank = planks.get(i);
+            const glm::vec3 position(plank.position[0], plank.position[1], plank.position[2]);
+            const glm::vec3 size(plank.scale[0], plank.scale[1], plank.scale[2]);
+            culled.add(plank, position, glm::length(size) * 0.5f, plank_levels);
+        }
+    }
+    culled.draw(brown, std::numeric_limits<float>::max());
+}
+
+/**
+ * This method returns the mesh of a fence post: an upright brown cylinder of radius 0.1 and height 1,
+ * with the given number of slices (at least 3).
+ */
+const Mesh& Fence::postMesh(int slices) {
+    static std::map<int, std::unique_ptr<Mesh>> meshes;
+    slices = std::max(slices, 3);
+    std::unique_ptr<Mesh>& mesh = meshes[slices];
+    if (!mesh) {
+        Geometry geometry;
+        geometry.addCylinder(glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1, 0, 0)), 0.1f, 1.0f, slices, 1);
+        geometry.paint(0, glm::vec4(brown.ambient_diffuse[0], brown.ambient_diffuse[1], brown.ambient_diffuse[2], 1.0f));
+        mesh.reset(new Mesh(geometry));
+    }
+    return *mesh;
+}
+
+/**
+ * This method returns the mesh of a plank: a brown unit cube, sized by the instance scale.
+ */
+const Mesh& Fence::plankMesh() {
+    static std::unique_ptr<Mesh> mesh;
+    if (!mesh) {
+        Geometry geometry;
+        geometry.addBox(glm::mat4(1.0f));
+        geometry.paint(0, glm::vec4(brown.ambient_diffuse[0], brown.ambient_diffuse[1], brown.ambient_diffuse[2], 1.0f));
+        mesh.reset(new Mesh(geometry));
     }
+    return *mesh;
 }
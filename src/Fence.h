@@ -1,9 +1,45 @@
 #pragma once
+#include <map>
 #include <vector>
+#include <glm/glm.hpp>
+#include "InstanceBuffer.h"
+#include "Mesh.h"
+#include "Frustum.h"
+#include "GpuCulling.h"
 #include <GL/freeglut.h>
 
+class LightManager;
+
 class Fence {
 public:
     Fence();
-    void draw(std::vector<int> fenceIndexes);
+    void draw(const std::vector<char>* visible = nullptr, const LightManager* lights = nullptr);
+    size_t sectionCount() const { return sections.size(); }
+    size_t visibleSections() const { return visible_sections; }
+    AABB sectionBounds(size_t section) const { return AABB{ sections[section].box_min, sections[section].box_max }; }
+    size_t postCount() const { return posts.size(); }
+    glm::vec3 postPosition(size_t post) const { return glm::vec3(posts.get(post).position[0], posts.get(post).position[1], posts.get(post).position[2]); }
+
+    int postSlices = 20; // Sides of the cylinder a post is drawn with
+
+private:
+    struct Section {
+        glm::vec3 box_min, box_max; // Bounds of the posts and planks of the section
+        size_t first_post, post_count;
+        size_t first_plank, plank_count;
+    };
+
+    void addSection(bool along_x, float fixed, int from, int to, bool last);
+    void drawRun(size_t first, size_t last, const LightManager* lights);
+    void drawCulled();
+    static const Mesh& postMesh(int slices);
+    static const Mesh& plankMesh();
+
+    std::vector<Section> sections;
+    InstanceBuffer posts;
+    InstanceBuffer planks;
+    GpuCulling culled; // Posts and planks, culled and drawn on the GPU when available
+    std::map<int, size_t> culled_posts; // Mesh index in culled of the post of each number of slices
+    int culled_slices; // Slices of the posts culled was filled with
+    size_t visible_sections;
 };
@@ -5,12 +5,44 @@
 *
 * The Forest class provides functionality to create a forest with a specified 
 * number of trees, or a default of three trees if no number is specified.
+* Trees can be added and removed later on; each tree has a position, a rotation,
+* a scale and a color tint.
+*
+* Trees sharing a template (the same baked mesh) are drawn together with hardware
+* instancing: their placement is kept in an InstanceBuffer, which only uploads the
+* instances that changed since the previous frame.
+*
+* Trees far from the camera are drawn from the template of a lower recursion depth,
+* chosen per tree by its LevelOfDetail, minus droppedLevels more on slow machines. Past
+* impostorDistance they become TreeImpostors quads. Over impostorFade the two cross-fade: the
+* impostor is blended in while the mesh fades out with the complementary opacity, as a screen-door
+* dither (a polygon stipple for trees drawn one by one, a discard in the instancing shaders).
+*
+* With the shader-based renderer and GpuCulling available, the meshes of all trees are
+* culled and given their level of detail by a compute pass instead, and drawn with one
+* indirect call; only the impostors are still chosen on the CPU.
+*
+* Given the local lights, trees drawn one by one are each lit by the lights nearest to them.
+* An instanced batch holds trees from all over the meadow, so it is drawn without local lights,
+* and so are the impostors.
 */
 #include "Forest.h"
+#include "InstancedRenderer.h"
+#include "CoreRenderer.h"
+#include "GLState.h"
+#include "LightManager.h"
 #include <cstdlib>  // For rand() and srand()
 #include <ctime>    // For time()
+#include <algorithm>
+#include <limits>
 #include <GL/glut.h>
 
+// Material of the instanced trees; the mesh colors give the bark and leaves their color
+static constexpr Material bark = { { 1.0f, 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, 0.0f, false };
+
+// Smallest screen sizes in pixels of the levels of detail of a tree
+static const std::vector<float> tree_detail = { 120.0f, 40.0f };
+
 /**
 * The default constructor initializes a Forest object with a default of 3 trees.
 * It initializes a random seed and generates the positions of each tree within the forest.
@@ -26,22 +58,320 @@ Forest::Forest(const int num_trees) {
 
     // Create trees and their positions
     for (int i = 0; i < num_trees; ++i) {
-        trees.push_back(Tree());
-        xPos.push_back(3 + std::rand() % 5);
-        zPos.push_back(-6 + std::rand() % 5);
+        const float x = 3 + std::rand() % 5;
+        const float z = -6 + std::rand() % 5;
+        addTree(x, z);
+    }
+}
+
+/**
+* This method adds a tree of the given template at (x, 0, z), rotated about the Y axis
+* (in radians), uniformly scaled and tinted. It returns the index of the new tree.
+*/
+size_t Forest::addTree(float x, float z, float rotation, float scale, const glm::vec3& tint, int depth) {
+    compacted_selection.clear();
+    culled_dirty = true;
+    ++change_count;
+    Placement placement = { Tree(depth), { { x, 0.0f, z }, rotation, { scale, scale, scale }, 0.0f,
+        { tint.r, tint.g, tint.b, 1.0f } }, 0, LevelOfDetail(tree_detail) };
+    placement.slot = batches[depth].add(placement.instance);
+    owners[depth].push_back(placements.size());
+    placements.push_back(placement);
+    return placements.size() - 1;
+}
+
+/**
+* This method removes the tree with the given index. The last tree takes over the index,
+* and inside the instance buffer only the freed slot has to be uploaded again.
+*/
+void Forest::removeTree(size_t index) {
+    compacted_selection.clear();
+    culled_dirty = true;
+    ++change_count;
+
+    const Placement removed = placements[index];
+    const int depth = removed.tree.depth();
+    std::vector<size_t>& owner = owners[depth];
+
+    // Free the instance slot; the last instance of the buffer moves into it
+    const size_t moved_slot = batches[depth].remove(removed.slot);
+    if (moved_slot != removed.slot) {
+        owner[removed.slot] = owner[moved_slot];
+        placements[owner[removed.slot]].slot = removed.slot;
     }
+    owner.pop_back();
+
+    // Move the last tree into the freed index
+    const size_t last = placements.size() - 1;
+    if (index != last) {
+        placements[index] = placements[last];
+        owners[placements[index].tree.depth()][placements[index].slot] = index;
+    }
+    placements.pop_back();
+}
+
+/**
+* This method returns the bounding box of the tree with the given index in world coordinates.
+*/
+AABB Forest::bounds(size_t index) const {
+    const InstanceData& instance = placements[index].instance;
+    const AABB& local = Tree::bounds(placements[index].tree.depth());
+    const glm::vec3 position(instance.position[0], instance.position[1], instance.position[2]);
+    const glm::vec3 scale(instance.scale[0], instance.scale[1], instance.scale[2]);
+    return AABB{ position + local.min * scale, position + local.max * scale };
+}
+
+/**
+* This method returns the world space box inside the trunk of the tree at the given index.
+*/
+AABB Forest::occluder(size_t index) const {
+    const InstanceData& instance = placements[index].instance;
+    const AABB local = Tree::occluder();
+    const glm::vec3 position(instance.position[0], instance.position[1], instance.position[2]);
+    const glm::vec3 scale(instance.scale[0], instance.scale[1], instance.scale[2]);
+    return AABB{ position + local.min * scale, position + local.max * scale };
 }
 
 /**
 *
-* This method draws all the trees in the forest at their respective positions.
-* It uses OpenGL to handle the transformations and drawing of each Tree object.
+* This method draws the trees in the forest at their respective positions: all of them, or only
+* those whose entry in 'visible' (one per tree index) is non-zero.
+* With instancing, every tree template is drawn with a single call for all of its trees.
+* Otherwise each tree only needs a transformation and a single draw of its baked template mesh.
+* With GpuCulling the GPU does its own frustum test for the meshes, and 'visible' only limits the
+* impostors.
+* The local lights, when given, light the trees drawn one by one.
+*/
+void Forest::draw(const std::vector<char>* visible, const LightManager* lights) {
+    if (useImpostors && !impostors && TreeImpostors::supported())
+        bakeImpostors();
+
+    if (instanced && GpuCulling::available()) {
+        drawCulled(visible);
+    }
+    else if (!instanced || !InstancedRenderer::available()) {
+        select(visible);
+        drawEach(lights);
+    }
+    else {
+        if (lights)
+            lights->release();
+        const bool everything = select(visible);
+        if (!everything && selection != compacted_selection)
+            compact();
+
+        InstancedRenderer::begin(bark);
+        if (fadesOut())
+            InstancedRenderer::fadeOut(impostorDistance * LevelOfDetail::bias, impostorFade);
+        for (auto& batch : everything ? batches : visible_batches)
+            InstancedRenderer::draw(Tree::mesh(batch.first), batch.second);
+        InstancedRenderer::end();
+    }
+
+    // The impostors go last, so the fading ones blend over the meshes they replace
+    if (impostors) {
+        if (lights)
+            lights->release();
+        impostors->begin(LevelOfDetail::eye());
+        for (const auto& far_tree : far_trees)
+            impostors->add(placements[far_tree.first].tree.depth(), placements[far_tree.first].instance, far_tree.second);
+        impostors->end();
+    }
+}
+
+/**
+* This method draws every tree as a full-detail mesh, whatever the camera sees, for the shadow
+* map of the spotlight. It leaves the selection of the frame untouched.
 */
-void Forest::draw() {
-    for (int i = 0; i < trees.size(); ++i) {
+void Forest::drawCasters() {
+    if (!instanced || !InstancedRenderer::available()) {
+        for (const Placement& placement : placements) {
+            const InstanceData& instance = placement.instance;
+            glPushMatrix();
+            glTranslatef(instance.position[0], instance.position[1], instance.position[2]);
+            glRotatef(glm::degrees(instance.rotation), 0.0f, 1.0f, 0.0f);
+            glScalef(instance.scale[0], instance.scale[1], instance.scale[2]);
+            placement.tree.draw();
+            glPopMatrix();
+        }
+        return;
+    }
+
+    InstancedRenderer::begin(bark);
+    for (auto& batch : batches)
+        InstancedRenderer::draw(Tree::mesh(batch.first), batch.second);
+    InstancedRenderer::end();
+}
+
+/**
+* This method renders the views of every tree template of the forest into the impostor atlas.
+* It runs on the first draw, and can be called again after trees of new templates were added.
+*/
+void Forest::bakeImpostors() {
+    std::vector<int> depths;
+    for (const auto& batch : batches)
+        depths.push_back(batch.first);
+    if (!impostors)
+        impostors.reset(new TreeImpostors());
+    impostors->bake(depths);
+}
+
+/**
+* This method tells whether the tree meshes fade out into impostors, which needs an impostor for
+* every template: an instanced draw fades all its trees the same way.
+*/
+bool Forest::fadesOut() const {
+    if (!useImpostors || !impostors)
+        return false;
+    for (const auto& batch : batches) {
+        if (!impostors->contains(batch.first))
+            return false;
+    }
+    return true;
+}
+
+/**
+* This method returns the opacity of the impostor of the tree with the given index: 0 while the
+* tree is nearer than the impostor distance, rising to 1 at the end of the fade. The distance
+* grows with the level of detail bias.
+*/
+float Forest::impostorAlpha(size_t index) const {
+    if (!useImpostors || !impostors || !impostors->contains(placements[index].tree.depth()))
+        return 0.0f;
+    const InstanceData& instance = placements[index].instance;
+    const glm::vec3 position(instance.position[0], instance.position[1], instance.position[2]);
+    const float start = impostorDistance * LevelOfDetail::bias;
+    const float fade = std::max(impostorFade, 0.01f);
+    return glm::clamp((glm::length(LevelOfDetail::eye() - position) - start) / fade, 0.0f, 1.0f);
+}
+
+/**
+* This method selects the level of detail of every visible tree for this frame, and collects the
+* trees drawn as impostors. It returns true when all the trees are visible as meshes at full
+* detail, so the complete instance buffers can be drawn.
+*/
+bool Forest::select(const std::vector<char>* visible) {
+    bool everything = true;
+    selection.resize(placements.size());
+    far_trees.clear();
+    for (size_t i = 0; i < placements.size(); ++i) {
+        if (visible && (i >= visible->size() || !(*visible)[i])) {
+            selection[i] = 0;
+            everything = false;
+            continue;
+        }
+
+        const float alpha = impostorAlpha(i);
+        if (alpha > 0.0f)
+            far_trees.emplace_back(i, alpha);
+        if (alpha >= 1.0f) {
+            selection[i] = 0;
+            everything = false;
+            continue;
+        }
+
+        const AABB box = bounds(i);
+        const int lod = placements[i].lod.select((box.min + box.max) * 0.5f, glm::length(box.max - box.min) * 0.5f) + std::max(droppedLevels, 0);
+        selection[i] = static_cast<char>(1 + lod);
+        everything = everything && placements[i].tree.depth(lod) == placements[i].tree.depth();
+    }
+    return everything;
+}
+
+/**
+* This method draws the tree meshes through the GpuCulling, filling it with every tree first if
+* trees were added or removed. Trees are dropped on the GPU where their impostor is fully opaque,
+* so only the impostors are collected here: those of the trees in 'visible', or in the view
+* frustum when no visibility is given.
+*/
+void Forest::drawCulled(const std::vector<char>* visible) {
+    if (!culled) {
+        culled.reset(new GpuCulling());
+        culled_meshes.clear();
+        culled_dirty = true;
+    }
+    if (culled_dirty || culled_dropped != droppedLevels) {
+        culled->clear();
+        culled->setDetail(tree_detail);
+        for (size_t i = 0; i < placements.size(); ++i) {
+            glm::uvec4 levels;
+            for (int lod = 0; lod < GpuCulling::max_levels; ++lod) {
+                const int depth = placements[i].tree.depth(lod + std::max(droppedLevels, 0));
+                auto mesh = culled_meshes.find(depth);
+                if (mesh == culled_meshes.end())
+                    mesh = culled_meshes.emplace(depth, culled->addMesh(Tree::mesh(depth))).first;
+                levels[lod] = static_cast<glm::uint>(mesh->second);
+            }
+            const AABB box = bounds(i);
+            culled->add(placements[i].instance, (box.min + box.max) * 0.5f, glm::length(box.max - box.min) * 0.5f, levels);
+        }
+        culled_dirty = false;
+        culled_dropped = droppedLevels;
+    }
+
+    far_trees.clear();
+    float range = std::numeric_limits<float>::max();
+    if (fadesOut()) {
+        const Frustum frustum(CoreRenderer::viewProjection());
+        for (size_t i = 0; i < placements.size(); ++i) {
+            if (visible ? i >= visible->size() || !(*visible)[i] : !frustum.intersects(bounds(i)))
+                continue;
+            const float alpha = impostorAlpha(i);
+            if (alpha > 0.0f)
+                far_trees.emplace_back(i, alpha);
+        }
+        range = impostorDistance * LevelOfDetail::bias + std::max(impostorFade, 0.01f);
+        CoreRenderer::fadeOut(impostorDistance * LevelOfDetail::bias, impostorFade);
+    }
+    culled->draw(bark, range);
+}
+
+/**
+* This method rebuilds the instance buffers of the visible trees, by the template each one is
+* drawn with. It only runs when the visible trees or their levels of detail change, so a still
+* camera does not upload anything.
+*/
+void Forest::compact() {
+    for (auto& batch : visible_batches)
+        batch.second.clear();
+    for (size_t i = 0; i < placements.size(); ++i) {
+        if (selection[i])
+            visible_batches[placements[i].tree.depth(selection[i] - 1)].add(placements[i].instance);
+    }
+    compacted_selection = selection;
+}
+
+/**
+* This method draws the visible trees one by one with the fixed-function pipeline, each lit by
+* the local lights nearest to it when given. The tint is not applied on this path.
+*/
+void Forest::drawEach(const LightManager* lights) const {
+    for (size_t i = 0; i < placements.size(); ++i) {
+        if (!selection[i])
+            continue;
+        if (lights)
+            lights->apply(bounds(i));
+
+        // The mesh fades out as its impostor fades in
+        const float alpha = impostorAlpha(i);
+        if (alpha > 0.0f) {
+            GLubyte pattern[128];
+            ShaderProgram::screenDoorPattern(1.0f - alpha, pattern);
+            glPolygonStipple(pattern);
+            GLState::enable(GL_POLYGON_STIPPLE);
+        }
+        else {
+            GLState::disable(GL_POLYGON_STIPPLE);
+        }
+
+        const Placement& placement = placements[i];
+        const InstanceData& instance = placement.instance;
         glPushMatrix();
-        glTranslatef(xPos[i], 0.0f, zPos[i]);
-        trees[i].draw();
+        glTranslatef(instance.position[0], instance.position[1], instance.position[2]);
+        glRotatef(glm::degrees(instance.rotation), 0.0f, 1.0f, 0.0f);
+        glScalef(instance.scale[0], instance.scale[1], instance.scale[2]);
+        placement.tree.draw(selection[i] - 1);
         glPopMatrix();
     }
+    GLState::disable(GL_POLYGON_STIPPLE);
 }
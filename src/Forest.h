@@ -1,16 +1,65 @@
 #pragma once
 #include "Tree.h"
+#include "InstanceBuffer.h"
+#include "LevelOfDetail.h"
+#include "TreeImpostors.h"
+#include "GpuCulling.h"
+#include "Frustum.h"
+#include <map>
+#include <memory>
 #include <vector>
+#include <glm/glm.hpp>
+
+class LightManager;
 
 class Forest {
 public:
     Forest();
     Forest(int num_trees);
-    void draw();
+    size_t addTree(float x, float z, float rotation = 0.0f, float scale = 1.0f,
+        const glm::vec3& tint = glm::vec3(1.0f), int depth = 3);
+    void removeTree(size_t index);
+    size_t size() const { return placements.size(); }
+    unsigned int changes() const { return change_count; } // Grows whenever trees are added or removed
+    AABB bounds(size_t index) const;
+    AABB occluder(size_t index) const;
+    void draw(const std::vector<char>* visible = nullptr, const LightManager* lights = nullptr);
+    void drawCasters();
+    void bakeImpostors();
+    size_t impostorCount() const { return impostors ? impostors->quadCount() : 0; }
+
+    bool instanced = true; // Draw with one instanced call per tree template when supported
+    bool useImpostors = true; // Draw trees past impostorDistance as textured quads when supported
+    float impostorDistance = 40.0f; // Distance from the camera where impostors start to fade in
+    float impostorFade = 8.0f; // Distance over which a tree fades from its mesh to its impostor
+    int droppedLevels = 0; // Levels of recursion dropped from every tree, on top of its level of detail
 
 private:
-    std::vector<Tree> trees;
-    std::vector<float> xPos;
-    std::vector<float> zPos;
-};
+    struct Placement {
+        Tree tree;
+        InstanceData instance;
+        size_t slot; // Slot of the tree in the instance buffer of its template
+        LevelOfDetail lod; // Levels of recursion dropped as the tree gets smaller on screen
+    };
 
+    bool select(const std::vector<char>* visible);
+    bool fadesOut() const;
+    float impostorAlpha(size_t index) const;
+    void drawEach(const LightManager* lights) const;
+    void drawCulled(const std::vector<char>* visible);
+    void compact();
+
+    std::vector<Placement> placements;
+    std::map<int, InstanceBuffer> batches; // Instance buffer per tree template (recursion depth)
+    std::map<int, std::vector<size_t>> owners; // Tree index of every slot of each instance buffer
+    std::map<int, InstanceBuffer> visible_batches; // Instances of the visible trees only, per drawn template
+    std::vector<char> selection; // Per tree: 0 when hidden, else 1 + its level of detail this frame
+    std::vector<char> compacted_selection; // Selection the visible batches were built for
+    std::unique_ptr<TreeImpostors> impostors; // Baked views of the tree templates, created on first use
+    std::vector<std::pair<size_t, float>> far_trees; // Visible trees drawn as impostors, with their opacity
+    std::unique_ptr<GpuCulling> culled; // All trees, culled and drawn on the GPU, created on first use
+    std::map<int, size_t> culled_meshes; // Mesh index in culled of each tree template
+    bool culled_dirty = true; // Trees were added or removed since culled was filled
+    int culled_dropped = 0; // droppedLevels when culled was filled
+    unsigned int change_count = 0;
+};
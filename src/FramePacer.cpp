@@ -0,0 +1,273 @@
+/**
+ * The FramePacer class paces the display loop. beginFrame() runs before the frame reads its input
+ * and endFrame() right after the buffer swap, so that any waiting happens before the input is
+ * sampled rather than between sampling it and showing the result.
+ *
+ * Vertical sync is set with the swap control extensions: WGL_EXT_swap_control on Windows, and
+ * GLX_EXT_swap_control (or the MESA and SGI variants) with GLX. Adaptive sync is the swap interval
+ * -1 of the swap_control_tear extensions, which syncs when the frame is on time and tears instead
+ * of waiting a whole refresh when it is late.
+ *
+ * endFrame() puts a fence after the frame's commands. beginFrame() waits on the oldest fences until
+ * fewer than maxFramesInFlight frames are unfinished, so the driver can never queue more frames
+ * than that; one frame in flight gives the lowest latency, two let the CPU and GPU overlap.
+ *
+ * The frame rate cap sleeps until the planned start of the next frame. The system sleep is only
+ * trusted to within a couple of milliseconds, so the last part is spent yielding in a loop, and on
+ * Windows the timer resolution is raised to one millisecond while the pacer exists. A frame that
+ * starts late moves the schedule instead of being followed by a burst of catch-up frames.
+ *
+ * Besides the interval between frames, the pacer measures the work of each frame, without any of
+ * the waiting: the CPU time from the start of the frame to just before its swap, and the GPU time
+ * between a GL_TIMESTAMP query at the start of the frame and one before the swap. The swap and the
+ * fence wait are left out, since with a vertical sync they include the wait for the vertical blank.
+ * Timestamps are used rather than GL_TIME_ELAPSED, which DynamicResolution already has active
+ * around the scene and which cannot be nested. Their results arrive a frame or two later, so a ring
+ * of them is polled without waiting. The CPU and the GPU work on a frame at the same time, so the
+ * work of the frame is the longer of the two. Unlike the interval, it does not grow when the frame
+ * rate is capped, frames are drawn on demand or the swaps are synced.
+ */
+
+#include "FramePacer.h"
+#include <algorithm>
+#include <thread>
+#ifdef _WIN32
+#include <windows.h>
+#include <GL/wglew.h>
+#pragma comment(lib, "winmm.lib") // For timeBeginPeriod
+#else
+#include <GL/glxew.h>
+#endif
+
+FramePacer::FramePacer() : fences{}, oldest(0), queued(0), applied(VSyncOn), vsync_applied(false),
+    frame_start(Clock::now()), next_start(Clock::now()), frame_ms(0.0), wait_ms(0.0), sleep_ms(0.0), cpu_ms(0.0), gpu_ms(0.0),
+    queries{}, pending{}, next_query(0), timing(false)
+{
+#ifdef _WIN32
+    timeBeginPeriod(1);
+#endif
+}
+
+FramePacer::~FramePacer()
+{
+    for (GLsync& fence : fences) {
+        if (fence)
+            glDeleteSync(fence);
+    }
+    if (queries[0][0])
+        glDeleteQueries(2 * query_count, &queries[0][0]);
+#ifdef _WIN32
+    timeEndPeriod(1);
+#endif
+}
+
+/**
+ * This method tells whether the swap interval can be set.
+ */
+bool FramePacer::swapControlSupported()
+{
+#ifdef _WIN32
+    return WGLEW_EXT_swap_control != 0;
+#else
+    return GLXEW_EXT_swap_control || GLXEW_MESA_swap_control || GLXEW_SGI_swap_control;
+#endif
+}
+
+/**
+ * This method tells whether adaptive vertical sync (a negative swap interval) is available.
+ */
+bool FramePacer::adaptiveSupported()
+{
+#ifdef _WIN32
+    return WGLEW_EXT_swap_control && WGLEW_EXT_swap_control_tear;
+#else
+    return GLXEW_EXT_swap_control && GLXEW_EXT_swap_control_tear;
+#endif
+}
+
+/**
+ * This method tells whether frames can be fenced (OpenGL 3.2 or ARB_sync).
+ */
+bool FramePacer::fencesSupported()
+{
+    return GLEW_VERSION_3_2 || GLEW_ARB_sync;
+}
+
+/**
+ * This method tells whether the GPU time of frames can be measured (OpenGL 3.3 or ARB_timer_query).
+ */
+bool FramePacer::timerSupported()
+{
+    return GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+}
+
+/**
+ * This method returns the work of the last measured frame in milliseconds: the longer of its CPU
+ * and GPU times. Without timer queries, the wait for the GPU stands in for the GPU time, unless
+ * the swaps are synced and the wait includes the vertical blank.
+ */
+double FramePacer::workMilliseconds() const
+{
+    if (timerSupported())
+        return std::max(cpu_ms, gpu_ms);
+    return applied == VSyncOff ? cpu_ms + wait_ms : cpu_ms;
+}
+
+/**
+ * This method sets the swap interval of the current window: 0 swaps at once, 1 waits for the next
+ * vertical blank and -1 is adaptive. It returns false when the interval is not supported.
+ */
+bool FramePacer::swapInterval(int interval)
+{
+#ifdef _WIN32
+    if (!WGLEW_EXT_swap_control || (interval < 0 && !WGLEW_EXT_swap_control_tear))
+        return false;
+    return wglSwapIntervalEXT(interval) != FALSE;
+#else
+    if (GLXEW_EXT_swap_control) {
+        Display* display = glXGetCurrentDisplay();
+        const GLXDrawable drawable = glXGetCurrentDrawable();
+        if (!display || !drawable || (interval < 0 && !GLXEW_EXT_swap_control_tear))
+            return false;
+        glXSwapIntervalEXT(display, drawable, interval);
+        return true;
+    }
+    if (GLXEW_MESA_swap_control && interval >= 0)
+        return glXSwapIntervalMESA(static_cast<unsigned int>(interval)) == 0;
+    if (GLXEW_SGI_swap_control && interval > 0)
+        return glXSwapIntervalSGI(interval) == 0;
+    return false;
+#endif
+}
+
+/**
+ * This method starts a frame: it applies a changed vsync mode, sleeps until the frame rate cap
+ * allows the frame, and waits until fewer than maxFramesInFlight frames are queued on the GPU.
+ */
+void FramePacer::beginFrame()
+{
+    if (!vsync_applied || vsync != applied) {
+        const int intervals[] = { 0, 1, -1 };
+        if (swapInterval(intervals[vsync]))
+            applied = vsync;
+        else
+            vsync = applied; // Keep showing the mode still in effect
+        vsync_applied = true;
+    }
+
+    const Clock::time_point before_sleep = Clock::now();
+    if (frameRateCap > 0.0f)
+        sleepUntil(next_start);
+    const Clock::time_point before_wait = Clock::now();
+    waitForFrames(std::max(1, std::min(maxFramesInFlight, static_cast<int>(max_queued_frames))) - 1);
+    const Clock::time_point start = Clock::now();
+
+    sleep_ms = std::chrono::duration<double, std::milli>(before_wait - before_sleep).count();
+    wait_ms = std::chrono::duration<double, std::milli>(start - before_wait).count();
+    frame_ms = std::chrono::duration<double, std::milli>(start - frame_start).count();
+    frame_start = start;
+
+    if (frameRateCap > 0.0f) {
+        const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / frameRateCap));
+        next_start += period;
+        if (next_start < start)
+            next_start = start + period; // Late: restart the schedule from this frame
+    }
+    else {
+        next_start = start;
+    }
+
+    measure();
+    timing = false;
+    if (timerSupported()) {
+        if (!queries[0][0])
+            glGenQueries(2 * query_count, &queries[0][0]);
+        if (!pending[next_query]) {
+            glQueryCounter(queries[next_query][0], GL_TIMESTAMP);
+            timing = true;
+        }
+    }
+}
+
+/**
+ * This method is called once the frame is drawn, right before its buffer swap. It ends the CPU and
+ * GPU times of the frame.
+ */
+void FramePacer::beforeSwap()
+{
+    cpu_ms = std::chrono::duration<double, std::milli>(Clock::now() - frame_start).count();
+    if (timing) {
+        glQueryCounter(queries[next_query][1], GL_TIMESTAMP);
+        pending[next_query] = true;
+        next_query = (next_query + 1) % query_count;
+        timing = false;
+    }
+}
+
+/**
+ * This method ends the frame after its buffer swap, fencing its commands.
+ */
+void FramePacer::endFrame()
+{
+    if (!fencesSupported())
+        return;
+    if (queued == max_queued_frames)
+        waitForFrames(max_queued_frames - 1);
+
+    fences[(oldest + queued) % max_queued_frames] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ++queued;
+}
+
+/**
+ * This helper waits for the oldest queued frames until at most 'allowed' are left unfinished.
+ */
+void FramePacer::waitForFrames(int allowed)
+{
+    while (queued > allowed) {
+        GLsync& fence = fences[oldest];
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(fence);
+        fence = nullptr;
+        oldest = (oldest + 1) % max_queued_frames;
+        --queued;
+    }
+}
+
+/**
+ * This helper reads the GPU times of the finished frames, oldest first, without waiting for the
+ * ones still in flight.
+ */
+void FramePacer::measure()
+{
+    for (int i = 0; i < query_count; ++i) {
+        const int index = (next_query + i) % query_count; // Oldest first
+        if (!pending[index])
+            continue;
+        GLint available = 0;
+        glGetQueryObjectiv(queries[index][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(queries[index][0], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(queries[index][1], GL_QUERY_RESULT, &end);
+        gpu_ms = end > start ? (end - start) / 1000000.0 : 0.0;
+        pending[index] = false;
+    }
+}
+
+/**
+ * This helper sleeps until the given time: with the system sleep while more than two milliseconds
+ * are left, then by yielding.
+ */
+void FramePacer::sleepUntil(Clock::time_point target)
+{
+    const auto margin = std::chrono::milliseconds(2);
+    Clock::time_point now = Clock::now();
+    while (now < target) {
+        if (target - now > margin)
+            std::this_thread::sleep_for(target - now - margin);
+        else
+            std::this_thread::yield();
+        now = Clock::now();
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <chrono>
+#include <GL/glew.h>
+
+/*
+FramePacer controls when frames start: the vertical sync mode of the buffer swaps, how many
+frames the GPU may have queued behind the CPU (enforced with fences), and an optional frame rate
+cap kept by sleeping. It turns the free-running display loop into one with stable frame times
+and a bounded input latency.
+*/
+class FramePacer
+{
+public:
+	enum VSync { VSyncOff, VSyncOn, VSyncAdaptive };
+	static constexpr int max_queued_frames = 4;
+	static constexpr int query_count = 4; // Frames whose GPU timestamps may be pending
+
+	FramePacer();
+	FramePacer(const FramePacer&) = delete;
+	FramePacer& operator=(const FramePacer&) = delete;
+	~FramePacer();
+
+	static bool swapControlSupported();
+	static bool adaptiveSupported();
+	static bool fencesSupported();
+	static bool timerSupported();
+	static bool swapInterval(int interval);
+
+	void beginFrame();
+	void beforeSwap();
+	void endFrame();
+
+	double frameMilliseconds() const { return frame_ms; }
+	double waitMilliseconds() const { return wait_ms; }
+	double sleepMilliseconds() const { return sleep_ms; }
+	double cpuMilliseconds() const { return cpu_ms; }
+	double gpuMilliseconds() const { return gpu_ms; }
+	double workMilliseconds() const;
+	VSync appliedVSync() const { return applied; }
+
+	VSync vsync = VSyncOn; // Requested swap mode, applied at the start of the next frame
+	int maxFramesInFlight = 2; // Frames the GPU may still be working on when a new one starts, 1 to max_queued_frames
+	float frameRateCap = 0.0f; // Frames per second, 0 for no cap
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	void waitForFrames(int allowed);
+	void sleepUntil(Clock::time_point target);
+	void measure();
+
+	GLsync fences[max_queued_frames]; // Ring of the fences of the queued frames, oldest first from 'oldest'
+	int oldest;
+	int queued;
+	VSync applied;
+	bool vsync_applied;
+	Clock::time_point frame_start;
+	Clock::time_point next_start; // Earliest start of the next frame under the cap
+	double frame_ms, wait_ms, sleep_ms;
+	double cpu_ms; // From the start of the frame to just before its swap
+	double gpu_ms; // Between the GPU timestamps of the start of the frame and of its swap, 0 when unknown
+
+	GLuint queries[query_count][2]; // Ring of timestamp pairs, read back once their results are available
+	bool pending[query_count]; // The pair was issued and its results not read yet
+	int next_query;
+	bool timing; // The start of the current frame was timestamped
+};
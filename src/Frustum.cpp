@@ -0,0 +1,119 @@
+/**
+ * The Frustum class extracts the clipping planes from a combined projection * view matrix
+ * (Gribb and Hartmann). A box is outside when it lies completely behind one of the planes,
+ * which is decided by testing the box corner furthest along the plane normal. A box is fully
+ * inside when even its nearest corner is in front of every plane.
+ *
+ * test(...) checks four boxes at once. The corner selection only depends on the signs of the
+ * plane normal, which are the same for all four boxes, so every plane costs three multiply-adds
+ * and a compare on four lanes. SSE is used when the compiler targets it; otherwise the same
+ * computation runs lane by lane.
+ */
+
+#include "Frustum.h"
+#include <cmath>
+#include <limits>
+#include "Simd.h"
+
+/**
+ * This method stores a box in one of the four lanes.
+ */
+void AABB4::set(int lane, const AABB& box)
+{
+    min_x[lane] = box.min.x;
+    min_y[lane] = box.min.y;
+    min_z[lane] = box.min.z;
+    max_x[lane] = box.max.x;
+    max_y[lane] = box.max.y;
+    max_z[lane] = box.max.z;
+}
+
+/**
+ * This method fills all lanes with empty boxes, which are never visible.
+ */
+void AABB4::clear()
+{
+    const float huge = std::numeric_limits<float>::max();
+    for (int lane = 0; lane < 4; ++lane)
+        set(lane, AABB{ glm::vec3(huge), glm::vec3(-huge) });
+}
+
+/**
+ * The constructor extracts and normalizes the planes of the given projection * view matrix.
+ */
+Frustum::Frustum(const glm::mat4& view_projection)
+{
+    const glm::mat4 m = glm::transpose(view_projection); // Rows of the matrix as columns
+    planes[0] = m[3] + m[0];
+    planes[1] = m[3] - m[0];
+    planes[2] = m[3] + m[1];
+    planes[3] = m[3] - m[1];
+    planes[4] = m[3] + m[2];
+    planes[5] = m[3] - m[2];
+
+    for (glm::vec4& plane : planes)
+        plane /= glm::length(glm::vec3(plane));
+}
+
+/**
+ * This method tells whether the box overlaps the frustum. It is conservative: a box near
+ * a frustum corner may be reported visible although it is not.
+ */
+bool Frustum::intersects(const glm::vec3& box_min, const glm::vec3& box_max) const
+{
+    for (const glm::vec4& plane : planes) {
+        const glm::vec3 furthest(plane.x >= 0.0f ? box_max.x : box_min.x,
+            plane.y >= 0.0f ? box_max.y : box_min.y,
+            plane.z >= 0.0f ? box_max.z : box_min.z);
+        if (glm::dot(glm::vec3(plane), furthest) + plane.w < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * This method tests four boxes. Bit i of 'intersecting' is set when box i overlaps the frustum
+ * (conservatively, as intersects(...)), and bit i of 'inside' when box i is completely inside it.
+ */
+void Frustum::test(const AABB4& boxes, int& intersecting, int& inside) const
+{
+    intersecting = 0xf;
+    inside = 0xf;
+
+#ifdef SIMD_SSE
+    const __m128 min_x = _mm_load_ps(boxes.min_x), min_y = _mm_load_ps(boxes.min_y), min_z = _mm_load_ps(boxes.min_z);
+    const __m128 max_x = _mm_load_ps(boxes.max_x), max_y = _mm_load_ps(boxes.max_y), max_z = _mm_load_ps(boxes.max_z);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (const glm::vec4& plane : planes) {
+        const __m128 a = _mm_set1_ps(plane.x), b = _mm_set1_ps(plane.y), c = _mm_set1_ps(plane.z), d = _mm_set1_ps(plane.w);
+
+        const __m128 far_x = plane.x >= 0.0f ? max_x : min_x, near_x = plane.x >= 0.0f ? min_x : max_x;
+        const __m128 far_y = plane.y >= 0.0f ? max_y : min_y, near_y = plane.y >= 0.0f ? min_y : max_y;
+        const __m128 far_z = plane.z >= 0.0f ? max_z : min_z, near_z = plane.z >= 0.0f ? min_z : max_z;
+
+        const __m128 far_distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, far_x), _mm_mul_ps(b, far_y)), _mm_add_ps(_mm_mul_ps(c, far_z), d));
+        const __m128 near_distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, near_x), _mm_mul_ps(b, near_y)), _mm_add_ps(_mm_mul_ps(c, near_z), d));
+
+        intersecting &= _mm_movemask_ps(_mm_cmpge_ps(far_distance, zero));
+        inside &= _mm_movemask_ps(_mm_cmpge_ps(near_distance, zero));
+    }
+#else
+    for (int lane = 0; lane < 4; ++lane) {
+        for (const glm::vec4& plane : planes) {
+            const float far_distance = plane.x * (plane.x >= 0.0f ? boxes.max_x[lane] : boxes.min_x[lane])
+                + plane.y * (plane.y >= 0.0f ? boxes.max_y[lane] : boxes.min_y[lane])
+                + plane.z * (plane.z >= 0.0f ? boxes.max_z[lane] : boxes.min_z[lane]) + plane.w;
+            const float near_distance = plane.x * (plane.x >= 0.0f ? boxes.min_x[lane] : boxes.max_x[lane])
+                + plane.y * (plane.y >= 0.0f ? boxes.min_y[lane] : boxes.max_y[lane])
+                + plane.z * (plane.z >= 0.0f ? boxes.min_z[lane] : boxes.max_z[lane]) + plane.w;
+            if (far_distance < 0.0f)
+                intersecting &= ~(1 << lane);
+            if (near_distance < 0.0f)
+                inside &= ~(1 << lane);
+        }
+    }
+#endif
+
+    inside &= intersecting;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/*
+Axis-aligned bounding box in world coordinates.
+*/
+struct AABB
+{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+/*
+Four bounding boxes stored component by component, so one SIMD register holds the same
+coordinate of all four. Unused lanes should hold an empty box (min above max).
+*/
+struct alignas(16) AABB4
+{
+	float min_x[4], min_y[4], min_z[4];
+	float max_x[4], max_y[4], max_z[4];
+
+	void set(int lane, const AABB& box);
+	void clear();
+};
+
+/*
+Frustum holds the six clipping planes of a view volume in world coordinates and tests
+axis-aligned boxes against them, one at a time or four at a time.
+*/
+class Frustum
+{
+public:
+	explicit Frustum(const glm::mat4& view_projection);
+
+	bool intersects(const glm::vec3& box_min, const glm::vec3& box_max) const;
+	bool intersects(const AABB& box) const { return intersects(box.min, box.max); }
+	void test(const AABB4& boxes, int& intersecting, int& inside) const;
+	const glm::vec4& plane(int index) const { return planes[index]; }
+
+private:
+	glm::vec4 planes[6]; // Left, right, bottom, top, near, far; normals point inside
+};
@@ -0,0 +1,253 @@
+/**
+ * The GLState class is a client-side cache in front of the OpenGL state calls used by the scene.
+ * Every call is compared with the shadowed value and only forwarded when it changes something.
+ * Values that are not known yet (at startup, or after invalidate()) are always forwarded.
+ *
+ * Light positions and spot directions are never filtered: OpenGL transforms them by the modelview
+ * matrix current at the time of the call, so the same values can mean a different light placement.
+ * While GL_COLOR_MATERIAL is enabled the material follows the current color, so material calls are
+ * forwarded without caching, and the material cache is dropped when GL_COLOR_MATERIAL is disabled.
+ *
+ * The number of forwarded calls, dropped calls and cached queries is counted per frame; endFrame()
+ * publishes the counts of the frame that just ended.
+ */
+
+#include "GLState.h"
+#include <cstring>
+
+bool GLState::filtering = true;
+std::unordered_map<GLenum, bool> GLState::capabilities;
+GLState::Parameter GLState::materials[2][5];
+GLState::Parameter GLState::lights[8][8];
+GLState::Parameter GLState::blend;
+unsigned int GLState::issued = 0, GLState::dropped = 0, GLState::queries = 0;
+unsigned int GLState::last_issued = 0, GLState::last_dropped = 0, GLState::last_queries = 0;
+
+/**
+ * This method enables a capability unless it is known to be enabled.
+ */
+void GLState::enable(GLenum capability)
+{
+    auto known = capabilities.find(capability);
+    if (filtering && known != capabilities.end() && known->second) {
+        ++dropped;
+        return;
+    }
+    glEnable(capability);
+    capabilities[capability] = true;
+    ++issued;
+}
+
+/**
+ * This method disables a capability unless it is known to be disabled.
+ */
+void GLState::disable(GLenum capability)
+{
+    auto known = capabilities.find(capability);
+    if (filtering && known != capabilities.end() && !known->second) {
+        ++dropped;
+        return;
+    }
+    glDisable(capability);
+    capabilities[capability] = false;
+    ++issued;
+    if (capability == GL_COLOR_MATERIAL)
+        invalidateMaterial();
+}
+
+/**
+ * This method tells whether a capability is enabled. Only the first query of a capability
+ * reaches the driver.
+ */
+bool GLState::isEnabled(GLenum capability)
+{
+    if (filtering && capabilities.count(capability))
+        ++queries;
+    return lookup(capability);
+}
+
+/**
+ * This method sets a material color (or GL_AMBIENT_AND_DIFFUSE) of one or both faces.
+ */
+void GLState::material(GLenum face, GLenum name, const GLfloat* values)
+{
+    const int first_face = face == GL_BACK ? 1 : 0;
+    const int last_face = face == GL_FRONT ? 0 : 1;
+    const bool tracked = !lookup(GL_COLOR_MATERIAL) && (face == GL_FRONT || face == GL_BACK || face == GL_FRONT_AND_BACK);
+
+    bool changed = !filtering || !tracked;
+    for (int f = first_face; f <= last_face; ++f) {
+        if (name == GL_AMBIENT_AND_DIFFUSE) {
+            changed |= update(materials[f][0], values, 4);
+            changed |= update(materials[f][1], values, 4);
+        }
+        else if (Parameter* parameter = materialParameter(f, name)) {
+            changed |= update(*parameter, values, name == GL_SHININESS ? 1 : 4);
+        }
+        else {
+            changed = true;
+        }
+        if (!tracked)
+            materials[f][0].known = materials[f][1].known = materials[f][2].known = materials[f][3].known = materials[f][4].known = false;
+    }
+
+    if (!changed) {
+        ++dropped;
+        return;
+    }
+    glMaterialfv(face, name, values);
+    ++issued;
+}
+
+/**
+ * This method sets a single-valued material parameter (the shininess).
+ */
+void GLState::material(GLenum face, GLenum name, GLfloat value)
+{
+    const GLfloat values[4] = { value, 0.0f, 0.0f, 0.0f };
+    if (name != GL_SHININESS) {
+        glMaterialf(face, name, value);
+        ++issued;
+        return;
+    }
+    material(face, name, values);
+}
+
+/**
+ * This method sets a light parameter. Positions and spot directions are always forwarded.
+ */
+void GLState::light(GLenum light, GLenum name, const GLfloat* values)
+{
+    int count = 0;
+    Parameter* parameter = lightParameter(light, name, count);
+    if (parameter && !update(*parameter, values, count) && filtering) {
+        ++dropped;
+        return;
+    }
+    glLightfv(light, name, values);
+    ++issued;
+}
+
+/**
+ * This method sets a single-valued light parameter (spot exponent, cutoff or attenuation).
+ */
+void GLState::light(GLenum light, GLenum name, GLfloat value)
+{
+    const GLfloat values[4] = { value, 0.0f, 0.0f, 0.0f };
+    GLState::light(light, name, values);
+}
+
+/**
+ * This method sets the blend function.
+ */
+void GLState::blendFunc(GLenum source, GLenum destination)
+{
+    const GLfloat values[2] = { static_cast<GLfloat>(source), static_cast<GLfloat>(destination) };
+    if (!update(blend, values, 2) && filtering) {
+        ++dropped;
+        return;
+    }
+    glBlendFunc(source, destination);
+    ++issued;
+}
+
+/**
+ * This method forgets all shadowed state, for code that changes OpenGL state behind the cache.
+ */
+void GLState::invalidate()
+{
+    capabilities.clear();
+    invalidateMaterial();
+    for (auto& light : lights)
+        for (Parameter& parameter : light)
+            parameter.known = false;
+    blend.known = false;
+}
+
+/**
+ * This method forgets the shadowed material, e.g. after GL_COLOR_MATERIAL changed it.
+ */
+void GLState::invalidateMaterial()
+{
+    for (auto& face : materials)
+        for (Parameter& parameter : face)
+            parameter.known = false;
+}
+
+/**
+ * This method publishes the counters of the frame that just ended and resets them.
+ */
+void GLState::endFrame()
+{
+    last_issued = issued;
+    last_dropped = dropped;
+    last_queries = queries;
+    issued = dropped = queries = 0;
+}
+
+/**
+ * This helper returns the shadowed state of a capability, querying the driver when it is unknown.
+ */
+bool GLState::lookup(GLenum capability)
+{
+    auto known = capabilities.find(capability);
+    if (filtering && known != capabilities.end())
+        return known->second;
+    const bool enabled = glIsEnabled(capability) == GL_TRUE;
+    capabilities[capability] = enabled;
+    return enabled;
+}
+
+/**
+ * This helper stores the values in the parameter and returns whether they differ from
+ * the shadowed ones (or these were unknown).
+ */
+bool GLState::update(Parameter& parameter, const GLfloat* values, int count)
+{
+    if (parameter.known && std::memcmp(parameter.values, values, count * sizeof(GLfloat)) == 0)
+        return false;
+    std::memcpy(parameter.values, values, count * sizeof(GLfloat));
+    parameter.known = true;
+    return true;
+}
+
+/**
+ * This helper returns the shadow of a material parameter, or nullptr if it is not cached.
+ */
+GLState::Parameter* GLState::materialParameter(int face, GLenum name)
+{
+    switch (name) {
+    case GL_AMBIENT: return &materials[face][0];
+    case GL_DIFFUSE: return &materials[face][1];
+    case GL_SPECULAR: return &materials[face][2];
+    case GL_EMISSION: return &materials[face][3];
+    case GL_SHININESS: return &materials[face][4];
+    default: return nullptr;
+    }
+}
+
+/**
+ * This helper returns the shadow of a light parameter and its number of values, or nullptr
+ * if the parameter is not cached.
+ */
+GLState::Parameter* GLState::lightParameter(GLenum light, GLenum name, int& count)
+{
+    if (light < GL_LIGHT0 || light > GL_LIGHT7)
+        return nullptr;
+    Parameter* parameters = lights[light - GL_LIGHT0];
+    count = 4;
+    switch (name) {
+    case GL_AMBIENT: return &parameters[0];
+    case GL_DIFFUSE: return &parameters[1];
+    case GL_SPECULAR: return &parameters[2];
+    }
+    count = 1;
+    switch (name) {
+    case GL_SPOT_EXPONENT: return &parameters[3];
+    case GL_SPOT_CUTOFF: return &parameters[4];
+    case GL_CONSTANT_ATTENUATION: return &parameters[5];
+    case GL_LINEAR_ATTENUATION: return &parameters[6];
+    case GL_QUADRATIC_ATTENUATION: return &parameters[7];
+    default: return nullptr;
+    }
+}
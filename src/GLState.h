@@ -0,0 +1,51 @@
+#pragma once
+#include <unordered_map>
+#include <GL/glew.h>
+
+/*
+GLState shadows the fixed-function state the scene changes most often: enable flags, material
+and light parameters and the blend function. Calls that would not change anything are dropped,
+and enable queries are answered from the shadow copy instead of asking the driver.
+*/
+class GLState
+{
+public:
+	static void enable(GLenum capability);
+	static void disable(GLenum capability);
+	static bool isEnabled(GLenum capability);
+
+	static void material(GLenum face, GLenum name, const GLfloat* values);
+	static void material(GLenum face, GLenum name, GLfloat value);
+	static void light(GLenum light, GLenum name, const GLfloat* values);
+	static void light(GLenum light, GLenum name, GLfloat value);
+	static void blendFunc(GLenum source, GLenum destination);
+
+	static void invalidate();
+	static void invalidateMaterial();
+	static void endFrame();
+
+	static unsigned int issuedCalls() { return last_issued; }
+	static unsigned int droppedCalls() { return last_dropped; }
+	static unsigned int cachedQueries() { return last_queries; }
+
+	static bool filtering; // When false every call goes to the driver (for comparison)
+
+private:
+	struct Parameter {
+		bool known = false;
+		GLfloat values[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	};
+
+	static bool lookup(GLenum capability);
+	static bool update(Parameter& parameter, const GLfloat* values, int count);
+	static Parameter* materialParameter(int face, GLenum name);
+	static Parameter* lightParameter(GLenum light, GLenum name, int& count);
+
+	static std::unordered_map<GLenum, bool> capabilities;
+	static Parameter materials[2][5]; // Front and back: ambient, diffuse, specular, emission, shininess
+	static Parameter lights[8][8]; // Per light: ambient, diffuse, specular, exponent, cutoff, 3 attenuations
+	static Parameter blend;
+
+	static unsigned int issued, dropped, queries;
+	static unsigned int last_issued, last_dropped, last_queries;
+};
@@ -0,0 +1,259 @@
+/**
+ * The Geometry class collects indexed triangles (or line segments) on the CPU so that
+ * they can be uploaded once into vertex buffers. The builders mirror the shapes drawn by
+ * glutSolidCube, glutSolidCone, glutSolidCylinder and glutSolidSphere: the same orientation
+ * (along the +Z axis for cones, cylinders and sphere poles) and the same dimensions, so existing
+ * transformations carry over.
+ * Every builder accepts a transformation matrix that is baked into the generated vertices.
+ * Vertices can optionally carry a color, set with paint(...), for meshes that mix several colors.
+ */
+
+#include "Geometry.h"
+#include <cmath>
+
+/**
+ * Helper that bakes a transformation into positions and normals.
+ */
+struct BakeTransform
+{
+    glm::mat4 transform;
+    glm::mat3 normal_matrix;
+
+    explicit BakeTransform(const glm::mat4& m)
+        : transform(m), normal_matrix(glm::transpose(glm::inverse(glm::mat3(m)))) {}
+
+    glm::vec3 point(const glm::vec3& p) const { return glm::vec3(transform * glm::vec4(p, 1.0f)); }
+    glm::vec3 normal(const glm::vec3& n) const { return glm::normalize(normal_matrix * n); }
+};
+
+/**
+ * This method appends a single vertex and returns its index.
+ */
+GLuint Geometry::addVertex(const glm::vec3& position, const glm::vec3& normal)
+{
+    Vertex vertex = { { position.x, position.y, position.z }, { normal.x, normal.y, normal.z } };
+    vertices.push_back(vertex);
+    return static_cast<GLuint>(vertices.size() - 1);
+}
+
+/**
+ * This method appends a flat quad, split into two triangles, in the given vertex order.
+ */
+void Geometry::addQuad(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3,
+    const glm::vec3& normal)
+{
+    const GLuint first = addVertex(p0, normal);
+    addVertex(p1, normal);
+    addVertex(p2, normal);
+    addVertex(p3, normal);
+
+    const GLuint quad[] = { 0, 1, 2, 0, 2, 3 };
+    for (GLuint index : quad)
+        indices.push_back(first + index);
+}
+
+/**
+ * This method appends a closed loop of line segments (to be drawn with GL_LINES).
+ * The normal points upwards since loops are only used for flat outlines on the ground.
+ */
+void Geometry::addLineLoop(const std::vector<glm::vec3>& points)
+{
+    const GLuint first = static_cast<GLuint>(vertices.size());
+    for (const glm::vec3& point : points)
+        addVertex(point, glm::vec3(0.0f, 1.0f, 0.0f));
+
+    const GLuint count = static_cast<GLuint>(points.size());
+    for (GLuint i = 0; i < count; ++i) {
+        indices.push_back(first + i);
+        indices.push_back(first + (i + 1) % count);
+    }
+}
+
+/**
+ * This method appends a unit cube centered at the origin, like glutSolidCube(1).
+ */
+void Geometry::addBox(const glm::mat4& transform)
+{
+    const BakeTransform bake(transform);
+
+    // Each face is described by its normal and two tangents whose cross product is the normal,
+    // so the corners below are counter-clockwise when seen from outside.
+    const glm::vec3 faces[6][3] = {
+        { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+        { { -1, 0, 0 }, { 0, 0, 1 }, { 0, 1, 0 } },
+        { { 0, 1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } },
+        { { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, 1 } },
+        { { 0, 0, 1 }, { 1, 0, 0 }, { 0, 1, 0 } },
+        { { 0, 0, -1 }, { 0, 1, 0 }, { 1, 0, 0 } },
+    };
+
+    for (const auto& face : faces) {
+        const glm::vec3 center = face[0] * 0.5f;
+        const glm::vec3 u = face[1] * 0.5f;
+        const glm::vec3 v = face[2] * 0.5f;
+        addQuad(bake.point(center - u - v), bake.point(center + u - v),
+            bake.point(center + u + v), bake.point(center - u + v), bake.normal(face[0]));
+    }
+}
+
+/**
+ * This method appends an open tube along the +Z axis whose radius goes from base at z = 0
+ * to top at z = height, like gluCylinder.
+ */
+void Geometry::addTube(const glm::mat4& transform, float base, float top, float height, int slices, int stacks)
+{
+    const BakeTransform bake(transform);
+    const float slant = std::sqrt((base - top) * (base - top) + height * height);
+    const float normal_radial = height / slant;
+    const float normal_z = (base - top) / slant;
+    const float step = 2.0f * 3.14159265f / slices;
+
+    // One ring per stack, the radius interpolated between the two ends.
+    const GLuint side = static_cast<GLuint>(vertices.size());
+    for (int i = 0; i <= stacks; ++i) {
+        const float t = static_cast<float>(i) / stacks;
+        const float radius = base + (top - base) * t;
+        for (int j = 0; j <= slices; ++j) {
+            const float c = std::cos(j * step), s = std::sin(j * step);
+            addVertex(bake.point(glm::vec3(c * radius, s * radius, t * height)),
+                bake.normal(glm::vec3(c * normal_radial, s * normal_radial, normal_z)));
+        }
+    }
+    for (int i = 0; i < stacks; ++i) {
+        for (int j = 0; j < slices; ++j) {
+            const GLuint a = side + i * (slices + 1) + j;
+            const GLuint b = a + slices + 1;
+            indices.insert(indices.end(), { a, a + 1, b + 1, a, b + 1, b });
+        }
+    }
+}
+
+/**
+ * This method appends a cone along the +Z axis with its base at z = 0, like glutSolidCone.
+ */
+void Geometry::addCone(const glm::mat4& transform, float base, float height, int slices, int stacks)
+{
+    const BakeTransform bake(transform);
+    const float step = 2.0f * 3.14159265f / slices;
+
+    // Side: a tube whose radius shrinks to zero at the tip.
+    addTube(transform, base, 0.0f, height, slices, stacks);
+
+    // Base disk facing -Z.
+    const GLuint center = addVertex(bake.point(glm::vec3(0.0f)), bake.normal(glm::vec3(0, 0, -1)));
+    for (int j = 0; j <= slices; ++j) {
+        addVertex(bake.point(glm::vec3(std::cos(j * step) * base, std::sin(j * step) * base, 0.0f)),
+            bake.normal(glm::vec3(0, 0, -1)));
+    }
+    for (int j = 0; j < slices; ++j)
+        indices.insert(indices.end(), { center, center + j + 2, center + j + 1 });
+}
+
+/**
+ * This method appends a capped cylinder along the +Z axis from z = 0 to z = height,
+ * like glutSolidCylinder.
+ */
+void Geometry::addCylinder(const glm::mat4& transform, float radius, float height, int slices, int stacks)
+{
+    const BakeTransform bake(transform);
+    const float step = 2.0f * 3.14159265f / slices;
+
+    const GLuint side = static_cast<GLuint>(vertices.size());
+    for (int i = 0; i <= stacks; ++i) {
+        const float z = height * i / stacks;
+        for (int j = 0; j <= slices; ++j) {
+            const float c = std::cos(j * step), s = std::sin(j * step);
+            addVertex(bake.point(glm::vec3(c * radius, s * radius, z)), bake.normal(glm::vec3(c, s, 0.0f)));
+        }
+    }
+    for (int i = 0; i < stacks; ++i) {
+        for (int j = 0; j < slices; ++j) {
+            const GLuint a = side + i * (slices + 1) + j;
+            const GLuint b = a + slices + 1;
+            indices.insert(indices.end(), { a, a + 1, b + 1, a, b + 1, b });
+        }
+    }
+
+    // Bottom cap facing -Z and top cap facing +Z.
+    for (int cap = 0; cap < 2; ++cap) {
+        const float z = cap == 0 ? 0.0f : height;
+        const glm::vec3 normal = bake.normal(glm::vec3(0.0f, 0.0f, cap == 0 ? -1.0f : 1.0f));
+        const GLuint center = addVertex(bake.point(glm::vec3(0.0f, 0.0f, z)), normal);
+        for (int j = 0; j <= slices; ++j)
+            addVertex(bake.point(glm::vec3(std::cos(j * step) * radius, std::sin(j * step) * radius, z)), normal);
+        for (int j = 0; j < slices; ++j) {
+            if (cap == 0)
+                indices.insert(indices.end(), { center, center + j + 2, center + j + 1 });
+            else
+                indices.insert(indices.end(), { center, center + j + 1, center + j + 2 });
+        }
+    }
+}
+
+/**
+ * This method appends a sphere centered at the origin with its poles on the Z axis, like glutSolidSphere.
+ */
+void Geometry::addSphere(const glm::mat4& transform, float radius, int slices, int stacks)
+{
+    const BakeTransform bake(transform);
+    const float pi = 3.14159265f;
+
+    // One ring per stack from the +Z pole down to the -Z pole, the normal being the unit direction.
+    const GLuint first = static_cast<GLuint>(vertices.size());
+    for (int i = 0; i <= stacks; ++i) {
+        const float phi = pi * i / stacks;
+        for (int j = 0; j <= slices; ++j) {
+            const float theta = 2.0f * pi * j / slices;
+            const glm::vec3 direction(std::cos(theta) * std::sin(phi), std::sin(theta) * std::sin(phi), std::cos(phi));
+            addVertex(bake.point(direction * radius), bake.normal(direction));
+        }
+    }
+    for (int i = 0; i < stacks; ++i) {
+        for (int j = 0; j < slices; ++j) {
+            const GLuint a = first + i * (slices + 1) + j;
+            const GLuint b = a + slices + 1;
+            indices.insert(indices.end(), { a, b, b + 1, a, b + 1, a + 1 });
+        }
+    }
+}
+
+/**
+ * This method appends another geometry, offsetting its indices. Colors are kept when either
+ * geometry is painted; unpainted vertices are white.
+ */
+void Geometry::append(const Geometry& other)
+{
+    const GLuint base_vertex = static_cast<GLuint>(vertices.size());
+    if (!other.colors.empty() || !colors.empty())
+        colors.resize(vertices.size() * 4, 1.0f);
+
+    vertices.insert(vertices.end(), other.vertices.begin(), other.vertices.end());
+    for (GLuint index : other.indices)
+        indices.push_back(base_vertex + index);
+
+    if (!other.colors.empty())
+        colors.insert(colors.end(), other.colors.begin(), other.colors.end());
+    else if (!colors.empty())
+        colors.resize(vertices.size() * 4, 1.0f);
+}
+
+/**
+ * This method sets the color of every vertex from first_vertex to the end. Vertices before
+ * first_vertex that have no color yet become white.
+ */
+void Geometry::paint(size_t first_vertex, const glm::vec4& color)
+{
+    colors.resize(first_vertex * 4, 1.0f);
+    for (size_t i = first_vertex; i < vertices.size(); ++i)
+        colors.insert(colors.end(), { color.r, color.g, color.b, color.a });
+}
+
+/**
+ * This method removes all vertices, indices and colors.
+ */
+void Geometry::clear()
+{
+    vertices.clear();
+    indices.clear();
+    colors.clear();
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/*
+Vertex layout shared by all baked geometry: position followed by normal.
+*/
+struct Vertex
+{
+	GLfloat position[3];
+	GLfloat normal[3];
+};
+
+/*
+Geometry is a CPU-side indexed vertex list. It offers builders that reproduce the GLUT solid
+shapes so they can be baked once and drawn from vertex buffers instead of being re-tessellated.
+*/
+class Geometry
+{
+public:
+	std::vector<Vertex> vertices;
+	std::vector<GLuint> indices;
+	std::vector<GLfloat> colors; // Optional RGBA color per vertex, empty when the geometry is not painted
+
+	GLuint addVertex(const glm::vec3& position, const glm::vec3& normal);
+	void addQuad(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3,
+		const glm::vec3& normal);
+	void addLineLoop(const std::vector<glm::vec3>& points);
+	void addBox(const glm::mat4& transform);
+	void addTube(const glm::mat4& transform, float base, float top, float height, int slices, int stacks);
+	void addCone(const glm::mat4& transform, float base, float height, int slices, int stacks);
+	void addCylinder(const glm::mat4& transform, float radius, float height, int slices, int stacks);
+	void addSphere(const glm::mat4& transform, float radius, int slices, int stacks);
+	void append(const Geometry& other);
+	void paint(size_t first_vertex, const glm::vec4& color);
+	void clear();
+	bool empty() const { return indices.empty(); }
+};
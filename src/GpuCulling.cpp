@@ -0,0 +1,419 @@
+/**
+ * The GpuCulling class moves per-instance culling and the draw calls of large instanced objects to
+ * the GPU. addMesh(...) registers the painted meshes the instances are drawn with; their vertex,
+ * color and index buffers are copied once into three shared buffers, so that every mesh is one
+ * DrawElementsIndirectCommand (first index and base vertex into the shared buffers) and all of
+ * them are drawn by a single glMultiDrawElementsIndirect call.
+ *
+ * Each instance has a bounding sphere and up to four meshes, one per level of detail. The visible
+ * instances buffer reserves, for every mesh, a range as large as the number of instances that may
+ * use it; the command's base instance points at that range, and the instance attributes (divisor
+ * one) are read from it.
+ *
+ * Each frame the commands are reset to no instances, and a compute shader with one invocation per
+ * instance drops the instances that are outside the frustum or at least max_distance away, picks the
+ * level of detail of the others from their projected size like LevelOfDetail (from the distance to
+ * the eye, and without hysteresis), and appends them with an atomic counter to the command of
+ * the chosen mesh. The draw then reads the commands written by the GPU, without a round trip to
+ * the CPU. When compute shaders are missing (OpenGL below 4.3 with the multi-draw extensions) or
+ * switched off, the same test runs on the CPU, which uploads the commands and visible instances.
+ */
+
+#include "GpuCulling.h"
+#include "CoreRenderer.h"
+#include "Frustum.h"
+#include "LevelOfDetail.h"
+#include <cstddef> // For offsetof
+#include <glm/gtc/type_ptr.hpp>
+
+bool GpuCulling::enabled = true;
+bool GpuCulling::compute = true;
+
+static_assert(sizeof(InstanceData) == 3 * sizeof(glm::vec4), "InstanceData must match the compute shader's Instance");
+
+static const char* const compute_source = R"(
+#version 430
+layout(local_size_x = 64) in;
+
+struct Instance {
+    vec4 positionRotation;
+    vec4 scale;
+    vec4 tint;
+};
+
+struct Item {
+    vec4 sphere;
+    uvec4 levels; // Mesh per level of detail
+};
+
+struct Command {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout(std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+layout(std430, binding = 1) readonly buffer Items { Item items[]; };
+layout(std430, binding = 2) buffer Commands { Command commands[]; };
+layout(std430, binding = 3) writeonly buffer Visible { Instance visible[]; };
+
+uniform vec4 planes[6];
+uniform vec4 eyeRange; // Eye position and the distance limit
+uniform vec4 detail; // Thresholds of the levels in pixels, and pixels per unit at distance one (negative for level 0 only)
+uniform uint instanceCount;
+
+void main()
+{
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= instanceCount)
+        return;
+
+    Instance instance = instances[i];
+    if (distance(instance.positionRotation.xyz, eyeRange.xyz) >= eyeRange.w)
+        return;
+    vec4 sphere = items[i].sphere;
+    for (int p = 0; p < 6; ++p) {
+        if (dot(planes[p].xyz, sphere.xyz) + planes[p].w < -sphere.w)
+            return;
+    }
+
+    int level = 0;
+    if (detail.w >= 0.0) {
+        float sphereDistance = distance(sphere.xyz, eyeRange.xyz);
+        float size = sphereDistance <= sphere.w ? 1e30 : 2.0 * sphere.w * detail.w / sphereDistance;
+        while (level < 3 && size < detail[level])
+            ++level;
+    }
+
+    uint mesh = items[i].levels[level];
+    uint slot = atomicAdd(commands[mesh].instanceCount, 1u);
+    visible[commands[mesh].baseInstance + slot] = instance;
+}
+)";
+
+GpuCulling::GpuCulling() : thresholds(0.0f), vertex_array(0), vertices(0), colors(0), indices(0), instance_buffer(0),
+    item_buffer(0), command_buffer(0), visible_buffer(0), meshes_dirty(true), instances_dirty(true), culled_on_gpu(false),
+    visible_count(0) {}
+
+GpuCulling::~GpuCulling()
+{
+    if (vertex_array)
+        glDeleteVertexArrays(1, &vertex_array);
+    const GLuint buffers[] = { vertices, colors, indices, instance_buffer, item_buffer, command_buffer, visible_buffer };
+    for (GLuint buffer : buffers) {
+        if (buffer)
+            glDeleteBuffers(1, &buffer);
+    }
+}
+
+/**
+ * This method tells whether indirect multi-draws with a base instance are available (OpenGL 4.3,
+ * or the ARB_multi_draw_indirect and ARB_base_instance extensions).
+ */
+bool GpuCulling::supported()
+{
+    return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+}
+
+/**
+ * This method tells whether the instances can be culled by the compute shader (OpenGL 4.3).
+ */
+bool GpuCulling::computeSupported()
+{
+    return GLEW_VERSION_4_3 && program().valid();
+}
+
+/**
+ * This method tells whether objects should draw through a GpuCulling this frame.
+ */
+bool GpuCulling::available()
+{
+    return enabled && CoreRenderer::active() && supported();
+}
+
+/**
+ * This method registers a mesh and returns its index, used in the levels of add(...). Meshes
+ * without painted colors are drawn white.
+ */
+size_t GpuCulling::addMesh(const Mesh& mesh)
+{
+    meshes.push_back(&mesh);
+    meshes_dirty = instances_dirty = true;
+    return meshes.size() - 1;
+}
+
+/**
+ * This method sets the smallest screen size in pixels of each level of detail but the last,
+ * descending, like a LevelOfDetail. Without thresholds every instance uses its level 0 mesh.
+ */
+void GpuCulling::setDetail(const std::vector<float>& level_thresholds)
+{
+    thresholds = glm::vec3(0.0f);
+    for (size_t i = 0; i < level_thresholds.size() && i < max_levels - 1; ++i)
+        thresholds[static_cast<int>(i)] = level_thresholds[i];
+}
+
+/**
+ * This method adds an instance with its world space bounding sphere and the index of the mesh of
+ * each level of detail.
+ */
+void GpuCulling::add(const InstanceData& instance, const glm::vec3& center, float radius, const glm::uvec4& levels)
+{
+    instances.push_back(instance);
+    items.push_back({ glm::vec4(center, radius), levels });
+    instances_dirty = true;
+}
+
+/**
+ * This method removes all instances, keeping the meshes.
+ */
+void GpuCulling::clear()
+{
+    instances.clear();
+    items.clear();
+    instances_dirty = true;
+}
+
+/**
+ * This method culls the instances for the view of the CoreRenderer's current frame and draws the
+ * visible ones with the given material, then returns to the fixed-function pipeline. Instances
+ * whose position is max_distance or further from the eye are dropped.
+ */
+void GpuCulling::draw(const Material& material, float max_distance)
+{
+    if (meshes.empty() || instances.empty())
+        return;
+    if (meshes_dirty)
+        build();
+    if (instances_dirty)
+        upload();
+
+    const Frustum frustum(CoreRenderer::viewProjection());
+    glm::vec4 planes[6];
+    for (int i = 0; i < 6; ++i)
+        planes[i] = frustum.plane(i);
+    const float pixels_per_unit = LevelOfDetail::pixelsPerUnit() * LevelOfDetail::bias;
+    const glm::vec4 detail(thresholds, LevelOfDetail::enabled && pixels_per_unit > 0.0f ? pixels_per_unit : -1.0f);
+
+    culled_on_gpu = compute && computeSupported();
+    if (culled_on_gpu)
+        cullOnGpu(planes, CoreRenderer::eye(), max_distance, detail);
+    else
+        cullOnCpu(planes, CoreRenderer::eye(), max_distance, detail);
+
+    CoreRenderer::drawIndirect(vertex_array, command_buffer, static_cast<GLsizei>(commands.size()), material);
+    CoreRenderer::end();
+}
+
+/**
+ * This helper copies the geometry of all meshes into the shared buffers, sets up the command of
+ * each mesh and describes the buffers in the vertex array object.
+ */
+void GpuCulling::build()
+{
+    if (!vertex_array) {
+        glGenVertexArrays(1, &vertex_array);
+        GLuint* buffers[] = { &vertices, &colors, &indices, &instance_buffer, &item_buffer, &command_buffer, &visible_buffer };
+        for (GLuint* buffer : buffers)
+            glGenBuffers(1, buffer);
+    }
+
+    commands.clear();
+    GLsizei total_vertices = 0, total_indices = 0;
+    for (const Mesh* mesh : meshes) {
+        const MeshBuffer& buffer = mesh->buffers();
+        commands.push_back({ static_cast<GLuint>(buffer.indexCount()), 0, static_cast<GLuint>(total_indices), total_vertices, 0 });
+        total_vertices += buffer.vertexCount();
+        total_indices += buffer.indexCount();
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertices);
+    glBufferData(GL_COPY_WRITE_BUFFER, total_vertices * sizeof(Vertex), nullptr, GL_STATIC_DRAW);
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const MeshBuffer& buffer = meshes[i]->buffers();
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer.vertexBuffer());
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, commands[i].base_vertex * sizeof(Vertex),
+            buffer.vertexCount() * sizeof(Vertex));
+    }
+
+    // The colors follow the vertices in a mesh's vertex buffer
+    const GLsizeiptr color_size = 4 * sizeof(GLfloat);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, colors);
+    glBufferData(GL_COPY_WRITE_BUFFER, total_vertices * color_size, nullptr, GL_STATIC_DRAW);
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const MeshBuffer& buffer = meshes[i]->buffers();
+        const GLintptr offset = commands[i].base_vertex * color_size;
+        if (buffer.hasColors()) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer.vertexBuffer());
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, buffer.vertexCount() * sizeof(Vertex), offset,
+                buffer.vertexCount() * color_size);
+        }
+        else {
+            const std::vector<GLfloat> white(buffer.vertexCount() * 4, 1.0f);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, offset, buffer.vertexCount() * color_size, white.data());
+        }
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indices);
+    glBufferData(GL_COPY_WRITE_BUFFER, total_indices * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        const MeshBuffer& buffer = meshes[i]->buffers();
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer.indexBuffer());
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, commands[i].first_index * sizeof(GLuint),
+            buffer.indexCount() * sizeof(GLuint));
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // Mesh attributes 0 to 2 like MeshBuffer::bindVertexArray(), instance attributes like InstanceBuffer::bind()
+    glBindVertexArray(vertex_array);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices);
+    glBindBuffer(GL_ARRAY_BUFFER, vertices);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const GLvoid*>(offsetof(Vertex, position)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const GLvoid*>(offsetof(Vertex, normal)));
+    glBindBuffer(GL_ARRAY_BUFFER, colors);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+    const GLuint attributes[] = { InstanceBuffer::position_attribute, InstanceBuffer::scale_attribute, InstanceBuffer::tint_attribute };
+    const std::size_t offsets[] = { offsetof(InstanceData, position), offsetof(InstanceData, scale), offsetof(InstanceData, tint) };
+    glBindBuffer(GL_ARRAY_BUFFER, visible_buffer);
+    for (int i = 0; i < 3; ++i) {
+        glEnableVertexAttribArray(attributes[i]);
+        glVertexAttribPointer(attributes[i], 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), reinterpret_cast<const GLvoid*>(offsets[i]));
+        glVertexAttribDivisor(attributes[i], 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    meshes_dirty = false;
+}
+
+/**
+ * This helper reserves the visible range of every mesh, as large as the number of instances that
+ * may be drawn with it, and uploads the instances and their bounds.
+ */
+void GpuCulling::upload()
+{
+    for (Command& command : commands)
+        command.base_instance = 0;
+    for (const Item& item : items) {
+        for (int level = 0; level < max_levels; ++level) {
+            const GLuint mesh = item.levels[level];
+            bool first = true; // Count a mesh used by several levels once
+            for (int previous = 0; previous < level; ++previous)
+                first = first && item.levels[previous] != mesh;
+            if (first)
+                ++commands[mesh].base_instance;
+        }
+    }
+    GLuint reserved = 0;
+    for (Command& command : commands) {
+        const GLuint capacity = command.base_instance;
+        command.base_instance = reserved;
+        reserved += capacity;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, instance_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, instances.size() * sizeof(InstanceData), instances.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, item_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, items.size() * sizeof(Item), items.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, visible_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, reserved * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, command_buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, commands.size() * sizeof(Command), commands.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    visible.resize(reserved);
+    instances_dirty = false;
+}
+
+/**
+ * This helper resets the commands and runs the compute shader over all instances. The barrier
+ * makes its writes visible to the indirect draw and the instance attributes.
+ */
+void GpuCulling::cullOnGpu(const glm::vec4 planes[6], const glm::vec3& eye, float max_distance, const glm::vec4& detail)
+{
+    glBindBuffer(GL_COPY_WRITE_BUFFER, command_buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, commands.size() * sizeof(Command), commands.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    const ShaderProgram& shader = program();
+    shader.use();
+    glUniform4fv(shader.uniform("planes"), 6, glm::value_ptr(planes[0]));
+    glUniform4f(shader.uniform("eyeRange"), eye.x, eye.y, eye.z, max_distance);
+    glUniform4fv(shader.uniform("detail"), 1, glm::value_ptr(detail));
+    glUniform1ui(shader.uniform("instanceCount"), static_cast<GLuint>(instances.size()));
+
+    const GLuint buffers[] = { instance_buffer, item_buffer, command_buffer, visible_buffer };
+    for (GLuint binding = 0; binding < 4; ++binding)
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buffers[binding]);
+    glDispatchCompute(static_cast<GLuint>((instances.size() + 63) / 64), 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    for (GLuint binding = 0; binding < 4; ++binding)
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, 0);
+    ShaderProgram::useFixedFunction();
+}
+
+/**
+ * This helper runs the test of the compute shader on the CPU and uploads the commands and the
+ * visible instances of every mesh.
+ */
+void GpuCulling::cullOnCpu(const glm::vec4 planes[6], const glm::vec3& eye, float max_distance, const glm::vec4& detail)
+{
+    std::vector<Command> counted = commands;
+    visible_count = 0;
+    for (size_t i = 0; i < instances.size(); ++i) {
+        const InstanceData& instance = instances[i];
+        if (glm::length(glm::make_vec3(instance.position) - eye) >= max_distance)
+            continue;
+        const glm::vec3 center(items[i].sphere);
+        const float radius = items[i].sphere.w;
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; ++p)
+            inside = glm::dot(glm::vec3(planes[p]), center) + planes[p].w >= -radius;
+        if (!inside)
+            continue;
+
+        int level = 0;
+        if (detail.w >= 0.0f) {
+            const float sphere_distance = glm::length(center - eye);
+            const float size = sphere_distance <= radius ? 1e30f : 2.0f * radius * detail.w / sphere_distance;
+            while (level < max_levels - 1 && size < detail[level])
+                ++level;
+        }
+
+        Command& command = counted[items[i].levels[level]];
+        visible[command.base_instance + command.instance_count++] = instance;
+        ++visible_count;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, visible_buffer);
+    for (const Command& command : counted) {
+        if (command.instance_count > 0) {
+            glBufferSubData(GL_COPY_WRITE_BUFFER, command.base_instance * sizeof(InstanceData),
+                command.instance_count * sizeof(InstanceData), &visible[command.base_instance]);
+        }
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, command_buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, 0, counted.size() * sizeof(Command), counted.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/**
+ * This helper returns the culling compute shader, building it on first use.
+ */
+ShaderProgram& GpuCulling::program()
+{
+    static ShaderProgram shader;
+    static bool built = false;
+    if (!built && GLEW_VERSION_4_3) {
+        built = true;
+        shader.buildCompute(compute_source);
+    }
+    return shader;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+#include "Material.h"
+#include "InstanceBuffer.h"
+#include "ShaderProgram.h"
+
+/*
+GpuCulling draws many instances of a few painted meshes with one glMultiDrawElementsIndirect call.
+The meshes are copied into shared buffers, and each frame a compute shader tests every instance's
+bounding sphere against the view frustum and a distance limit, picks its level of detail and appends
+the visible instances to the indirect command of their mesh. Without compute shaders the same test
+runs on the CPU and its results are uploaded. It needs the CoreRenderer.
+*/
+class GpuCulling
+{
+public:
+	static constexpr int max_levels = 4;
+
+	GpuCulling();
+	GpuCulling(const GpuCulling&) = delete;
+	GpuCulling& operator=(const GpuCulling&) = delete;
+	~GpuCulling();
+
+	static bool supported();
+	static bool computeSupported();
+	static bool available();
+
+	size_t addMesh(const Mesh& mesh);
+	void setDetail(const std::vector<float>& thresholds);
+	void add(const InstanceData& instance, const glm::vec3& center, float radius, const glm::uvec4& levels);
+	void clear();
+	size_t size() const { return instances.size(); }
+
+	void draw(const Material& material, float max_distance);
+	bool onGpu() const { return culled_on_gpu; }
+	size_t visibleCount() const { return visible_count; } // Only counted when culled on the CPU
+
+	static bool enabled; // When false the objects draw with their CPU culling and instanced calls
+	static bool compute; // When false the instances are culled on the CPU even with compute shaders
+
+private:
+	// An indirect draw, laid out like OpenGL's DrawElementsIndirectCommand
+	struct Command {
+		GLuint count;
+		GLuint instance_count;
+		GLuint first_index;
+		GLint base_vertex;
+		GLuint base_instance;
+	};
+
+	// Bounding sphere and mesh per level of detail of an instance, laid out like the compute shader's Item
+	struct Item {
+		glm::vec4 sphere;
+		glm::uvec4 levels;
+	};
+
+	void build();
+	void upload();
+	void cullOnGpu(const glm::vec4 planes[6], const glm::vec3& eye, float max_distance, const glm::vec4& detail);
+	void cullOnCpu(const glm::vec4 planes[6], const glm::vec3& eye, float max_distance, const glm::vec4& detail);
+	static ShaderProgram& program();
+
+	std::vector<const Mesh*> meshes;
+	std::vector<Command> commands; // Per mesh, with no instances: the commands before culling
+	std::vector<InstanceData> instances;
+	std::vector<Item> items;
+	glm::vec3 thresholds; // Smallest screen sizes (pixels) of the levels but the last, descending, 0 when unused
+
+	GLuint vertex_array;
+	GLuint vertices, colors, indices; // Geometry of all meshes
+	GLuint instance_buffer, item_buffer; // Every instance
+	GLuint command_buffer, visible_buffer; // Indirect commands and the visible instances they draw
+	bool meshes_dirty, instances_dirty;
+	bool culled_on_gpu;
+	size_t visible_count;
+	std::vector<InstanceData> visible; // Scratch of the CPU path
+};
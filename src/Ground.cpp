@@ -11,31 +11,51 @@
 Ground::Ground() : start_x(-50), start_z(-50), end_x(50), end_z(50),
 color{ 0.0f, 0.39f, 0.0f, 1.0f } {} // Dark green color
 /**
- * This method draws the ground using OpenGL. The ground is drawn as a grid of quadrilaterals,
- * each quad has a material assigned (specular, shininess, ambient and diffuse components) 
+ * This method draws the ground into the given immediate batch. The ground is drawn as a grid of
+ * quadrilaterals sharing one material (specular, shininess, ambient and diffuse components)
  * that determines how it reflects light. This creates a more realistic representation of a 
- * ground surface under different lighting conditions.
+ * ground surface under different lighting conditions. The quads are drawn when the batch is flushed.
  */
-void Ground::draw()
+void Ground::draw(ImmediateBatch& batch)
 {
-    glPushMatrix();
-    glBegin(GL_QUADS);
-    glNormal3d(0, 1, 0);
-    constexpr GLfloat specular[] = { 1.0f, 1.0f, 1.0f };
-    constexpr GLfloat shininess = 128.0f;
-    glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, specular);
-    glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, shininess);
+    const Material material = { { color[0], color[1], color[2], color[3] }, { 1.0f, 1.0f, 1.0f, 1.0f }, 128.0f, false };
+    batch.material(material);
+    batch.begin(GL_QUADS);
+    batch.normal3f(0, 1, 0);
 
     for (int x = start_x; x < end_x; x++) {
         for (int z = start_z; z < end_z; z++) {
-            glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, color);
-            glVertex3d(x, 0, z);
-            glVertex3d(x + 1, 0, z);
-            glVertex3d(x + 1, 0, z + 1);
-            glVertex3d(x, 0, z + 1);
+            batch.vertex3f(x, 0, z);
+            batch.vertex3f(x + 1, 0, z);
+            batch.vertex3f(x + 1, 0, z + 1);
+            batch.vertex3f(x, 0, z + 1);
         }
     }
 
-    glEnd();
-    glPopMatrix();
+    batch.end();
+}
+
+/**
+ * This method bakes the ground grid into the static batch. The quads are the same as the ones
+ * drawn by draw(), but they are uploaded once and drawn with a single call.
+ */
+void Ground::bake(StaticBatch& batch) const
+{
+    const Material material = { { color[0], color[1], color[2], color[3] }, { 1.0f, 1.0f, 1.0f, 1.0f }, 128.0f, false };
+    Geometry& geometry = batch.group(material);
+
+    const glm::vec3 up(0.0f, 1.0f, 0.0f);
+    for (int x = start_x; x < end_x; x++) {
+        for (int z = start_z; z < end_z; z++) {
+            geometry.addQuad(glm::vec3(x, 0, z), glm::vec3(x + 1, 0, z),
+                glm::vec3(x + 1, 0, z + 1), glm::vec3(x, 0, z + 1), up);
+        }
+    }
+}
+
+/**
+ * This method returns the bounding box of the ground, a flat rectangle at height 0.
+ */
+AABB Ground::bounds() const {
+    return AABB{ glm::vec3(start_x, 0.0f, start_z), glm::vec3(end_x, 0.0f, end_z) };
 }
@@ -1,11 +1,16 @@
 #pragma once
+#include "StaticBatch.h"
+#include "ImmediateBatch.h"
+#include "Frustum.h"
 #include <GL/freeglut.h>
 
 class Ground
 {
 public:
     Ground();
-    void draw();
+    void draw(ImmediateBatch& batch);
+    void bake(StaticBatch& batch) const;
+    AABB bounds() const;
     ~Ground() = default;
 private:
     int start_x, start_z, end_x, end_z;
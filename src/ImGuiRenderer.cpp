@@ -0,0 +1,275 @@
+/**
+ * The ImGuiRenderer class replaces ImGui_ImplOpenGL2_RenderDrawData for drawing the menu.
+ *
+ * The OpenGL 2 backend draws every frame from client-side arrays, so all the menu's vertices are
+ * sent to the driver again each frame, and it saves and restores a large block of fixed-function
+ * state around the draws. Here the draw lists are merged into one vertex buffer and one index
+ * buffer: the vertices are copied list after list and the indices, which ImGui 1.63 keeps per
+ * list, are rebased to the merged vertices. Neighbouring commands with the same texture and
+ * scissor rectangle become a single draw.
+ *
+ * Most frames the menu looks the same as in the frame before. The draw data (vertices, indices,
+ * commands and display size) is hashed, and when the hash matches the one of the buffers the
+ * merge and the upload are skipped and the buffers are drawn again as they are. The buffers are
+ * respecified on upload, so the driver can hand out new storage instead of waiting for the GPU.
+ *
+ * The shader maps ImGui's pixel coordinates to clip space with a scale and an offset, modulates
+ * the vertex color with the texture, and needs no lighting, so the scene's lighting is left as it
+ * is. Only the blend, depth, cull and scissor flags the menu needs are changed, through GLState,
+ * and set back afterwards; the texture and buffer bindings are left at zero. Draw lists with user
+ * callbacks, which this renderer cannot cache, go to the OpenGL 2 backend, as does everything when
+ * shaders are not supported. The backend still creates the font texture.
+ */
+
+#include "ImGuiRenderer.h"
+#include "GLState.h"
+#include "imgui_impl_opengl2.h"
+#include <cstring>
+
+bool ImGuiRenderer::enabled = true;
+GLuint ImGuiRenderer::buffers[2] = { 0, 0 };
+std::vector<ImGuiRenderer::Batch> ImGuiRenderer::batches;
+std::vector<GLuint> ImGuiRenderer::indices;
+uint64_t ImGuiRenderer::uploaded_hash = 0;
+unsigned int ImGuiRenderer::rebuild_count = 0;
+unsigned int ImGuiRenderer::reuse_count = 0;
+
+static const GLuint position_attribute = 0;
+static const GLuint uv_attribute = 1;
+static const GLuint color_attribute = 2;
+
+static const char* const vertex_source = R"(
+#version 120
+attribute vec2 position;
+attribute vec2 uv;
+attribute vec4 color;
+uniform vec4 transform; // Scale and offset from pixels to clip space
+varying vec2 fragmentUv;
+varying vec4 fragmentColor;
+
+void main()
+{
+    fragmentUv = uv;
+    fragmentColor = color;
+    gl_Position = vec4(position * transform.xy + transform.zw, 0.0, 1.0);
+}
+)";
+
+static const char* const fragment_source = R"(
+#version 120
+uniform sampler2D image;
+varying vec2 fragmentUv;
+varying vec4 fragmentColor;
+
+void main()
+{
+    gl_FragColor = fragmentColor * texture2D(image, fragmentUv);
+}
+)";
+
+namespace {
+    /**
+     * This helper adds a block of memory to a 64-bit FNV-1a hash, four bytes at a time.
+     */
+    void mix(uint64_t& hash, const void* data, size_t size)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        size_t i = 0;
+        for (; i + 4 <= size; i += 4) {
+            uint32_t word;
+            std::memcpy(&word, bytes + i, 4);
+            hash = (hash ^ word) * 1099511628211ull;
+        }
+        for (; i < size; ++i)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+}
+
+/**
+ * This method tells whether the menu can be drawn from buffers with the shader.
+ */
+bool ImGuiRenderer::available()
+{
+    return GLEW_VERSION_2_0 && program().valid();
+}
+
+/**
+ * This method draws the draw data of the frame, uploading it first if it changed.
+ */
+void ImGuiRenderer::render(ImDrawData* draw_data)
+{
+    const ImGuiIO& io = ImGui::GetIO();
+    const int width = static_cast<int>(draw_data->DisplaySize.x * io.DisplayFramebufferScale.x);
+    const int height = static_cast<int>(draw_data->DisplaySize.y * io.DisplayFramebufferScale.y);
+    if (width <= 0 || height <= 0)
+        return;
+
+    bool callbacks = false;
+    for (int n = 0; n < draw_data->CmdListsCount && !callbacks; ++n) {
+        for (const ImDrawCmd& command : draw_data->CmdLists[n]->CmdBuffer)
+            callbacks = callbacks || command.UserCallback != nullptr;
+    }
+    if (!enabled || callbacks || !available()) {
+        // ImGui doesn't handle lighting well, so disable it around the OpenGL 2 backend.
+        GLState::disable(GL_LIGHTING);
+        ImGui_ImplOpenGL2_RenderDrawData(draw_data);
+        GLState::enable(GL_LIGHTING);
+        return;
+    }
+
+    if (GLEW_VERSION_3_0)
+        glBindVertexArray(0); // The index buffer binding belongs to the vertex array
+    if (!buffers[0])
+        glGenBuffers(2, buffers);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+
+    uint64_t current = hash(draw_data);
+    const int size[2] = { width, height };
+    mix(current, size, sizeof(size));
+    if (current != uploaded_hash) {
+        rebuild(draw_data, width, height);
+        uploaded_hash = current;
+        ++rebuild_count;
+    }
+    else {
+        ++reuse_count;
+    }
+
+    const bool blend = GLState::isEnabled(GL_BLEND);
+    const bool depth_test = GLState::isEnabled(GL_DEPTH_TEST);
+    const bool cull_face = GLState::isEnabled(GL_CULL_FACE);
+    GLState::enable(GL_BLEND);
+    GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::disable(GL_DEPTH_TEST);
+    GLState::disable(GL_CULL_FACE);
+    GLState::enable(GL_SCISSOR_TEST);
+    glViewport(0, 0, width, height);
+
+    const ShaderProgram& shader = program();
+    shader.use();
+    const ImVec2 scale(2.0f / draw_data->DisplaySize.x, -2.0f / draw_data->DisplaySize.y);
+    glUniform4f(shader.uniform("transform"), scale.x, scale.y,
+        -1.0f - draw_data->DisplayPos.x * scale.x, 1.0f - draw_data->DisplayPos.y * scale.y);
+
+    glEnableVertexAttribArray(position_attribute);
+    glEnableVertexAttribArray(uv_attribute);
+    glEnableVertexAttribArray(color_attribute);
+    glVertexAttribPointer(position_attribute, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), reinterpret_cast<const void*>(IM_OFFSETOF(ImDrawVert, pos)));
+    glVertexAttribPointer(uv_attribute, 2, GL_FLOAT, GL_FALSE, sizeof(ImDrawVert), reinterpret_cast<const void*>(IM_OFFSETOF(ImDrawVert, uv)));
+    glVertexAttribPointer(color_attribute, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ImDrawVert), reinterpret_cast<const void*>(IM_OFFSETOF(ImDrawVert, col)));
+
+    glActiveTexture(GL_TEXTURE0);
+    for (const Batch& batch : batches) {
+        glBindTexture(GL_TEXTURE_2D, batch.texture);
+        glScissor(batch.scissor[0], batch.scissor[1], batch.scissor[2], batch.scissor[3]);
+        glDrawElements(GL_TRIANGLES, batch.count, GL_UNSIGNED_INT, reinterpret_cast<const void*>(batch.first * sizeof(GLuint)));
+    }
+
+    glDisableVertexAttribArray(position_attribute);
+    glDisableVertexAttribArray(uv_attribute);
+    glDisableVertexAttribArray(color_attribute);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    ShaderProgram::useFixedFunction();
+
+    GLState::disable(GL_SCISSOR_TEST);
+    if (blend)
+        GLState::enable(GL_BLEND);
+    else
+        GLState::disable(GL_BLEND);
+    if (depth_test)
+        GLState::enable(GL_DEPTH_TEST);
+    if (cull_face)
+        GLState::enable(GL_CULL_FACE);
+}
+
+/**
+ * This helper returns the menu shader, building it on first use.
+ */
+ShaderProgram& ImGuiRenderer::program()
+{
+    static ShaderProgram shader;
+    static bool built = false;
+    if (!built && GLEW_VERSION_2_0) {
+        built = true;
+        if (shader.build(vertex_source, fragment_source, {
+            { position_attribute, "position" },
+            { uv_attribute, "uv" },
+            { color_attribute, "color" },
+        })) {
+            shader.use();
+            glUniform1i(shader.uniform("image"), 0);
+            ShaderProgram::useFixedFunction();
+        }
+    }
+    return shader;
+}
+
+/**
+ * This helper hashes what the menu looks like: the display rectangle, and the vertices, indices
+ * and commands of every draw list.
+ */
+uint64_t ImGuiRenderer::hash(const ImDrawData* draw_data)
+{
+    uint64_t result = 14695981039346656037ull;
+    mix(result, &draw_data->DisplayPos, sizeof(ImVec2));
+    mix(result, &draw_data->DisplaySize, sizeof(ImVec2));
+    for (int n = 0; n < draw_data->CmdListsCount; ++n) {
+        const ImDrawList* list = draw_data->CmdLists[n];
+        mix(result, list->VtxBuffer.Data, list->VtxBuffer.Size * sizeof(ImDrawVert));
+        mix(result, list->IdxBuffer.Data, list->IdxBuffer.Size * sizeof(ImDrawIdx));
+        for (const ImDrawCmd& command : list->CmdBuffer) {
+            mix(result, &command.ElemCount, sizeof(command.ElemCount));
+            mix(result, &command.ClipRect, sizeof(command.ClipRect));
+            mix(result, &command.TextureId, sizeof(command.TextureId));
+        }
+    }
+    return result;
+}
+
+/**
+ * This helper merges the draw lists into the bound vertex and index buffers and records the
+ * draws: one per run of visible commands sharing a texture and a scissor rectangle.
+ */
+void ImGuiRenderer::rebuild(const ImDrawData* draw_data, int framebuffer_width, int framebuffer_height)
+{
+    const ImVec2 scale = ImGui::GetIO().DisplayFramebufferScale;
+    const ImVec2 origin = draw_data->DisplayPos;
+
+    glBufferData(GL_ARRAY_BUFFER, draw_data->TotalVtxCount * sizeof(ImDrawVert), nullptr, GL_STREAM_DRAW);
+    batches.clear();
+    indices.clear();
+    indices.reserve(draw_data->TotalIdxCount);
+
+    GLuint base_vertex = 0;
+    for (int n = 0; n < draw_data->CmdListsCount; ++n) {
+        const ImDrawList* list = draw_data->CmdLists[n];
+        glBufferSubData(GL_ARRAY_BUFFER, base_vertex * sizeof(ImDrawVert), list->VtxBuffer.Size * sizeof(ImDrawVert), list->VtxBuffer.Data);
+
+        const ImDrawIdx* list_indices = list->IdxBuffer.Data;
+        for (const ImDrawCmd& command : list->CmdBuffer) {
+            const ImVec4 clip((command.ClipRect.x - origin.x) * scale.x, (command.ClipRect.y - origin.y) * scale.y,
+                (command.ClipRect.z - origin.x) * scale.x, (command.ClipRect.w - origin.y) * scale.y);
+            if (command.ElemCount > 0 && clip.x < framebuffer_width && clip.y < framebuffer_height && clip.z >= 0.0f && clip.w >= 0.0f) {
+                const Batch batch = { static_cast<GLuint>(reinterpret_cast<intptr_t>(command.TextureId)),
+                    { static_cast<GLint>(clip.x), static_cast<GLint>(framebuffer_height - clip.w),
+                      static_cast<GLint>(clip.z - clip.x), static_cast<GLint>(clip.w - clip.y) },
+                    static_cast<GLsizei>(command.ElemCount), indices.size() };
+                for (unsigned int i = 0; i < command.ElemCount; ++i)
+                    indices.push_back(base_vertex + list_indices[i]);
+
+                Batch* last = batches.empty() ? nullptr : &batches.back();
+                if (last && last->texture == batch.texture && std::memcmp(last->scissor, batch.scissor, sizeof(batch.scissor)) == 0)
+                    last->count += batch.count;
+                else
+                    batches.push_back(batch);
+            }
+            list_indices += command.ElemCount;
+        }
+        base_vertex += static_cast<GLuint>(list->VtxBuffer.Size);
+    }
+
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.empty() ? nullptr : indices.data(), GL_STREAM_DRAW);
+}
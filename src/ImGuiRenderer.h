@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <GL/glew.h>
+#include "imgui.h"
+#include "ShaderProgram.h"
+
+/*
+ImGuiRenderer draws ImGui's draw data from a vertex and an index buffer with a small shader,
+instead of the client-side arrays of the OpenGL 2 backend. The draw lists are merged and uploaded
+only when they changed since the last frame; an unchanged menu is drawn again from the buffers.
+*/
+class ImGuiRenderer
+{
+public:
+	static bool available();
+	static void render(ImDrawData* draw_data);
+
+	static unsigned int rebuilds() { return rebuild_count; }
+	static unsigned int reuses() { return reuse_count; }
+
+	static bool enabled; // When false the OpenGL 2 backend draws the menu (for comparison)
+
+private:
+	struct Batch {
+		GLuint texture;
+		GLint scissor[4];
+		GLsizei count; // Indices
+		size_t first; // First index
+	};
+
+	static ShaderProgram& program();
+	static uint64_t hash(const ImDrawData* draw_data);
+	static void rebuild(const ImDrawData* draw_data, int framebuffer_width, int framebuffer_height);
+
+	static GLuint buffers[2]; // Vertices and indices of all the draw lists
+	static std::vector<Batch> batches;
+	static std::vector<GLuint> indices; // Merged indices, rebased to the merged vertices
+	static uint64_t uploaded_hash; // Hash of the draw data in the buffers, 0 for none
+	static unsigned int rebuild_count, reuse_count;
+};
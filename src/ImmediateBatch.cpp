@@ -0,0 +1,182 @@
+/**
+ * The ImmediateBatch class is a small recording layer with the same shape as OpenGL immediate mode:
+ * begin(mode), normal3f(...), vertex3f(...), material(...), lineWidth(...) and end(). Instead of sending every vertex
+ * to the driver, the vertices are collected on the CPU. Strips, fans, loops and polygons are converted
+ * into independent lines or triangles, so that consecutive primitives with the same state can be
+ * merged into one run. flush() draws every run with a single glDrawArrays call and clears the batch.
+ *
+ * As with glMaterial inside glBegin/glEnd, the material is sampled per primitive: the material that is
+ * current when end() is called is used for the whole primitive. The line width is recorded the same
+ * way and set only around the line runs it applies to, so it does not leak into later draws.
+ */
+
+#include "ImmediateBatch.h"
+#include "GLState.h"
+#include <cstddef> // For offsetof
+
+/**
+ * The default constructor starts with an upward normal, a plain grey material and 1 pixel lines.
+ */
+ImmediateBatch::ImmediateBatch() : current_mode(GL_TRIANGLES), recording(false),
+    current_normal{ 0.0f, 1.0f, 0.0f },
+    current_material{ { 0.8f, 0.8f, 0.8f, 1.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, 0.0f, false }, current_line_width(1.0f) {}
+
+/**
+ * This method starts recording a primitive of the given type (any glBegin mode).
+ */
+void ImmediateBatch::begin(GLenum mode)
+{
+    current_mode = mode;
+    recording = true;
+    primitive.clear();
+}
+
+/**
+ * This method sets the normal used by the following vertices, like glNormal3f.
+ */
+void ImmediateBatch::normal3f(GLfloat x, GLfloat y, GLfloat z)
+{
+    current_normal[0] = x;
+    current_normal[1] = y;
+    current_normal[2] = z;
+}
+
+/**
+ * This method records a vertex with the current normal, like glVertex3f.
+ */
+void ImmediateBatch::vertex3f(GLfloat x, GLfloat y, GLfloat z)
+{
+    if (!recording)
+        return;
+    Vertex vertex = { { x, y, z }, { current_normal[0], current_normal[1], current_normal[2] } };
+    primitive.push_back(vertex);
+}
+
+/**
+ * This method sets the material of the primitives that are ended from now on.
+ */
+void ImmediateBatch::material(const Material& material)
+{
+    current_material = material;
+}
+
+/**
+ * This method sets the width of the lines that are ended from now on, like glLineWidth.
+ */
+void ImmediateBatch::lineWidth(GLfloat width)
+{
+    current_line_width = width;
+}
+
+/**
+ * This method ends the current primitive and converts it into a list of independent primitives.
+ */
+void ImmediateBatch::end()
+{
+    if (!recording)
+        return;
+    recording = false;
+
+    const GLuint n = static_cast<GLuint>(primitive.size());
+    std::vector<GLuint> order;
+
+    switch (current_mode) {
+    case GL_POINTS:
+    case GL_LINES:
+    case GL_TRIANGLES:
+    case GL_QUADS: {
+        // Already independent, only drop an incomplete trailing primitive
+        const GLuint size = current_mode == GL_POINTS ? 1 : current_mode == GL_LINES ? 2 : current_mode == GL_TRIANGLES ? 3 : 4;
+        for (GLuint i = 0; i < n - n % size; ++i)
+            order.push_back(i);
+        append(current_mode, order);
+        break;
+    }
+    case GL_LINE_STRIP:
+    case GL_LINE_LOOP:
+        for (GLuint i = 0; i + 1 < n; ++i)
+            order.insert(order.end(), { i, i + 1 });
+        if (current_mode == GL_LINE_LOOP && n > 2)
+            order.insert(order.end(), { n - 1, 0 });
+        append(GL_LINES, order);
+        break;
+    case GL_TRIANGLE_STRIP:
+        for (GLuint i = 0; i + 2 < n; ++i) {
+            // Every other triangle of a strip is flipped to keep a consistent winding
+            if (i % 2 == 0)
+                order.insert(order.end(), { i, i + 1, i + 2 });
+            else
+                order.insert(order.end(), { i + 1, i, i + 2 });
+        }
+        append(GL_TRIANGLES, order);
+        break;
+    case GL_QUAD_STRIP:
+        for (GLuint i = 0; i + 3 < n; i += 2)
+            order.insert(order.end(), { i, i + 1, i + 3, i, i + 3, i + 2 });
+        append(GL_TRIANGLES, order);
+        break;
+    case GL_TRIANGLE_FAN:
+    case GL_POLYGON:
+        for (GLuint i = 1; i + 1 < n; ++i)
+            order.insert(order.end(), { 0, i, i + 1 });
+        append(GL_TRIANGLES, order);
+        break;
+    default:
+        break;
+    }
+
+    primitive.clear();
+}
+
+/**
+ * This method appends the vertices of a converted primitive, extending the last run when
+ * its primitive type, material and line width match.
+ */
+void ImmediateBatch::append(GLenum mode, const std::vector<GLuint>& order)
+{
+    if (order.empty())
+        return;
+
+    const GLfloat width = mode == GL_LINES ? current_line_width : 1.0f;
+    if (runs.empty() || runs.back().mode != mode || runs.back().material != current_material || runs.back().line_width != width)
+        runs.push_back(Run{ mode, current_material, width, static_cast<GLint>(vertices.size()), 0 });
+
+    for (GLuint index : order)
+        vertices.push_back(primitive[index]);
+    runs.back().count += static_cast<GLsizei>(order.size());
+}
+
+/**
+ * This method draws all recorded runs from client-side vertex arrays and clears the batch.
+ * Blended materials enable GL_BLEND, and wide lines set the line width, for the duration of their run.
+ */
+void ImmediateBatch::flush()
+{
+    if (runs.empty())
+        return;
+
+    const GLubyte* base = reinterpret_cast<const GLubyte*>(vertices.data());
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(Vertex), base + offsetof(Vertex, position));
+    glNormalPointer(GL_FLOAT, sizeof(Vertex), base + offsetof(Vertex, normal));
+
+    for (const Run& run : runs) {
+        if (run.material.blend)
+            GLState::enable(GL_BLEND);
+        if (run.line_width != 1.0f)
+            glLineWidth(run.line_width);
+        run.material.apply();
+        glDrawArrays(run.mode, run.first, run.count);
+        if (run.line_width != 1.0f)
+            glLineWidth(1.0f);
+        if (run.material.blend)
+            GLState::disable(GL_BLEND);
+    }
+
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    vertices.clear();
+    runs.clear();
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+#include "Geometry.h"
+#include "Material.h"
+
+/*
+ImmediateBatch records glBegin/glEnd style drawing into CPU vertex arrays. Consecutive primitives
+sharing the same primitive type and material are merged, and flush() draws them with a few
+glDrawArrays calls instead of one driver call per vertex.
+*/
+class ImmediateBatch
+{
+public:
+	ImmediateBatch();
+	void begin(GLenum mode);
+	void normal3f(GLfloat x, GLfloat y, GLfloat z);
+	void vertex3f(GLfloat x, GLfloat y, GLfloat z);
+	void material(const Material& material);
+	void lineWidth(GLfloat width);
+	void end();
+	void flush();
+	size_t runCount() const { return runs.size(); }
+
+private:
+	struct Run {
+		GLenum mode;
+		Material material;
+		GLfloat line_width;
+		GLint first;
+		GLsizei count;
+	};
+
+	void append(GLenum mode, const std::vector<GLuint>& order);
+
+	GLenum current_mode;
+	bool recording;
+	GLfloat current_normal[3];
+	Material current_material;
+	GLfloat current_line_width;
+	std::vector<Vertex> primitive;
+	std::vector<Vertex> vertices;
+	std::vector<Run> runs;
+};
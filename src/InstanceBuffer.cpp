@@ -0,0 +1,150 @@
+/**
+ * The InstanceBuffer class stores the per-instance data of an instanced mesh (position, rotation,
+ * scale and tint) and keeps a GPU copy of it for glDrawElementsInstanced.
+ *
+ * Instances are kept packed: remove(...) moves the last instance into the freed slot, so only two
+ * instances change. Every change extends a dirty range, and sync() uploads just that range with
+ * glBufferSubData. The buffer grows by doubling, in which case everything is uploaded once.
+ */
+
+#include "InstanceBuffer.h"
+#include <algorithm>
+#include <cstddef> // For offsetof
+
+static_assert(sizeof(InstanceData) == 12 * sizeof(GLfloat), "InstanceData must be tightly packed");
+
+InstanceBuffer::InstanceBuffer() : buffer(0), capacity(0), dirty_begin(0), dirty_end(0) {}
+
+InstanceBuffer::~InstanceBuffer()
+{
+    if (buffer)
+        glDeleteBuffers(1, &buffer);
+}
+
+/**
+ * This method tells whether instanced arrays and instanced draws are available (OpenGL 3.3).
+ */
+bool InstanceBuffer::supported()
+{
+    return GLEW_VERSION_3_3 != 0;
+}
+
+/**
+ * This method appends an instance and returns its slot.
+ */
+size_t InstanceBuffer::add(const InstanceData& instance)
+{
+    instances.push_back(instance);
+    markDirty(instances.size() - 1, instances.size());
+    return instances.size() - 1;
+}
+
+/**
+ * This method removes the instance in the given slot by moving the last instance into it.
+ * It returns the previous slot of the moved instance, which equals the removed slot when the
+ * last instance itself was removed.
+ */
+size_t InstanceBuffer::remove(size_t slot)
+{
+    const size_t last = instances.size() - 1;
+    if (slot != last) {
+        instances[slot] = instances[last];
+        markDirty(slot, slot + 1);
+    }
+    instances.pop_back();
+
+    // The removed tail does not need uploading
+    dirty_end = std::min(dirty_end, instances.size());
+    if (dirty_end <= dirty_begin)
+        dirty_begin = dirty_end = 0;
+    return last;
+}
+
+/**
+ * This method replaces the data of an instance.
+ */
+void InstanceBuffer::set(size_t slot, const InstanceData& instance)
+{
+    instances[slot] = instance;
+    markDirty(slot, slot + 1);
+}
+
+/**
+ * This method removes all instances. The GPU buffer is kept for the instances added next.
+ */
+void InstanceBuffer::clear()
+{
+    instances.clear();
+    dirty_begin = dirty_end = 0;
+}
+
+/**
+ * This method uploads the instances changed since the last call.
+ */
+void InstanceBuffer::sync()
+{
+    if (!buffer)
+        glGenBuffers(1, &buffer);
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (instances.size() > capacity) {
+        // Grow the buffer and upload everything
+        capacity = std::max<size_t>(instances.size(), capacity * 2);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(InstanceData), nullptr, GL_DYNAMIC_DRAW);
+        dirty_begin = 0;
+        dirty_end = instances.size();
+    }
+    if (dirty_begin < dirty_end) {
+        glBufferSubData(GL_ARRAY_BUFFER, dirty_begin * sizeof(InstanceData),
+            (dirty_end - dirty_begin) * sizeof(InstanceData), &instances[dirty_begin]);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    dirty_begin = dirty_end = 0;
+}
+
+/**
+ * This method binds the instance attributes, starting at the given instance, with a divisor of one.
+ */
+void InstanceBuffer::bind(size_t first) const
+{
+    const std::size_t base = first * sizeof(InstanceData);
+    const GLuint attributes[] = { position_attribute, scale_attribute, tint_attribute };
+    const std::size_t offsets[] = { offsetof(InstanceData, position), offsetof(InstanceData, scale), offsetof(InstanceData, tint) };
+
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (int i = 0; i < 3; ++i) {
+        glEnableVertexAttribArray(attributes[i]);
+        glVertexAttribPointer(attributes[i], 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+            reinterpret_cast<const GLvoid*>(base + offsets[i]));
+        glVertexAttribDivisor(attributes[i], 1);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * This method disables the instance attributes.
+ */
+void InstanceBuffer::unbind() const
+{
+    const GLuint attributes[] = { position_attribute, scale_attribute, tint_attribute };
+    for (GLuint attribute : attributes) {
+        glVertexAttribDivisor(attribute, 0);
+        glDisableVertexAttribArray(attribute);
+    }
+}
+
+/**
+ * This helper extends the dirty range to cover [begin, end).
+ */
+void InstanceBuffer::markDirty(size_t begin, size_t end)
+{
+    if (dirty_begin == dirty_end) {
+        dirty_begin = begin;
+        dirty_end = end;
+    }
+    else {
+        dirty_begin = std::min(dirty_begin, begin);
+        dirty_end = std::max(dirty_end, end);
+    }
+}
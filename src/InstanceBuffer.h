@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+
+/*
+Per-instance data of an instanced mesh: placement on the meadow, rotation about the Y axis,
+scale and a color tint multiplied with the mesh colors.
+*/
+struct InstanceData
+{
+	GLfloat position[3];
+	GLfloat rotation; // Radians about the Y axis
+	GLfloat scale[3];
+	GLfloat padding;
+	GLfloat tint[4];
+};
+
+/*
+InstanceBuffer keeps a CPU copy of the instance data and mirrors it into a GPU buffer. Only the
+range of instances changed since the last sync() is uploaded again.
+*/
+class InstanceBuffer
+{
+public:
+	static constexpr GLuint position_attribute = 5;
+	static constexpr GLuint scale_attribute = 6;
+	static constexpr GLuint tint_attribute = 7;
+
+	InstanceBuffer();
+	InstanceBuffer(const InstanceBuffer&) = delete;
+	InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+	~InstanceBuffer();
+
+	static bool supported();
+
+	size_t add(const InstanceData& instance);
+	size_t remove(size_t slot);
+	void set(size_t slot, const InstanceData& instance);
+	void clear();
+	const InstanceData& get(size_t slot) const { return instances[slot]; }
+	size_t size() const { return instances.size(); }
+
+	void sync();
+	void bind(size_t first = 0) const;
+	void unbind() const;
+
+private:
+	void markDirty(size_t begin, size_t end);
+
+	std::vector<InstanceData> instances;
+	GLuint buffer;
+	size_t capacity;
+	size_t dirty_begin;
+	size_t dirty_end;
+};
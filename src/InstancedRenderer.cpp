@@ -0,0 +1,164 @@
+/**
+ * The InstancedRenderer class holds the shader used to draw many copies of a mesh in one call.
+ * The mesh is read through the usual vertex, normal and color arrays (gl_Vertex, gl_Normal, gl_Color),
+ * while the instance position, rotation, scale and tint come from an InstanceBuffer with a divisor
+ * of one. The vertex shader reproduces the fixed-function lighting of the enabled lights, so instanced
+ * objects look the same as objects drawn one by one. Instances can fade out with the distance,
+ * by a screen-door dither in the fragment shader.
+ */
+
+#include "InstancedRenderer.h"
+#include "CoreRenderer.h"
+#include <algorithm>
+
+Material InstancedRenderer::material = { { 1.0f, 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, 0.0f, false };
+
+static const char* const vertex_body = R"(
+attribute vec4 instancePositionRotation;
+attribute vec4 instanceScale;
+attribute vec4 instanceTint;
+uniform vec2 fadeOut; // Distance where instances start to fade out and 1 / fade length, 0 for no fade
+varying vec4 litColor;
+varying float meshAlpha;
+
+vec3 rotateY(vec3 v, float c, float s)
+{
+    return vec3(c * v.x + s * v.z, v.y, -s * v.x + c * v.z);
+}
+
+void main()
+{
+    float c = cos(instancePositionRotation.w);
+    float s = sin(instancePositionRotation.w);
+    vec3 world = rotateY(gl_Vertex.xyz * instanceScale.xyz, c, s) + instancePositionRotation.xyz;
+    vec3 normal = rotateY(gl_Normal / instanceScale.xyz, c, s);
+
+    vec4 eye = gl_ModelViewMatrix * vec4(world, 1.0);
+    vec4 albedo = gl_Color * instanceTint;
+    litColor = fixedLighting(eye.xyz, normalize(gl_NormalMatrix * normal), albedo, albedo,
+        gl_FrontMaterial.specular, gl_FrontMaterial.shininess);
+    gl_Position = gl_ProjectionMatrix * eye;
+    meshAlpha = 1.0;
+    if (fadeOut.y > 0.0) {
+        float distance = length((gl_ModelViewMatrix * vec4(instancePositionRotation.xyz, 1.0)).xyz);
+        meshAlpha = 1.0 - clamp((distance - fadeOut.x) * fadeOut.y, 0.0, 1.0);
+    }
+}
+)";
+
+static const char* const fragment_body = R"(
+varying vec4 litColor;
+varying float meshAlpha;
+
+void main()
+{
+    if (meshAlpha < 1.0 && screenDoor(gl_FragCoord.xy) >= meshAlpha)
+        discard;
+    gl_FragColor = litColor;
+}
+)";
+
+/**
+ * This method tells whether instanced drawing is supported and the shader could be built.
+ */
+bool InstancedRenderer::available()
+{
+    return InstanceBuffer::supported() && (CoreRenderer::active() || program().valid());
+}
+
+/**
+ * This method applies the material of the following draws, binds the instancing shader and passes
+ * it the enabled state of the lights.
+ */
+void InstancedRenderer::begin(const Material& instance_material)
+{
+    material = instance_material;
+    if (CoreRenderer::active())
+        return;
+
+    material.apply();
+    const ShaderProgram& shader = program();
+    shader.use();
+    shader.uploadLightState();
+    glUniform2f(shader.uniform("fadeOut"), 0.0f, 0.0f);
+}
+
+/**
+ * This method uploads the changed instances and draws the mesh once per instance.
+ */
+void InstancedRenderer::draw(const Mesh& mesh, InstanceBuffer& instances)
+{
+    draw(mesh, instances, 0, instances.size());
+}
+
+/**
+ * This method uploads the changed instances and draws the mesh once per instance in the
+ * range [first, first + count).
+ */
+void InstancedRenderer::draw(const Mesh& mesh, InstanceBuffer& instances, size_t first, size_t count)
+{
+    if (count == 0)
+        return;
+    if (CoreRenderer::active()) {
+        CoreRenderer::drawInstanced(mesh, instances, first, count, material);
+        return;
+    }
+
+    instances.sync();
+    instances.bind(first);
+    mesh.drawInstanced(static_cast<GLsizei>(count));
+    instances.unbind();
+}
+
+/**
+ * This method fades the instances of the following draws out with the distance from the eye: fully
+ * drawn at 'start', gone at 'start + length'. It lasts until the next begin().
+ */
+void InstancedRenderer::fadeOut(float start, float length)
+{
+    if (CoreRenderer::active()) {
+        CoreRenderer::fadeOut(start, length);
+        return;
+    }
+    glUniform2f(program().uniform("fadeOut"), start, 1.0f / std::max(length, 0.01f));
+}
+
+/**
+ * This method returns to the fixed-function pipeline.
+ */
+void InstancedRenderer::end()
+{
+    if (CoreRenderer::active())
+        CoreRenderer::end();
+    ShaderProgram::useFixedFunction();
+}
+
+/**
+ * This method passes the lights enabled since begin() to the shader, for draws lit by different
+ * local lights.
+ */
+void InstancedRenderer::updateLights()
+{
+    if (!CoreRenderer::active())
+        program().uploadLightState();
+}
+
+/**
+ * This method returns the instancing shader, building it on first use.
+ */
+ShaderProgram& InstancedRenderer::program()
+{
+    static ShaderProgram shader;
+    static bool built = false;
+    if (!built && InstanceBuffer::supported()) {
+        built = true;
+        const std::string vertex_source = std::string("#version 120\n") + ShaderProgram::fixedFunctionLighting() + vertex_body;
+        const std::string fragment_source = std::string("#version 120\n") + ShaderProgram::screenDoor() + fragment_body;
+        shader.build(vertex_source.c_str(), fragment_source.c_str(), {
+            { InstanceBuffer::position_attribute, "instancePositionRotation" },
+            { InstanceBuffer::scale_attribute, "instanceScale" },
+            { InstanceBuffer::tint_attribute, "instanceTint" },
+        });
+    }
+    return shader;
+}
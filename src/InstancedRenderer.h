@@ -0,0 +1,28 @@
+#pragma once
+#include <GL/glew.h>
+#include "Mesh.h"
+#include "InstanceBuffer.h"
+#include "ShaderProgram.h"
+#include "Material.h"
+
+/*
+InstancedRenderer draws a Mesh once per entry of an InstanceBuffer with a single
+glDrawElementsInstanced call, lit like the fixed-function pipeline. When the CoreRenderer is
+active the draws go through its program instead.
+*/
+class InstancedRenderer
+{
+public:
+	static bool available();
+	static void begin(const Material& material);
+	static void draw(const Mesh& mesh, InstanceBuffer& instances);
+	static void draw(const Mesh& mesh, InstanceBuffer& instances, size_t first, size_t count);
+	static void fadeOut(float start, float length);
+	static void end();
+	static void updateLights();
+
+private:
+	static ShaderProgram& program();
+
+	static Material material; // Material of the draws since begin()
+};
@@ -10,6 +10,7 @@
 
 
 #include "Lake.h"
+#include <algorithm>
 /**
  * The default constructor initializes the Lake object with a specific starting and ending points
  * on the X and Z axes, and sets its color to semi-transparent blue.
@@ -18,51 +19,66 @@ Lake::Lake() :start_x(0), start_z(50), end_x(-50), end_z(0),
     y(0.1), color{ 0.0f, 0.4f, 1.0f, 0.7f } {} // Semi-transparent blue color
 
 /**
- * This method draws the lake using OpenGL. It also enables blending for semi-transparency effect,
- * and sets the material color to blue. The lake is drawn as a quadrilateral (quad) defined 
- * by the start and end points.
+ * This method draws the lake into the given immediate batch. The material color is set to blue
+ * and marked as blended, so the batch enables blending for the semi-transparency effect when it
+ * is flushed. The lake is drawn as a quadrilateral (quad) defined by the start and end points.
  *
- * After the lake is drawn, blending is disabled and the border of the lake is drawn by 
- * calling the drawBorder method.
+ * After the lake is drawn, the border of the lake is drawn by calling the drawBorder method.
  */
-void Lake::draw() {
-    glPushMatrix();
-    glEnable(GL_BLEND); // Enable blending
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Set blending function
+void Lake::draw(ImmediateBatch& batch) {
+    const Material blue = { { 0.0f, 0.0f, 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f }, 128.0f, true }; // Blue color
+    batch.material(blue);
 
-    constexpr GLfloat blue[] = {0.0f, 0.0f, 1.0f, 1.0f}; // Blue color
-    glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, blue); // Set the material color to blue
+    batch.begin(GL_QUADS);
+    batch.normal3f(0.0f, 1.0f, 0.0f);
+    batch.vertex3f(start_x, y, start_z);
+    batch.vertex3f(end_x, y, start_z);
+    batch.vertex3f(end_x, y, end_z);
+    batch.vertex3f(start_x, y, end_z);
+    batch.end();
 
-    glBegin(GL_QUADS);
-    glVertex3f(start_x, y, start_z);
-    glVertex3f(end_x, y, start_z);
-    glVertex3f(end_x, y, end_z);
-    glVertex3f(start_x, y, end_z);
-    glEnd();
+    drawBorder(batch);
+}
+/**
+ * This method draws the border of the lake into the given immediate batch. The border is drawn
+ * as a line loop with a defined color (brown) and a set line width.
+ */
+void Lake::drawBorder(ImmediateBatch& batch) {
+    const Material brown = { { 0.6f, 0.3f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f }, 128.0f, false }; // Brown color
+    batch.material(brown);
 
-    glDisable(GL_BLEND); // Disable blending
-    glPopMatrix();
+    batch.lineWidth(3.0f); // Set line width
 
-    drawBorder();
+    batch.begin(GL_LINE_LOOP);
+    batch.vertex3f(start_x, y, start_z);
+    batch.vertex3f(end_x, y, start_z);
+    batch.vertex3f(end_x, y, end_z);
+    batch.vertex3f(start_x, y, end_z);
+    batch.end();
+    batch.lineWidth(1.0f);
 }
+
 /**
- * This method draws the border of the lake using OpenGL. The border is drawn as a line loop
- * with a defined color (brown) and a set line width.
+ * This method bakes the lake into the static batch: the surface goes into a blended group,
+ * which the batch draws after all opaque geometry, and the border into a line group of width 3.
  */
-void Lake::drawBorder() {
-    glPushMatrix();
+void Lake::bake(StaticBatch& batch) const {
+    const std::vector<glm::vec3> corners = {
+        glm::vec3(start_x, y, start_z), glm::vec3(end_x, y, start_z),
+        glm::vec3(end_x, y, end_z), glm::vec3(start_x, y, end_z)
+    };
 
-    constexpr GLfloat brown[] = {0.6f, 0.3f, 0.0f, 1.0f}; // Brown color
-    glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, brown); // Set the material color to brown
+    const Material water = { { 0.0f, 0.0f, 1.0f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f }, 128.0f, true };
+    batch.group(water).addQuad(corners[0], corners[1], corners[2], corners[3], glm::vec3(0.0f, 1.0f, 0.0f));
 
-    glLineWidth(3.0); // Set line width
-
-    glBegin(GL_LINE_LOOP);
-    glVertex3f(start_x, y, start_z);
-    glVertex3f(end_x, y, start_z);
-    glVertex3f(end_x, y, end_z);
-    glVertex3f(start_x, y, end_z);
-    glEnd();
+    const Material brown = { { 0.6f, 0.3f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f }, 128.0f, false };
+    batch.group(brown, GL_LINES, 3.0f).addLineLoop(corners);
+}
 
-    glPopMatrix();
+/**
+ * This method returns the bounding box of the lake surface and its border.
+ */
+AABB Lake::bounds() const {
+    return AABB{ glm::vec3(std::min(start_x, end_x), y, std::min(start_z, end_z)),
+        glm::vec3(std::max(start_x, end_x), y, std::max(start_z, end_z)) };
 }
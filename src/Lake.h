@@ -1,4 +1,7 @@
 ﻿#pragma once
+#include "StaticBatch.h"
+#include "ImmediateBatch.h"
+#include "Frustum.h"
 #include <GL/glut.h>
 
 class Lake {
@@ -8,7 +11,9 @@ public:
     GLfloat color[4]; // The color of the lake
 
     Lake();
-    void draw();
-    void Lake::drawBorder();
+    void draw(ImmediateBatch& batch);
+    void Lake::drawBorder(ImmediateBatch& batch);
+    void bake(StaticBatch& batch) const;
+    AABB bounds() const;
 
 };
\ No newline at end of file
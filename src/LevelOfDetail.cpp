@@ -0,0 +1,81 @@
+/**
+ * The LevelOfDetail class selects how detailed an object is drawn. An object is described by a
+ * bounding sphere, whose projected diameter in pixels is compared with the thresholds of its levels:
+ * level i is used while the diameter is at least thresholds[i], and the last level below them all.
+ *
+ * To avoid popping, an object only moves to a coarser level once it is smaller than the threshold
+ * by the hysteresis fraction, and to a finer one once it is larger by that fraction. The global bias
+ * scales every screen size, so a single number trades detail for speed across the whole scene, and
+ * the detail of an instance scales the screen sizes of that object only.
+ *
+ * beginFrame() takes the matrices of the frame; select() may then be called once per object.
+ */
+
+#include "LevelOfDetail.h"
+#include <algorithm>
+
+bool LevelOfDetail::enabled = true;
+float LevelOfDetail::bias = 1.0f;
+float LevelOfDetail::hysteresis = 0.15f;
+glm::mat4 LevelOfDetail::view(1.0f);
+glm::vec3 LevelOfDetail::eye_position(0.0f);
+float LevelOfDetail::pixels_per_unit = 0.0f;
+unsigned LevelOfDetail::selection_counts[LevelOfDetail::max_levels] = {};
+
+LevelOfDetail::LevelOfDetail() : current(0) {}
+
+LevelOfDetail::LevelOfDetail(const std::vector<float>& thresholds) : thresholds(thresholds), current(0)
+{
+    if (this->thresholds.size() >= max_levels)
+        this->thresholds.resize(max_levels - 1);
+}
+
+/**
+ * This method sets the view and projection of the frame and clears the selection counters.
+ */
+void LevelOfDetail::beginFrame(const glm::mat4& view_matrix, const glm::mat4& projection, float viewport_height)
+{
+    view = view_matrix;
+    eye_position = glm::vec3(glm::inverse(view_matrix)[3]);
+    pixels_per_unit = projection[1][1] * viewport_height * 0.5f;
+    std::fill(selection_counts, selection_counts + max_levels, 0u);
+}
+
+/**
+ * This method returns the projected diameter in pixels of a sphere, scaled by the bias.
+ * A sphere reaching the camera plane, or any sphere before the first frame, is infinitely large.
+ */
+float LevelOfDetail::screenSize(const glm::vec3& center, float radius)
+{
+    const float distance = -(view * glm::vec4(center, 1.0f)).z;
+    if (pixels_per_unit <= 0.0f || distance <= radius)
+        return 1e30f;
+    return 2.0f * radius * pixels_per_unit / distance * bias;
+}
+
+/**
+ * This method selects the level of the object for this frame and returns it.
+ */
+int LevelOfDetail::select(const glm::vec3& center, float radius)
+{
+    if (!enabled || thresholds.empty()) {
+        current = 0;
+    }
+    else {
+        const float size = screenSize(center, radius) * detail;
+        const int count = static_cast<int>(thresholds.size());
+
+        int target = 0;
+        while (target < count && size < thresholds[target])
+            ++target;
+
+        // Only step past a threshold by more than the hysteresis band
+        while (target < current && size < thresholds[target] * (1.0f + hysteresis))
+            ++target;
+        while (target > current && size >= thresholds[target - 1] * (1.0f - hysteresis))
+            --target;
+        current = target;
+    }
+    ++selection_counts[current];
+    return current;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+/*
+LevelOfDetail picks one of several detail levels of an object per frame from the object's size on
+screen. Level 0 is the most detailed. Each object keeps its own instance, which remembers the level of
+the previous frame so that an object near a threshold does not pop between two levels.
+*/
+class LevelOfDetail
+{
+public:
+	static constexpr int max_levels = 8;
+
+	LevelOfDetail();
+	explicit LevelOfDetail(const std::vector<float>& thresholds);
+
+	int select(const glm::vec3& center, float radius);
+	int level() const { return current; }
+	int levelCount() const { return static_cast<int>(thresholds.size()) + 1; }
+
+	static void beginFrame(const glm::mat4& view, const glm::mat4& projection, float viewport_height);
+	static float screenSize(const glm::vec3& center, float radius);
+	static const glm::vec3& eye() { return eye_position; }
+	static float pixelsPerUnit() { return pixels_per_unit; }
+	static unsigned selections(int level) { return level < max_levels ? selection_counts[level] : 0; }
+
+	float detail = 1.0f; // Multiplies this object's screen sizes, on top of the global bias
+
+	static bool enabled; // When false every object is drawn at level 0
+	static float bias; // Multiplies the screen sizes: above 1 keeps more detail, below 1 less
+	static float hysteresis; // Fraction of a threshold an object must pass it by to change level
+
+private:
+	std::vector<float> thresholds; // Smallest screen size (pixels) of each level but the last, descending
+	int current;
+
+	static glm::mat4 view;
+	static glm::vec3 eye_position; // Camera position of the frame in world coordinates
+	static float pixels_per_unit; // Screen height in pixels of one unit at distance one
+	static unsigned selection_counts[max_levels];
+};
@@ -0,0 +1,427 @@
+/**
+ * The LightManager class implements clustered lighting for the local lights of the scene.
+ *
+ * The view frustum is split into 16 x 9 screen tiles and 24 depth slices. The slices are spaced
+ * exponentially between the near and far planes, so a slice is about as deep as it is wide on
+ * screen. Each frame every light is transformed to eye space, the screen rectangle and the depth
+ * range of its sphere of influence give the clusters it may reach, and each of those clusters is
+ * kept when its view-space box really intersects the sphere. The lists are then packed with a
+ * counting sort: per cluster an offset and a count, and one array of light indices for all of them.
+ *
+ * The ranges, indices and eye-space light data are uploaded into three buffer textures, which
+ * CoreRenderer reads in its fragment shader. A pixel finds its cluster from its window position
+ * and depth and only loops over that cluster's lights, so the cost of shading follows the number
+ * of lights reaching a pixel, not the number of lights in the scene.
+ *
+ * The fixed-function pipeline has eight lights, two of them taken by the scene's point light and
+ * spotlight. pack() copies the lights into batches of four, component by component, and for every
+ * object select() scores four lights at a time against the object's bounding sphere: the light's
+ * brightness times its fade at the sphere's nearest point, and zero when the sphere is out of range
+ * or outside a spotlight's cone. apply() binds the best six to GL_LIGHT2..GL_LIGHT7, keeping a light
+ * in the slot it already has this frame, so objects sharing lights issue no light calls at all.
+ * A draw spread over the whole meadow has no nearest lights: release() switches the slots off for
+ * it, rather than lighting all of it with the same six.
+ * Fixed-function attenuation cannot reach zero at the radius; 1 / (1 + 2 d/r + 8 (d/r)^2) is used,
+ * which is down to a tenth at the radius.
+ *
+ * A light limit caps both the cluster lists and the lights bound per object, trading lighting
+ * quality for speed. A full cluster keeps the lights added first, that is the lanterns before the
+ * fireflies.
+ */
+
+#include "LightManager.h"
+#include "GLState.h"
+#include "Simd.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/type_ptr.hpp>
+
+static constexpr uint32_t no_light = 0xffffffffu;
+
+LightManager::LightManager() : ranges(cluster_count, glm::uvec2(0)), cluster_scale(0.0f), max_per_cluster(0),
+    buffers{ 0, 0, 0 }, textures{ 0, 0, 0 }, packed_view(1.0f), rebinds(0), last_rebinds(0)
+{
+    std::fill(bound, bound + fixed_light_count, no_light);
+}
+
+LightManager::~LightManager()
+{
+    if (textures[0]) {
+        glDeleteTextures(3, textures);
+        glDeleteBuffers(3, buffers);
+    }
+}
+
+/**
+ * This method tells whether buffer textures (OpenGL 3.1) are available to hold the cluster lists.
+ */
+bool LightManager::supported()
+{
+    return GLEW_VERSION_3_1 != 0;
+}
+
+/**
+ * This method adds a point light that fades out at the given radius and returns its index.
+ */
+size_t LightManager::addPoint(const glm::vec3& position, const glm::vec3& color, float radius)
+{
+    lights.push_back({ position, radius, color, 0.0f, glm::vec3(0.0f, -1.0f, 0.0f), 180.0f });
+    return lights.size() - 1;
+}
+
+/**
+ * This method adds a spotlight that fades out at the given radius and returns its index.
+ */
+size_t LightManager::addSpot(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& color, float radius, float cutoff, float exponent)
+{
+    lights.push_back({ position, radius, color, exponent, glm::normalize(direction), cutoff });
+    return lights.size() - 1;
+}
+
+/**
+ * This method bins the lights into the clusters of the given view and uploads the result.
+ */
+void LightManager::update(const glm::mat4& view, const glm::mat4& projection, float viewport_width, float viewport_height)
+{
+    assign(view, projection, viewport_width, viewport_height);
+    upload();
+}
+
+/**
+ * This method binds the ranges, indices and light data to three texture units from first_unit.
+ */
+void LightManager::bind(GLuint first_unit) const
+{
+    for (int i = 0; i < 3; ++i) {
+        glActiveTexture(GL_TEXTURE0 + first_unit + i);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+/**
+ * This helper finds the clusters every light reaches and builds the packed cluster lists.
+ * The projection must be a perspective one, like the scene's.
+ */
+void LightManager::assign(const glm::mat4& view, const glm::mat4& projection, float viewport_width, float viewport_height)
+{
+    const float near_depth = projection[3][2] / (projection[2][2] - 1.0f);
+    const float far_depth = projection[3][2] / (projection[2][2] + 1.0f);
+    const float log_ratio = std::log(far_depth / near_depth);
+    cluster_scale = glm::vec4(tiles_x / viewport_width, tiles_y / viewport_height,
+        slices / log_ratio, -slices * std::log(near_depth) / log_ratio);
+
+    float slice_depths[slices + 1];
+    for (int k = 0; k <= slices; ++k)
+        slice_depths[k] = near_depth * std::pow(far_depth / near_depth, static_cast<float>(k) / slices);
+    const auto sliceOf = [&](float depth) {
+        return std::min(std::max(static_cast<int>(std::log(depth) * cluster_scale.z + cluster_scale.w), 0), slices - 1);
+    };
+    const auto tileOf = [](float ndc, int tiles) {
+        return std::min(std::max(static_cast<int>((ndc + 1.0f) * 0.5f * tiles), 0), tiles - 1);
+    };
+
+    // At a depth d, eye-space x and y map to ndc = focal * xy / d - skew
+    const glm::vec2 focal(projection[0][0], projection[1][1]);
+    const glm::vec2 skew(projection[2][0], projection[2][1]);
+
+    std::vector<uint32_t> entry_clusters, entry_lights;
+    light_data.clear();
+    for (uint32_t index = 0; index < lights.size(); ++index) {
+        const Light& light = lights[index];
+        const glm::vec3 center(view * glm::vec4(light.position, 1.0f));
+        const glm::vec3 direction = glm::normalize(glm::mat3(view) * light.direction);
+        light_data.push_back(glm::vec4(center, light.radius));
+        light_data.push_back(glm::vec4(light.color, light.exponent));
+        light_data.push_back(glm::vec4(direction, light.cutoff >= 180.0f ? -2.0f : std::cos(glm::radians(light.cutoff))));
+
+        const float radius = light.radius;
+        const float depth = -center.z;
+        const float nearest = depth - radius, farthest = depth + radius;
+        if (farthest < near_depth || nearest > far_depth)
+            continue;
+
+        // Screen rectangle of the part of the sphere in front of the near plane
+        const float front = std::max(nearest, near_depth);
+        glm::vec2 low(1e30f), high(-1e30f);
+        for (float d : { front, farthest }) {
+            const glm::vec2 a = focal * (glm::vec2(center) - radius) / d - skew;
+            const glm::vec2 b = focal * (glm::vec2(center) + radius) / d - skew;
+            low = glm::min(low, glm::min(a, b));
+            high = glm::max(high, glm::max(a, b));
+        }
+        if (high.x < -1.0f || low.x > 1.0f || high.y < -1.0f || low.y > 1.0f)
+            continue;
+
+        const int x0 = tileOf(low.x, tiles_x), x1 = tileOf(high.x, tiles_x);
+        const int y0 = tileOf(low.y, tiles_y), y1 = tileOf(high.y, tiles_y);
+        const int z0 = sliceOf(front), z1 = sliceOf(std::min(farthest, far_depth));
+        for (int k = z0; k <= z1; ++k) {
+            const float d0 = slice_depths[k], d1 = slice_depths[k + 1];
+            const float dz = std::max(std::max(d0 - depth, depth - d1), 0.0f);
+            for (int j = y0; j <= y1; ++j) {
+                const float b0 = -1.0f + 2.0f * j / tiles_y, b1 = b0 + 2.0f / tiles_y;
+                const float y_low = std::min((b0 + skew.y) * d0, (b0 + skew.y) * d1) / focal.y;
+                const float y_high = std::max((b1 + skew.y) * d0, (b1 + skew.y) * d1) / focal.y;
+                const float dy = std::max(std::max(y_low - center.y, center.y - y_high), 0.0f);
+                for (int i = x0; i <= x1; ++i) {
+                    const float a0 = -1.0f + 2.0f * i / tiles_x, a1 = a0 + 2.0f / tiles_x;
+                    const float x_low = std::min((a0 + skew.x) * d0, (a0 + skew.x) * d1) / focal.x;
+                    const float x_high = std::max((a1 + skew.x) * d0, (a1 + skew.x) * d1) / focal.x;
+                    const float dx = std::max(std::max(x_low - center.x, center.x - x_high), 0.0f);
+                    if (dx * dx + dy * dy + dz * dz <= radius * radius) {
+                        entry_clusters.push_back((k * tiles_y + j) * tiles_x + i);
+                        entry_lights.push_back(index);
+                    }
+                }
+            }
+        }
+    }
+
+    // Counting sort of the entries by cluster
+    std::fill(ranges.begin(), ranges.end(), glm::uvec2(0));
+    for (uint32_t cluster : entry_clusters)
+        ++ranges[cluster].y;
+    uint32_t offset = 0;
+    max_per_cluster = 0;
+    for (glm::uvec2& range : ranges) {
+        range.x = offset;
+        if (lightLimit > 0)
+            range.y = std::min(range.y, lightLimit);
+        offset += range.y;
+        max_per_cluster = std::max(max_per_cluster, range.y);
+    }
+    indices.resize(offset);
+    std::vector<uint32_t> cursor(cluster_count, 0);
+    for (size_t entry = 0; entry < entry_clusters.size(); ++entry) {
+        const uint32_t cluster = entry_clusters[entry];
+        if (cursor[cluster] < ranges[cluster].y)
+            indices[ranges[cluster].x + cursor[cluster]++] = entry_lights[entry];
+    }
+}
+
+/**
+ * This helper uploads the cluster lists into the buffers, creating them and their buffer textures
+ * on first use. The buffers are respecified every frame, so the driver can hand out new storage
+ * instead of waiting for the GPU to finish reading the last frame's lists.
+ */
+void LightManager::upload()
+{
+    if (!supported())
+        return;
+
+    const bool created = textures[0] != 0;
+    if (!created) {
+        glGenBuffers(3, buffers);
+        glGenTextures(3, textures);
+    }
+
+    // Empty arrays still get one element, a buffer texture needs a data store
+    const glm::vec4 none(0.0f);
+    const uint32_t no_index = 0;
+    const GLsizeiptr sizes[3] = { static_cast<GLsizeiptr>(ranges.size() * sizeof(glm::uvec2)),
+        static_cast<GLsizeiptr>(indices.empty() ? sizeof(uint32_t) : indices.size() * sizeof(uint32_t)),
+        static_cast<GLsizeiptr>(light_data.empty() ? sizeof(glm::vec4) : light_data.size() * sizeof(glm::vec4)) };
+    const void* data[3] = { ranges.data(), indices.empty() ? &no_index : static_cast<const void*>(indices.data()),
+        light_data.empty() ? &none : static_cast<const void*>(light_data.data()) };
+    const GLenum formats[3] = { GL_RG32UI, GL_R32UI, GL_RGBA32F };
+
+    for (int i = 0; i < 3; ++i) {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, sizes[i], data[i], GL_STREAM_DRAW);
+        if (!created) {
+            glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+            glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+            glBindTexture(GL_TEXTURE_BUFFER, 0);
+        }
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+/**
+ * This method starts a fixed-function frame: it copies the lights into SIMD batches for select()
+ * and forgets the slot bindings of the last frame, whose light positions were for another view.
+ */
+void LightManager::pack(const glm::mat4& view)
+{
+    packed_view = view;
+    last_rebinds = rebinds;
+    rebinds = 0;
+    std::fill(bound, bound + fixed_light_count, no_light);
+
+    batches.assign((lights.size() + 3) / 4, LightBatch{});
+    for (size_t i = 0; i < lights.size(); ++i) {
+        const Light& light = lights[i];
+        LightBatch& batch = batches[i / 4];
+        const size_t lane = i % 4;
+        batch.x[lane] = light.position.x;
+        batch.y[lane] = light.position.y;
+        batch.z[lane] = light.position.z;
+        batch.radius[lane] = light.radius;
+        batch.direction_x[lane] = light.direction.x;
+        batch.direction_y[lane] = light.direction.y;
+        batch.direction_z[lane] = light.direction.z;
+        const bool spot = light.cutoff < 180.0f;
+        batch.cos_cutoff[lane] = spot ? std::cos(glm::radians(light.cutoff)) : -2.0f;
+        batch.sin_cutoff[lane] = spot ? std::sin(glm::radians(light.cutoff)) : 0.0f;
+        batch.intensity[lane] = std::max(std::max(light.color.r, light.color.g), light.color.b);
+    }
+}
+
+/**
+ * This method writes the indices of the (at most max_count) lights influencing the sphere the
+ * most into chosen, strongest first, and returns how many there are. It uses the lights as of
+ * the last pack().
+ */
+size_t LightManager::select(const glm::vec3& center, float radius, uint32_t* chosen, size_t max_count) const
+{
+    float best[8];
+    size_t count = 0;
+    max_count = std::min<size_t>(max_count, 8);
+
+    for (size_t b = 0; b < batches.size(); ++b) {
+        const LightBatch& batch = batches[b];
+        alignas(16) float influence[4];
+
+#ifdef SIMD_SSE
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+        const __m128 sphere = _mm_set1_ps(radius);
+        const __m128 vx = _mm_sub_ps(_mm_set1_ps(center.x), _mm_loadu_ps(batch.x));
+        const __m128 vy = _mm_sub_ps(_mm_set1_ps(center.y), _mm_loadu_ps(batch.y));
+        const __m128 vz = _mm_sub_ps(_mm_set1_ps(center.z), _mm_loadu_ps(batch.z));
+        const __m128 distance_squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+        const __m128 range = _mm_loadu_ps(batch.radius);
+
+        // Fade of the light at the nearest point of the sphere
+        const __m128 gap = _mm_max_ps(_mm_sub_ps(_mm_sqrt_ps(distance_squared), sphere), zero);
+        const __m128 f = _mm_div_ps(gap, _mm_max_ps(range, _mm_set1_ps(1e-6f)));
+        const __m128 fade = _mm_sub_ps(one, _mm_mul_ps(f, f));
+        __m128 value = _mm_mul_ps(_mm_mul_ps(fade, fade), _mm_loadu_ps(batch.intensity));
+        __m128 reached = _mm_cmplt_ps(gap, range);
+
+        // A spotlight misses the sphere when it lies behind the light or outside the cone
+        const __m128 cos_cutoff = _mm_loadu_ps(batch.cos_cutoff);
+        const __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(batch.direction_x)),
+            _mm_mul_ps(vy, _mm_loadu_ps(batch.direction_y))), _mm_mul_ps(vz, _mm_loadu_ps(batch.direction_z)));
+        const __m128 across = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(distance_squared, _mm_mul_ps(along, along)), zero));
+        const __m128 outside = _mm_sub_ps(_mm_mul_ps(cos_cutoff, across), _mm_mul_ps(along, _mm_loadu_ps(batch.sin_cutoff)));
+        const __m128 missed = _mm_or_ps(_mm_cmpgt_ps(outside, sphere), _mm_cmplt_ps(along, _mm_sub_ps(zero, sphere)));
+        reached = _mm_andnot_ps(_mm_and_ps(missed, _mm_cmpgt_ps(cos_cutoff, _mm_set1_ps(-1.5f))), reached);
+
+        value = _mm_and_ps(value, reached);
+        _mm_store_ps(influence, value);
+#else
+        for (int lane = 0; lane < 4; ++lane) {
+            const glm::vec3 v = center - glm::vec3(batch.x[lane], batch.y[lane], batch.z[lane]);
+            const float distance_squared = glm::dot(v, v);
+            const float range = batch.radius[lane];
+            const float gap = std::max(std::sqrt(distance_squared) - radius, 0.0f);
+            const float f = gap / std::max(range, 1e-6f);
+            const float fade = 1.0f - f * f;
+            bool reached = gap < range;
+
+            if (batch.cos_cutoff[lane] > -1.5f) {
+                const float along = glm::dot(v, glm::vec3(batch.direction_x[lane], batch.direction_y[lane], batch.direction_z[lane]));
+                const float across = std::sqrt(std::max(distance_squared - along * along, 0.0f));
+                const float outside = batch.cos_cutoff[lane] * across - along * batch.sin_cutoff[lane];
+                if (outside > radius || along < -radius)
+                    reached = false;
+            }
+            influence[lane] = reached ? fade * fade * batch.intensity[lane] : 0.0f;
+        }
+#endif
+
+        for (int lane = 0; lane < 4; ++lane) {
+            const float value = influence[lane];
+            if (value <= 0.0f || (count == max_count && value <= best[count - 1]))
+                continue;
+
+            // Insert into the sorted list of the best lights so far
+            size_t slot = count < max_count ? count++ : count - 1;
+            while (slot > 0 && best[slot - 1] < value) {
+                best[slot] = best[slot - 1];
+                chosen[slot] = chosen[slot - 1];
+                --slot;
+            }
+            best[slot] = value;
+            chosen[slot] = static_cast<uint32_t>(b * 4 + lane);
+        }
+    }
+    return count;
+}
+
+/**
+ * This method binds the lights influencing the sphere the most to the free fixed-function light
+ * slots and switches the other free slots off. Lights already bound this frame keep their slot.
+ * The light positions are set in the view of the last pack(), whatever the modelview matrix is.
+ */
+void LightManager::apply(const glm::vec3& center, float radius) const
+{
+    uint32_t chosen[fixed_light_count];
+    const size_t count = select(center, radius, chosen, lightLimit > 0 ? std::min<size_t>(lightLimit, fixed_light_count) : fixed_light_count);
+
+    // Keep the slots whose light is chosen again and free the others
+    bool keep[fixed_light_count] = {};
+    bool placed[fixed_light_count] = {};
+    for (int slot = 0; slot < fixed_light_count; ++slot) {
+        for (size_t i = 0; i < count; ++i) {
+            if (bound[slot] == chosen[i]) {
+                keep[slot] = placed[i] = true;
+                break;
+            }
+        }
+    }
+
+    bool view_loaded = false;
+    size_t next = 0;
+    for (int slot = 0; slot < fixed_light_count; ++slot) {
+        const GLenum name = first_fixed_light + slot;
+        if (keep[slot])
+            continue;
+        while (next < count && placed[next])
+            ++next;
+        if (next == count) {
+            GLState::disable(name);
+            bound[slot] = no_light;
+            continue;
+        }
+
+        const uint32_t index = chosen[next++];
+        const Light& light = lights[index];
+        if (!view_loaded) {
+            glPushMatrix();
+            glLoadMatrixf(glm::value_ptr(packed_view));
+            view_loaded = true;
+        }
+
+        const GLfloat color[4] = { light.color.r, light.color.g, light.color.b, 1.0f };
+        const GLfloat position[4] = { light.position.x, light.position.y, light.position.z, 1.0f };
+        GLState::light(name, GL_DIFFUSE, color);
+        GLState::light(name, GL_SPECULAR, color);
+        GLState::light(name, GL_POSITION, position);
+        GLState::light(name, GL_SPOT_DIRECTION, glm::value_ptr(light.direction));
+        GLState::light(name, GL_SPOT_CUTOFF, light.cutoff < 180.0f ? std::min(light.cutoff, 90.0f) : 180.0f);
+        GLState::light(name, GL_SPOT_EXPONENT, light.exponent);
+        GLState::light(name, GL_CONSTANT_ATTENUATION, 1.0f);
+        GLState::light(name, GL_LINEAR_ATTENUATION, 2.0f / light.radius);
+        GLState::light(name, GL_QUADRATIC_ATTENUATION, 8.0f / (light.radius * light.radius));
+        GLState::enable(name);
+        bound[slot] = index;
+        ++rebinds;
+    }
+
+    if (view_loaded)
+        glPopMatrix();
+}
+
+/**
+ * This method switches the free fixed-function light slots off, for a draw too spread out to pick
+ * local lights for.
+ */
+void LightManager::release() const
+{
+    for (int slot = 0; slot < fixed_light_count; ++slot) {
+        GLState::disable(first_fixed_light + slot);
+        bound[slot] = no_light;
+    }
+}
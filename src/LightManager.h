@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "Frustum.h"
+
+/*
+LightManager keeps any number of local point and spot lights (lanterns, fireflies). Every frame it
+bins them into a grid of view-space clusters (screen tiles split into depth slices) and uploads the
+light list of each cluster, so a pixel is only shaded with the lights whose range reaches it.
+For the fixed-function pipeline it instead picks, per object, the lights that influence the
+object most and binds them to the light slots the scene lights leave free.
+*/
+class LightManager
+{
+public:
+	static constexpr int tiles_x = 16;
+	static constexpr int tiles_y = 9;
+	static constexpr int slices = 24;
+	static constexpr int cluster_count = tiles_x * tiles_y * slices;
+	static constexpr GLenum first_fixed_light = GL_LIGHT2; // GL_LIGHT0 and GL_LIGHT1 are the scene lights
+	static constexpr int fixed_light_count = 6;
+
+	struct Light {
+		glm::vec3 position; // World coordinates
+		float radius; // Distance where the light fades out completely
+		glm::vec3 color;
+		float exponent; // Spot exponent
+		glm::vec3 direction; // World coordinates, for spotlights
+		float cutoff; // Spot cutoff in degrees, 180 for point lights
+	};
+
+	LightManager();
+	LightManager(const LightManager&) = delete;
+	LightManager& operator=(const LightManager&) = delete;
+	~LightManager();
+
+	static bool supported();
+
+	size_t addPoint(const glm::vec3& position, const glm::vec3& color, float radius);
+	size_t addSpot(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& color, float radius, float cutoff, float exponent);
+	Light& light(size_t index) { return lights[index]; }
+	const Light& light(size_t index) const { return lights[index]; }
+	size_t size() const { return lights.size(); }
+	void clear() { lights.clear(); }
+
+	void update(const glm::mat4& view, const glm::mat4& projection, float viewport_width, float viewport_height);
+	void bind(GLuint first_unit) const;
+	glm::vec4 clusterScale() const { return cluster_scale; }
+
+	void pack(const glm::mat4& view);
+	size_t select(const glm::vec3& center, float radius, uint32_t* chosen, size_t max_count) const;
+	void apply(const glm::vec3& center, float radius) const;
+	void apply(const AABB& bounds) const { apply((bounds.min + bounds.max) * 0.5f, glm::length(bounds.max - bounds.min) * 0.5f); }
+	void release() const;
+	unsigned int rebindCount() const { return last_rebinds; }
+
+	size_t indexCount() const { return indices.size(); }
+	unsigned int maxLightsPerCluster() const { return max_per_cluster; }
+	const glm::uvec2* clusterRanges() const { return ranges.data(); }
+	const uint32_t* lightIndices() const { return indices.data(); }
+
+	unsigned int lightLimit = 0; // Most lights kept per cluster, and per object on the fixed-function path, 0 for no limit
+
+private:
+	// Four lights stored component by component for the SIMD influence test
+	struct LightBatch {
+		float x[4], y[4], z[4], radius[4];
+		float direction_x[4], direction_y[4], direction_z[4];
+		float cos_cutoff[4], sin_cutoff[4]; // cos_cutoff is -2 for point lights
+		float intensity[4]; // Brightest color channel, 0 in unused lanes
+	};
+
+	void assign(const glm::mat4& view, const glm::mat4& projection, float viewport_width, float viewport_height);
+	void upload();
+
+	std::vector<Light> lights;
+	std::vector<glm::uvec2> ranges; // Per cluster: first entry in indices and light count
+	std::vector<uint32_t> indices; // Light indices of all clusters, cluster after cluster
+	std::vector<glm::vec4> light_data; // Per light: eye position and radius, color and exponent, eye direction and cos(cutoff)
+	glm::vec4 cluster_scale; // Tiles per pixel in x and y, and the scale and bias from log(depth) to the slice
+	unsigned int max_per_cluster;
+
+	GLuint buffers[3]; // Ranges, indices and light data
+	GLuint textures[3]; // Buffer textures over them
+
+	std::vector<LightBatch> batches;
+	glm::mat4 packed_view;
+	mutable uint32_t bound[fixed_light_count]; // Light bound to each fixed-function slot this frame
+	mutable unsigned int rebinds;
+	unsigned int last_rebinds;
+};
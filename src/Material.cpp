@@ -0,0 +1,33 @@
+/**
+ * The Material structure bundles the OpenGL material parameters of a surface
+ * (ambient and diffuse color, specular color and shininess) so that geometry
+ * can be grouped and drawn by material instead of re-issuing glMaterial calls
+ * for every primitive. The parameters go through GLState, so applying the material
+ * that is already current costs nothing.
+ */
+
+#include "Material.h"
+#include "GLState.h"
+
+/**
+ * This method sets the material as the current OpenGL material for both faces.
+ */
+void Material::apply() const
+{
+    GLState::material(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE, ambient_diffuse);
+    GLState::material(GL_FRONT_AND_BACK, GL_SPECULAR, specular);
+    GLState::material(GL_FRONT_AND_BACK, GL_SHININESS, shininess);
+}
+
+/**
+ * Two materials are equal when all of their parameters match, which allows geometry
+ * with the same look to be merged into a single draw call.
+ */
+bool Material::operator==(const Material& other) const
+{
+    for (int i = 0; i < 4; ++i) {
+        if (ambient_diffuse[i] != other.ambient_diffuse[i] || specular[i] != other.specular[i])
+            return false;
+    }
+    return shininess == other.shininess && blend == other.blend;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <GL/glew.h>
+
+/*
+Material describes the fixed-function surface properties used to draw a piece of geometry.
+Blended materials are drawn with alpha blending enabled (e.g. the lake surface).
+*/
+struct Material
+{
+	GLfloat ambient_diffuse[4];
+	GLfloat specular[4];
+	GLfloat shininess;
+	bool blend;
+
+	void apply() const;
+	bool operator==(const Material& other) const;
+	bool operator!=(const Material& other) const { return !(*this == other); }
+};
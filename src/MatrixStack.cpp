@@ -0,0 +1,104 @@
+/**
+ * The MatrixStack class keeps a stack of glm matrices. It mirrors glPushMatrix/glPopMatrix,
+ * glLoadIdentity, glLoadMatrix, glMultMatrix, glRotate, glTranslate, glScale, gluLookAt and
+ * gluPerspective, but runs entirely on the CPU. apply(...) loads the top matrix into OpenGL.
+ */
+
+#include "MatrixStack.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+/**
+ * The constructor creates a stack holding the identity matrix.
+ */
+MatrixStack::MatrixStack() : stack(1, glm::mat4(1.0f)) {}
+
+/**
+ * This method duplicates the top matrix.
+ */
+void MatrixStack::push()
+{
+    stack.push_back(stack.back());
+}
+
+/**
+ * This method removes the top matrix. The last matrix is never removed.
+ */
+void MatrixStack::pop()
+{
+    if (stack.size() > 1)
+        stack.pop_back();
+}
+
+/**
+ * This method replaces the top matrix with the identity matrix.
+ */
+void MatrixStack::loadIdentity()
+{
+    stack.back() = glm::mat4(1.0f);
+}
+
+/**
+ * This method replaces the top matrix.
+ */
+void MatrixStack::load(const glm::mat4& matrix)
+{
+    stack.back() = matrix;
+}
+
+/**
+ * This method multiplies the top matrix by the given matrix from the right.
+ */
+void MatrixStack::multiply(const glm::mat4& matrix)
+{
+    stack.back() *= matrix;
+}
+
+/**
+ * This method applies a rotation by the given angle in degrees, like glRotatef.
+ */
+void MatrixStack::rotate(float degrees, const glm::vec3& axis)
+{
+    stack.back() = glm::rotate(stack.back(), glm::radians(degrees), axis);
+}
+
+/**
+ * This method applies a translation, like glTranslatef.
+ */
+void MatrixStack::translate(const glm::vec3& offset)
+{
+    stack.back() = glm::translate(stack.back(), offset);
+}
+
+/**
+ * This method applies a scale, like glScalef.
+ */
+void MatrixStack::scale(const glm::vec3& factors)
+{
+    stack.back() = glm::scale(stack.back(), factors);
+}
+
+/**
+ * This method applies a viewing transformation, like gluLookAt.
+ */
+void MatrixStack::lookAt(const glm::vec3& eye, const glm::vec3& center, const glm::vec3& up)
+{
+    stack.back() *= glm::lookAt(eye, center, up);
+}
+
+/**
+ * This method applies a perspective projection, like gluPerspective.
+ */
+void MatrixStack::perspective(float fovy_degrees, float aspect, float near_plane, float far_plane)
+{
+    stack.back() *= glm::perspective(glm::radians(fovy_degrees), aspect, near_plane, far_plane);
+}
+
+/**
+ * This method loads the top matrix into the given OpenGL matrix stack, which becomes the current one.
+ */
+void MatrixStack::apply(GLenum matrix_mode) const
+{
+    glMatrixMode(matrix_mode);
+    glLoadMatrixf(glm::value_ptr(stack.back()));
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/*
+MatrixStack is a CPU-side replacement for the OpenGL matrix stacks built on glm. Transformations
+compose like their gl* counterparts (each one multiplies the top matrix from the right), so the
+result can be read at any time without a glGetFloatv round-trip, and loaded into OpenGL when needed.
+*/
+class MatrixStack
+{
+public:
+	MatrixStack();
+
+	void push();
+	void pop();
+	void loadIdentity();
+	void load(const glm::mat4& matrix);
+	void multiply(const glm::mat4& matrix);
+	void rotate(float degrees, const glm::vec3& axis);
+	void translate(const glm::vec3& offset);
+	void scale(const glm::vec3& factors);
+	void lookAt(const glm::vec3& eye, const glm::vec3& center, const glm::vec3& up);
+	void perspective(float fovy_degrees, float aspect, float near_plane, float far_plane);
+
+	const glm::mat4& top() const { return stack.back(); }
+	glm::vec3 position() const { return glm::vec3(stack.back()[3]); }
+	void apply(GLenum matrix_mode) const;
+
+private:
+	std::vector<glm::mat4> stack;
+};
@@ -8,6 +8,12 @@
 #include "Menu.h"
 #include "Context.h"
 #include "imgui.h"
+#include "GLState.h"
+#include "LevelOfDetail.h"
+#include "CoreRenderer.h"
+#include "ProgramBinaryCache.h"
+#include "GpuCulling.h"
+#include "ImGuiRenderer.h"
 
 /*
 * The constructor initializes a reference to a Context instance, 
@@ -59,11 +65,117 @@ void Menu::handleInteraction() {
 			ImGui::SliderFloat("spotlight target z", &context.spotlight.target[2], -10.0f, 10.0f);
 			ImGui::SliderFloat("spotlight cutoff", &context.spotlight.cutoff, 0.0f, 90.0f);
 			ImGui::SliderFloat("spotlight exponent", &context.spotlight.exponent, 0.0f, 90.0f);
+			ImGui::Checkbox("Spotlight shadows (shader renderer)", &context.shadows.enabled);
+			ImGui::Text("Static shadow map renders: %u", context.shadows.staticRenders());
+
+			ImGui::Checkbox("Night lights (lanterns and fireflies)", &context.night);
+			ImGui::Text("Local lights: %d, up to %u per cluster", (int)context.lights.size(), context.lights.maxLightsPerCluster());
+			ImGui::Text("Local light binds per frame (fixed function): %u", context.lights.rebindCount());
 
 			pointlight ? context.pointlight.enable() : context.pointlight.disable();
 			spotlight ? context.spotlight.enable() : context.spotlight.disable();
 		}
 		
+		if (ImGui::CollapsingHeader("Performance"))
+		{
+			FramePacer& pacer = context.framePacer;
+			if (FramePacer::swapControlSupported()) {
+				int vsync = pacer.vsync;
+				const char* modes = FramePacer::adaptiveSupported() ? "Off\0On\0Adaptive\0" : "Off\0On\0";
+				if (ImGui::Combo("Vertical sync", &vsync, modes))
+					pacer.vsync = static_cast<FramePacer::VSync>(vsync);
+			}
+			if (FramePacer::fencesSupported())
+				ImGui::SliderInt("max frames in flight", &pacer.maxFramesInFlight, 1, FramePacer::max_queued_frames);
+			ImGui::SliderFloat("frame rate cap (0 = off)", &pacer.frameRateCap, 0.0f, 240.0f, "%.0f fps");
+			ImGui::Text("Frame time: %.2f ms (%.2f ms sleeping, %.2f ms waiting for the GPU)", pacer.frameMilliseconds(),
+				pacer.sleepMilliseconds(), pacer.waitMilliseconds());
+			if (FramePacer::timerSupported())
+				ImGui::Text("Frame work: %.2f ms CPU, %.2f ms GPU", pacer.cpuMilliseconds(), pacer.gpuMilliseconds());
+			if (DynamicResolution::supported()) {
+				DynamicResolution& resolution = context.resolution;
+				ImGui::Checkbox("Dynamic resolution", &resolution.enabled);
+				if (resolution.enabled) {
+					if (DynamicResolution::timerSupported()) {
+						ImGui::Checkbox("Scale automatically", &resolution.automatic);
+						ImGui::SliderFloat("GPU budget", &resolution.budgetMilliseconds, 2.0f, 33.0f, "%.1f ms");
+						ImGui::DragFloatRange2("scale range", &resolution.minScale, &resolution.maxScale, 0.01f, 0.25f, 1.0f, "%.2f");
+					}
+					if (!resolution.automatic || !DynamicResolution::timerSupported())
+						ImGui::SliderFloat("resolution scale", &resolution.scale, resolution.minScale, resolution.maxScale, "%.2f");
+					ImGui::Text("Scene: %d x %d (%.0f%%), %.2f ms on the GPU, %u resizes", resolution.width(), resolution.height(),
+						resolution.scale * 100.0f, resolution.gpuMilliseconds(), resolution.resizes());
+				}
+			}
+			QualityGovernor& quality = context.quality;
+			int pinned = quality.pinned + 1;
+			const char* pins = "None\0Low\0Medium\0High\0Full\0";
+			if (ImGui::Combo("Pin quality preset", &pinned, pins))
+				quality.pinned = pinned - 1;
+			if (quality.pinned < 0) {
+				ImGui::Checkbox("Quality governor", &quality.automatic);
+				ImGui::SliderFloat("frame time target", &quality.targetMilliseconds, 4.0f, 50.0f, "%.1f ms");
+			}
+			if (quality.preset() >= 0)
+				ImGui::Text("Quality: %s (median %.1f ms, 90th percentile %.1f ms)", QualityGovernor::presets[quality.preset()].name,
+					quality.median(), quality.slowFrames());
+			for (const std::string& decision : quality.decisions())
+				ImGui::BulletText("%s", decision.c_str());
+
+			if (ImGuiRenderer::available()) {
+				ImGui::Checkbox("Menu from vertex buffers", &ImGuiRenderer::enabled);
+				ImGui::Text("Menu uploads: %u, frames reusing them: %u", ImGuiRenderer::rebuilds(), ImGuiRenderer::reuses());
+			}
+
+			ImGui::Checkbox("Redraw on demand", &context.redraw.onDemand);
+			if (context.redraw.onDemand) {
+				ImGui::SliderFloat("idle tick rate", &context.redraw.idleRate, 0.0f, 30.0f, "%.0f Hz");
+				ImGui::Text("Idle frames: %u", context.redraw.idleTicks());
+			}
+
+			ImGui::Text("Renderer: %s", CoreRenderer::active() ? "OpenGL 3.3 shaders" : "fixed function");
+			if (CoreRenderer::active()) {
+				ImGui::Text("Uniform stream: %s, %d KB per frame, %u waits", CoreRenderer::stream().persistent() ? "persistent ring" : "orphaned buffer",
+					(int)(CoreRenderer::stream().bytesWritten() / 1024), CoreRenderer::stream().waits());
+			}
+			ImGui::Checkbox("Program binary cache", &ProgramBinaryCache::enabled);
+			ImGui::Text("Program binaries: %u loaded, %u linked", ProgramBinaryCache::hits(), ProgramBinaryCache::misses());
+			ImGui::Checkbox("Static batching", &context.staticBatching);
+			ImGui::Checkbox("Sorted render queue", &context.renderQueue.sorting);
+			ImGui::Text("Render items: %d", (int)context.renderQueue.itemCount());
+			ImGui::Checkbox("Filter redundant GL state", &GLState::filtering);
+			ImGui::Text("GL state calls: %u issued, %u dropped, %u cached queries",
+				GLState::issuedCalls(), GLState::droppedCalls(), GLState::cachedQueries());
+			ImGui::Checkbox("Instanced forest", &context.forest.instanced);
+			if (CoreRenderer::active() && GpuCulling::supported()) {
+				ImGui::Checkbox("GPU culling and indirect draws (trees, fence)", &GpuCulling::enabled);
+				ImGui::Checkbox("Cull instances with a compute shader", &GpuCulling::compute);
+				ImGui::Text("Instance culling: %s", GpuCulling::compute && GpuCulling::computeSupported() ? "compute shader" : "CPU");
+			}
+			ImGui::Checkbox("Frustum culling", &context.culling.enabled);
+			ImGui::Checkbox("Occlusion culling", &context.culling.occlusion);
+			ImGui::Text("Objects: %d visible, %d culled (%d occluded)", (int)context.culling.visibleCount(),
+				(int)context.culling.culledCount(), (int)context.culling.occludedCount());
+			ImGui::Text("Quadtree: %d nodes visited, %d boxes tested", (int)context.culling.quadtreeStats().nodes_visited,
+				(int)context.culling.quadtreeStats().boxes_tested);
+			ImGui::Text("Fence sections drawn: %d / %d", (int)context.fence.visibleSections(), (int)context.fence.sectionCount());
+			ImGui::Checkbox("Tree impostors", &context.forest.useImpostors);
+			ImGui::SliderFloat("impostor distance", &context.forest.impostorDistance, 5.0f, 150.0f);
+			ImGui::SliderFloat("impostor fade", &context.forest.impostorFade, 0.0f, 30.0f);
+			ImGui::Text("Tree impostors drawn: %d", (int)context.forest.impostorCount());
+			ImGui::Checkbox("Level of detail", &LevelOfDetail::enabled);
+			ImGui::SliderFloat("LOD bias", &LevelOfDetail::bias, 0.1f, 4.0f);
+			ImGui::SliderFloat("LOD hysteresis", &LevelOfDetail::hysteresis, 0.0f, 0.5f);
+			ImGui::Text("LOD levels drawn: %u / %u / %u / %u", LevelOfDetail::selections(0), LevelOfDetail::selections(1),
+				LevelOfDetail::selections(2), LevelOfDetail::selections(3));
+			ImGui::Checkbox("GPU wheat field", &context.gpuWheat);
+			ImGui::SliderFloat("wheat stalks per unit", &context.wheatCrop.stalksPerUnit, 1.0f, 40.0f);
+			ImGui::SliderFloat("wheat fade start", &context.wheatCrop.fadeStart, 0.0f, 150.0f);
+			ImGui::SliderFloat("wheat fade end", &context.wheatCrop.fadeEnd, 0.0f, 150.0f);
+			ImGui::SliderFloat("wheat far density", &context.wheatCrop.farDensity, 0.0f, 1.0f);
+			ImGui::Text("Wheat stalks: %d", context.wheatCrop.stalkCount());
+		}
+
 		if (ImGui::CollapsingHeader("Help (Change views, Movement & adjust lights)"))
 		{
 			ImGui::Text("Viewing modes:");
@@ -0,0 +1,49 @@
+/**
+ * The Mesh class wraps a MeshBuffer holding a triangle list. A mesh is drawn either with the
+ * current modelview matrix and material, or with an explicit transformation and material.
+ */
+
+#include "Mesh.h"
+#include <glm/gtc/type_ptr.hpp>
+
+/**
+ * The constructor uploads the geometry into the mesh's buffers.
+ */
+Mesh::Mesh(const Geometry& geometry)
+{
+    buffer.upload(geometry);
+}
+
+/**
+ * This method draws the mesh using the current modelview matrix and material.
+ */
+void Mesh::draw() const
+{
+    buffer.bind();
+    buffer.drawElements(GL_TRIANGLES, 0, buffer.indexCount());
+    buffer.unbind();
+}
+
+/**
+ * This method draws the mesh the given number of times with glDrawElementsInstanced.
+ * The per-instance attributes must already be bound.
+ */
+void Mesh::drawInstanced(GLsizei instances) const
+{
+    buffer.bind();
+    buffer.drawElementsInstanced(GL_TRIANGLES, 0, buffer.indexCount(), instances);
+    buffer.unbind();
+}
+
+/**
+ * This method draws the mesh with the given transformation (relative to the current modelview
+ * matrix) and material.
+ */
+void Mesh::draw(const glm::mat4& transform, const Material& material) const
+{
+    glPushMatrix();
+    glMultMatrixf(glm::value_ptr(transform));
+    material.apply();
+    draw();
+    glPopMatrix();
+}
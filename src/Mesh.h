@@ -0,0 +1,22 @@
+#pragma once
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "Geometry.h"
+#include "Material.h"
+#include "MeshBuffer.h"
+
+/*
+Mesh is a triangle Geometry uploaded to the GPU once and drawn with a single call.
+*/
+class Mesh
+{
+public:
+	explicit Mesh(const Geometry& geometry);
+	void draw() const;
+	void draw(const glm::mat4& transform, const Material& material) const;
+	void drawInstanced(GLsizei instances) const;
+	const MeshBuffer& buffers() const { return buffer; }
+
+private:
+	MeshBuffer buffer;
+};
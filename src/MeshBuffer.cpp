@@ -0,0 +1,176 @@
+/**
+ * The MeshBuffer class uploads a Geometry into OpenGL buffer objects once, so that it can be
+ * drawn every frame without sending the vertices through the driver again.
+ * bind() sets up the vertex, normal and (for painted geometry) color arrays, drawElements(...)
+ * issues a draw of an index range, and unbind() restores the client state.
+ *
+ * The colors are stored in the vertex buffer after all vertices.
+ *
+ * bindVertexArray() is the OpenGL 3.3 core alternative to bind(): it binds a vertex array object
+ * holding the same buffers as generic attributes 0 (position), 1 (normal) and 2 (color).
+ */
+
+#include "MeshBuffer.h"
+#include "GLState.h"
+#include <cstddef> // For offsetof
+
+MeshBuffer::MeshBuffer() : vertex_buffer(0), index_buffer(0), index_count(0), vertex_count(0), has_colors(false), vertex_array(0) {}
+
+MeshBuffer::~MeshBuffer()
+{
+    if (vertex_array)
+        glDeleteVertexArrays(1, &vertex_array);
+    if (vertex_buffer)
+        glDeleteBuffers(1, &vertex_buffer);
+    if (index_buffer)
+        glDeleteBuffers(1, &index_buffer);
+}
+
+/**
+ * This method uploads the geometry into static buffer objects, replacing any previous content.
+ * Without buffer object support (OpenGL < 1.5) the data is kept in client memory instead.
+ */
+void MeshBuffer::upload(const Geometry& geometry)
+{
+    index_count = static_cast<GLsizei>(geometry.indices.size());
+    vertex_count = static_cast<GLsizei>(geometry.vertices.size());
+    has_colors = !geometry.colors.empty();
+
+    // Vertices added after the last paint(...) call are white.
+    std::vector<GLfloat> colors = geometry.colors;
+    if (has_colors)
+        colors.resize(geometry.vertices.size() * 4, 1.0f);
+
+    if (!GLEW_VERSION_1_5) {
+        client_vertices = geometry.vertices;
+        client_indices = geometry.indices;
+        client_colors = colors;
+        return;
+    }
+
+    // The layout of the color attribute may change, so the vertex array is described again
+    if (vertex_array) {
+        glDeleteVertexArrays(1, &vertex_array);
+        vertex_array = 0;
+    }
+
+    if (!vertex_buffer)
+        glGenBuffers(1, &vertex_buffer);
+    if (!index_buffer)
+        glGenBuffers(1, &index_buffer);
+
+    const GLsizeiptr vertex_bytes = geometry.vertices.size() * sizeof(Vertex);
+    const GLsizeiptr color_bytes = colors.size() * sizeof(GLfloat);
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, vertex_bytes + color_bytes, nullptr, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertex_bytes, geometry.vertices.data());
+    if (has_colors)
+        glBufferSubData(GL_ARRAY_BUFFER, vertex_bytes, color_bytes, colors.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, geometry.indices.size() * sizeof(GLuint), geometry.indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+/**
+ * This method binds the buffers and enables the vertex and normal arrays.
+ */
+void MeshBuffer::bind() const
+{
+    // With buffer objects the pointers are byte offsets into the bound vertex buffer.
+    std::size_t base = 0;
+    std::size_t color_base = 0;
+    if (vertex_buffer) {
+        glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+        color_base = vertexCount() * sizeof(Vertex);
+    }
+    else {
+        base = reinterpret_cast<std::size_t>(client_vertices.data());
+        color_base = reinterpret_cast<std::size_t>(client_colors.data());
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(Vertex), reinterpret_cast<const GLvoid*>(base + offsetof(Vertex, position)));
+    glNormalPointer(GL_FLOAT, sizeof(Vertex), reinterpret_cast<const GLvoid*>(base + offsetof(Vertex, normal)));
+
+    if (has_colors) {
+        glEnableClientState(GL_COLOR_ARRAY);
+        glColorPointer(4, GL_FLOAT, 0, reinterpret_cast<const GLvoid*>(color_base));
+        glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+        GLState::enable(GL_COLOR_MATERIAL);
+    }
+}
+
+/**
+ * This method disables the vertex arrays and unbinds the buffers.
+ */
+void MeshBuffer::unbind() const
+{
+    if (has_colors) {
+        GLState::disable(GL_COLOR_MATERIAL);
+        glDisableClientState(GL_COLOR_ARRAY);
+    }
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    if (vertex_buffer) {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+}
+
+/**
+ * This method draws count indices starting at first. The mesh must be bound.
+ */
+void MeshBuffer::drawElements(GLenum mode, GLsizei first, GLsizei count) const
+{
+    const GLvoid* indices = vertex_buffer
+        ? reinterpret_cast<const GLvoid*>(first * sizeof(GLuint))
+        : static_cast<const GLvoid*>(client_indices.data() + first);
+    glDrawElements(mode, count, GL_UNSIGNED_INT, indices);
+}
+
+/**
+ * This method draws count indices starting at first, once per instance. The mesh must be bound
+ * and use buffer objects.
+ */
+void MeshBuffer::drawElementsInstanced(GLenum mode, GLsizei first, GLsizei count, GLsizei instances) const
+{
+    glDrawElementsInstanced(mode, count, GL_UNSIGNED_INT, reinterpret_cast<const GLvoid*>(first * sizeof(GLuint)), instances);
+}
+
+/**
+ * This method binds the vertex array object of the mesh, creating it on first use. The mesh must use
+ * buffer objects. Without painted colors attribute 2 stays disabled.
+ */
+void MeshBuffer::bindVertexArray() const
+{
+    if (vertex_array) {
+        glBindVertexArray(vertex_array);
+        return;
+    }
+
+    glGenVertexArrays(1, &vertex_array);
+    glBindVertexArray(vertex_array);
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const GLvoid*>(offsetof(Vertex, position)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const GLvoid*>(offsetof(Vertex, normal)));
+    if (has_colors) {
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 0, reinterpret_cast<const GLvoid*>(vertexCount() * sizeof(Vertex)));
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/**
+ * This method unbinds the vertex array object.
+ */
+void MeshBuffer::unbindVertexArray() const
+{
+    glBindVertexArray(0);
+}
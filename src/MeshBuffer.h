@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+#include "Geometry.h"
+
+/*
+MeshBuffer owns the vertex and index buffer objects of a baked Geometry. When vertex buffer
+objects are not available it keeps the data on the CPU and draws from client-side arrays.
+Painted geometry also gets a color array, which drives the material through GL_COLOR_MATERIAL.
+For shader-only drawing the same buffers are also described by a vertex array object.
+*/
+class MeshBuffer
+{
+public:
+	MeshBuffer();
+	MeshBuffer(const MeshBuffer&) = delete;
+	MeshBuffer& operator=(const MeshBuffer&) = delete;
+	~MeshBuffer();
+
+	void upload(const Geometry& geometry);
+	void bind() const;
+	void unbind() const;
+	void drawElements(GLenum mode, GLsizei first, GLsizei count) const;
+	void drawElementsInstanced(GLenum mode, GLsizei first, GLsizei count, GLsizei instances) const;
+	void bindVertexArray() const;
+	void unbindVertexArray() const;
+	bool hasColors() const { return has_colors; }
+	GLsizei indexCount() const { return index_count; }
+	GLsizei vertexCount() const { return vertex_count; }
+	GLuint vertexBuffer() const { return vertex_buffer; } // Vertices followed by the colors, 0 without buffer objects
+	GLuint indexBuffer() const { return index_buffer; }
+
+private:
+	GLuint vertex_buffer;
+	GLuint index_buffer;
+	GLsizei index_count;
+	GLsizei vertex_count;
+	bool has_colors;
+	mutable GLuint vertex_array; // Created on first use by bindVertexArray()
+	std::vector<Vertex> client_vertices;
+	std::vector<GLuint> client_indices;
+	std::vector<GLfloat> client_colors;
+};
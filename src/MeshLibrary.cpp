@@ -0,0 +1,123 @@
+/**
+ * The MeshLibrary class is a cache of tessellated primitive meshes. GLUT recomputes and re-sends
+ * every vertex of a solid shape each time it is drawn; here each shape is tessellated and uploaded
+ * the first time a tessellation level is requested, and every later draw is a single call.
+ *
+ * All meshes are unit sized (radius 1, height 1, edge 1) and oriented like their GLUT counterparts,
+ * so callers scale them with the modelview matrix or pass a transformation to Mesh::draw.
+ */
+
+#include "MeshLibrary.h"
+
+/**
+ * This method returns the unit sphere mesh with the given tessellation.
+ */
+const Mesh& MeshLibrary::sphere(int slices, int stacks)
+{
+    return get(Shape::Sphere, slices, stacks);
+}
+
+/**
+ * This method returns the unit cube mesh.
+ */
+const Mesh& MeshLibrary::cube()
+{
+    return get(Shape::Cube, 1, 1);
+}
+
+/**
+ * This method returns the unit cylinder mesh (radius 1, height 1) with the given tessellation.
+ */
+const Mesh& MeshLibrary::cylinder(int slices, int stacks)
+{
+    return get(Shape::Cylinder, slices, stacks);
+}
+
+/**
+ * This method returns the unit cone mesh (base radius 1, height 1) with the given tessellation.
+ */
+const Mesh& MeshLibrary::cone(int slices, int stacks)
+{
+    return get(Shape::Cone, slices, stacks);
+}
+
+/**
+ * This method draws a sphere, like glutSolidSphere.
+ */
+void MeshLibrary::solidSphere(GLfloat radius, int slices, int stacks)
+{
+    glPushMatrix();
+    glScalef(radius, radius, radius);
+    sphere(slices, stacks).draw();
+    glPopMatrix();
+}
+
+/**
+ * This method draws a cube, like glutSolidCube.
+ */
+void MeshLibrary::solidCube(GLfloat size)
+{
+    glPushMatrix();
+    glScalef(size, size, size);
+    cube().draw();
+    glPopMatrix();
+}
+
+/**
+ * This method draws a capped cylinder, like glutSolidCylinder.
+ */
+void MeshLibrary::solidCylinder(GLfloat radius, GLfloat height, int slices, int stacks)
+{
+    glPushMatrix();
+    glScalef(radius, radius, height);
+    cylinder(slices, stacks).draw();
+    glPopMatrix();
+}
+
+/**
+ * This method draws a cone, like glutSolidCone.
+ */
+void MeshLibrary::solidCone(GLfloat base, GLfloat height, int slices, int stacks)
+{
+    glPushMatrix();
+    glScalef(base, base, height);
+    cone(slices, stacks).draw();
+    glPopMatrix();
+}
+
+/**
+ * This method looks up a mesh in the cache, tessellating and uploading it on first use.
+ */
+const Mesh& MeshLibrary::get(Shape shape, int slices, int stacks)
+{
+    std::unique_ptr<Mesh>& mesh = cache()[Key(shape, slices, stacks)];
+    if (!mesh) {
+        const glm::mat4 identity(1.0f);
+        Geometry geometry;
+        switch (shape) {
+        case Shape::Sphere:
+            geometry.addSphere(identity, 1.0f, slices, stacks);
+            break;
+        case Shape::Cube:
+            geometry.addBox(identity);
+            break;
+        case Shape::Cylinder:
+            geometry.addCylinder(identity, 1.0f, 1.0f, slices, stacks);
+            break;
+        case Shape::Cone:
+            geometry.addCone(identity, 1.0f, 1.0f, slices, stacks);
+            break;
+        }
+        mesh.reset(new Mesh(geometry));
+    }
+    return *mesh;
+}
+
+/**
+ * This method returns the cache of built meshes, keyed by shape and tessellation.
+ */
+std::map<MeshLibrary::Key, std::unique_ptr<Mesh>>& MeshLibrary::cache()
+{
+    static std::map<Key, std::unique_ptr<Mesh>> meshes;
+    return meshes;
+}
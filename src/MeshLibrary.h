@@ -0,0 +1,31 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <tuple>
+#include <GL/glew.h>
+#include "Mesh.h"
+
+/*
+MeshLibrary builds unit sphere, cube, cylinder and cone meshes once per tessellation level and
+shares them between all users. The solid*() helpers are drop-in replacements for glutSolid*().
+*/
+class MeshLibrary
+{
+public:
+	static const Mesh& sphere(int slices, int stacks);
+	static const Mesh& cube();
+	static const Mesh& cylinder(int slices, int stacks);
+	static const Mesh& cone(int slices, int stacks);
+
+	static void solidSphere(GLfloat radius, int slices, int stacks);
+	static void solidCube(GLfloat size);
+	static void solidCylinder(GLfloat radius, GLfloat height, int slices, int stacks);
+	static void solidCone(GLfloat base, GLfloat height, int slices, int stacks);
+
+private:
+	enum class Shape { Sphere, Cube, Cylinder, Cone };
+	typedef std::tuple<Shape, int, int> Key;
+
+	static const Mesh& get(Shape shape, int slices, int stacks);
+	static std::map<Key, std::unique_ptr<Mesh>>& cache();
+};
@@ -0,0 +1,59 @@
+/**
+ * The NightLights class places the local lights of the night scene into a LightManager.
+ *
+ * Lanterns are warm point lights hanging just above the fence posts. Fireflies are small
+ * yellow-green point lights scattered at random over the lake; each one circles around its home
+ * position, bobs up and down and glows on and off with its own phase and speed. animate() moves
+ * them every frame, so the light manager has to bin them again each frame anyway.
+ */
+
+#include "NightLights.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+NightLights::NightLights() : first_firefly(0), lanterns(0) {}
+
+/**
+ * This method replaces the lights of the manager with the lanterns and fireflies.
+ */
+void NightLights::populate(LightManager& lights, const Fence& fence, const Lake& lake)
+{
+    lights.clear();
+
+    const glm::vec3 lantern_color(1.0f, 0.65f, 0.3f);
+    for (size_t post = 0; post < fence.postCount(); post += lantern_spacing)
+        lights.addPoint(fence.postPosition(post) + glm::vec3(0.0f, 1.2f, 0.0f), lantern_color, 6.0f);
+    lanterns = lights.size();
+
+    const float x0 = std::min(lake.start_x, lake.end_x), x1 = std::max(lake.start_x, lake.end_x);
+    const float z0 = std::min(lake.start_z, lake.end_z), z1 = std::max(lake.start_z, lake.end_z);
+    std::srand(17);
+    fireflies.clear();
+    first_firefly = lights.size();
+    for (size_t i = 0; i < firefly_count; ++i) {
+        const float x = x0 + (x1 - x0) * std::rand() / RAND_MAX;
+        const float z = z0 + (z1 - z0) * std::rand() / RAND_MAX;
+        const float height = lake.y + 0.5f + 1.5f * std::rand() / RAND_MAX;
+        fireflies.push_back({ glm::vec3(x, height, z), 6.2832f * std::rand() / RAND_MAX, 0.5f + 1.0f * std::rand() / RAND_MAX });
+        lights.addPoint(fireflies.back().home, glm::vec3(0.0f), 2.5f);
+    }
+}
+
+/**
+ * This method moves the fireflies along their loops and sets their glow for the given time in seconds.
+ */
+void NightLights::animate(LightManager& lights, float time) const
+{
+    if (first_firefly + fireflies.size() > lights.size())
+        return;
+
+    for (size_t i = 0; i < fireflies.size(); ++i) {
+        const Firefly& firefly = fireflies[i];
+        const float angle = firefly.phase + firefly.speed * time;
+        LightManager::Light& light = lights.light(first_firefly + i);
+        light.position = firefly.home + glm::vec3(1.5f * std::cos(angle), 0.3f * std::sin(3.0f * angle), 1.5f * std::sin(angle));
+        const float glow = std::max(std::sin(2.0f * angle + firefly.phase), 0.0f);
+        light.color = glow * glm::vec3(0.6f, 1.0f, 0.2f);
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "LightManager.h"
+#include "Fence.h"
+#include "Lake.h"
+
+/*
+NightLights fills a LightManager with the lights of the night scene: a lantern on every fifth
+post of the fence and a swarm of fireflies drifting over the lake.
+*/
+class NightLights
+{
+public:
+	static constexpr size_t lantern_spacing = 5; // Posts from one lantern to the next
+	static constexpr size_t firefly_count = 200;
+
+	NightLights();
+
+	void populate(LightManager& lights, const Fence& fence, const Lake& lake);
+	void animate(LightManager& lights, float time) const;
+	size_t lanternCount() const { return lanterns; }
+
+private:
+	struct Firefly {
+		glm::vec3 home; // Center of the firefly's loop
+		float phase;
+		float speed;
+	};
+
+	std::vector<Firefly> fireflies;
+	size_t first_firefly; // Index of the first firefly in the light manager
+	size_t lanterns;
+};
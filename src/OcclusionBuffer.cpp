@@ -0,0 +1,199 @@
+/**
+ * The OcclusionBuffer class implements a minimal software rasterizer for occlusion culling.
+ *
+ * Occluders are triangles (boxes are split into their 12 faces). Each triangle is transformed to clip
+ * space, clipped against the near plane, and rasterized at pixel centers with edge functions, four
+ * pixels at a time, keeping the nearest depth per pixel. Only depth is stored, at 256 x 128 pixels.
+ *
+ * A box is hidden when every pixel of its screen rectangle (grown by one pixel to make up for the
+ * low resolution and the center sampling) holds an occluder nearer than the box's nearest corner.
+ * Boxes crossing the near plane are always visible. The test reads no GPU state, so its result only
+ * depends on the matrices and the occluders.
+ */
+
+#include "OcclusionBuffer.h"
+#include <algorithm>
+#include <cmath>
+#include "Simd.h"
+
+OcclusionBuffer::OcclusionBuffer() : view_projection(1.0f), depths(width * height, 1.0f) {}
+
+/**
+ * This method clears the buffer and sets the projection * view matrix of the frame.
+ */
+void OcclusionBuffer::begin(const glm::mat4& matrix)
+{
+    view_projection = matrix;
+    std::fill(depths.begin(), depths.end(), 1.0f);
+}
+
+/**
+ * This method rasterizes the faces of a solid box.
+ */
+void OcclusionBuffer::addOccluder(const AABB& box)
+{
+    glm::vec4 corners[8];
+    for (int i = 0; i < 8; ++i) {
+        const glm::vec3 corner(i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y, i & 4 ? box.max.z : box.min.z);
+        corners[i] = view_projection * glm::vec4(corner, 1.0f);
+    }
+
+    // Two triangles per face, as corner indices (bit 0: x, bit 1: y, bit 2: z)
+    static const int faces[12][3] = {
+        { 0, 2, 3 }, { 0, 3, 1 }, { 4, 5, 7 }, { 4, 7, 6 }, // -z, +z
+        { 0, 4, 6 }, { 0, 6, 2 }, { 1, 3, 7 }, { 1, 7, 5 }, // -x, +x
+        { 0, 1, 5 }, { 0, 5, 4 }, { 2, 6, 7 }, { 2, 7, 3 }, // -y, +y
+    };
+    for (const auto& face : faces)
+        rasterize(corners[face[0]], corners[face[1]], corners[face[2]]);
+}
+
+/**
+ * This method rasterizes a single triangle given in world coordinates.
+ */
+void OcclusionBuffer::addTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    rasterize(view_projection * glm::vec4(a, 1.0f), view_projection * glm::vec4(b, 1.0f), view_projection * glm::vec4(c, 1.0f));
+}
+
+/**
+ * This method tells whether any part of the box may be visible past the occluders.
+ */
+bool OcclusionBuffer::visible(const AABB& box) const
+{
+    float min_x = static_cast<float>(width), min_y = static_cast<float>(height), max_x = 0.0f, max_y = 0.0f;
+    float nearest = 1.0f;
+    for (int i = 0; i < 8; ++i) {
+        const glm::vec3 corner(i & 1 ? box.max.x : box.min.x, i & 2 ? box.max.y : box.min.y, i & 4 ? box.max.z : box.min.z);
+        const glm::vec4 clip = view_projection * glm::vec4(corner, 1.0f);
+        if (clip.z < -clip.w || clip.w <= 0.0f)
+            return true; // The box crosses the near plane
+
+        const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        const float x = (ndc.x * 0.5f + 0.5f) * width;
+        const float y = (ndc.y * 0.5f + 0.5f) * height;
+        min_x = std::min(min_x, x);
+        max_x = std::max(max_x, x);
+        min_y = std::min(min_y, y);
+        max_y = std::max(max_y, y);
+        nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+    }
+
+    const int x0 = std::max(static_cast<int>(std::floor(min_x)) - 1, 0);
+    const int x1 = std::min(static_cast<int>(std::ceil(max_x)) + 1, width);
+    const int y0 = std::max(static_cast<int>(std::floor(min_y)) - 1, 0);
+    const int y1 = std::min(static_cast<int>(std::ceil(max_y)) + 1, height);
+    if (x0 >= x1 || y0 >= y1)
+        return true; // Outside the buffer, so the frustum test decides
+
+    for (int y = y0; y < y1; ++y) {
+        const float* row = &depths[y * width];
+        int x = x0;
+#ifdef SIMD_SSE
+        const __m128 box_depth = _mm_set1_ps(nearest);
+        for (; x + 4 <= x1; x += 4) {
+            if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), box_depth)))
+                return true;
+        }
+#endif
+        for (; x < x1; ++x) {
+            if (row[x] >= nearest)
+                return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * This helper clips a clip-space triangle against the near plane and rasterizes the result.
+ */
+void OcclusionBuffer::rasterize(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+{
+    // Sutherland-Hodgman against z >= -w leaves at most four vertices
+    const glm::vec4 input[3] = { a, b, c };
+    glm::vec4 polygon[4];
+    int count = 0;
+    for (int i = 0; i < 3; ++i) {
+        const glm::vec4& current = input[i];
+        const glm::vec4& next = input[(i + 1) % 3];
+        const float d_current = current.z + current.w;
+        const float d_next = next.z + next.w;
+        if (d_current >= 0.0f)
+            polygon[count++] = current;
+        if ((d_current >= 0.0f) != (d_next >= 0.0f))
+            polygon[count++] = current + (next - current) * (d_current / (d_current - d_next));
+    }
+    if (count < 3)
+        return;
+
+    // Screen coordinates (pixel units) and window depth
+    glm::vec3 screen[4];
+    for (int i = 0; i < count; ++i) {
+        const float w = std::max(polygon[i].w, 1e-6f);
+        screen[i] = glm::vec3((polygon[i].x / w * 0.5f + 0.5f) * width, (polygon[i].y / w * 0.5f + 0.5f) * height,
+            polygon[i].z / w * 0.5f + 0.5f);
+    }
+
+    for (int t = 1; t + 1 < count; ++t) {
+        glm::vec3 v0 = screen[0], v1 = screen[t], v2 = screen[t + 1];
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+        if (std::fabs(area) < 1e-8f)
+            continue;
+        if (area < 0.0f) {
+            // Both windings are occluders; make the edge functions positive inside
+            std::swap(v1, v2);
+            area = -area;
+        }
+
+        const int x0 = std::max(static_cast<int>(std::floor(std::min({ v0.x, v1.x, v2.x }))), 0) & ~3;
+        const int x1 = std::min(static_cast<int>(std::ceil(std::max({ v0.x, v1.x, v2.x }))), width);
+        const int y0 = std::max(static_cast<int>(std::floor(std::min({ v0.y, v1.y, v2.y }))), 0);
+        const int y1 = std::min(static_cast<int>(std::ceil(std::max({ v0.y, v1.y, v2.y }))), height);
+        if (x0 >= x1 || y0 >= y1)
+            continue;
+
+        // Edge functions e_i(x, y) = a_i x + b_i y + c_i, and the depth plane z(x, y) = zx x + zy y + z0
+        const glm::vec3 vertices[3] = { v0, v1, v2 };
+        float ea[3], eb[3], ec[3];
+        for (int e = 0; e < 3; ++e) {
+            const glm::vec3& p = vertices[(e + 1) % 3];
+            const glm::vec3& q = vertices[(e + 2) % 3];
+            ea[e] = p.y - q.y;
+            eb[e] = q.x - p.x;
+            ec[e] = p.x * q.y - p.y * q.x;
+        }
+        const float zx = (ea[0] * v0.z + ea[1] * v1.z + ea[2] * v2.z) / area;
+        const float zy = (eb[0] * v0.z + eb[1] * v1.z + eb[2] * v2.z) / area;
+        const float zc = (ec[0] * v0.z + ec[1] * v1.z + ec[2] * v2.z) / area;
+
+        for (int y = y0; y < y1; ++y) {
+            const float py = y + 0.5f;
+            float* row = &depths[y * width];
+#ifdef SIMD_SSE
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+            for (int x = x0; x < x1; x += 4) {
+                const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+                __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea[0]), px), _mm_set1_ps(eb[0] * py + ec[0])), zero);
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea[1]), px), _mm_set1_ps(eb[1] * py + ec[1])), zero));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(ea[2]), px), _mm_set1_ps(eb[2] * py + ec[2])), zero));
+                if (!_mm_movemask_ps(inside))
+                    continue;
+
+                const __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zx), px), _mm_set1_ps(zy * py + zc));
+                const __m128 old_depth = _mm_loadu_ps(row + x);
+                const __m128 new_depth = _mm_min_ps(old_depth, _mm_max_ps(z, zero));
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, new_depth), _mm_andnot_ps(inside, old_depth)));
+            }
+#else
+            for (int x = x0; x < x1; ++x) {
+                const float px = x + 0.5f;
+                if (ea[0] * px + eb[0] * py + ec[0] < 0.0f || ea[1] * px + eb[1] * py + ec[1] < 0.0f ||
+                    ea[2] * px + eb[2] * py + ec[2] < 0.0f)
+                    continue;
+                row[x] = std::min(row[x], std::max(zx * px + zy * py + zc, 0.0f));
+            }
+#endif
+        }
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "Frustum.h"
+
+/*
+OcclusionBuffer is a small depth buffer rendered on the CPU. Large occluders are rasterized into it,
+and bounding boxes are then tested against it to find objects that are completely hidden.
+*/
+class OcclusionBuffer
+{
+public:
+	static constexpr int width = 256;
+	static constexpr int height = 128;
+
+	OcclusionBuffer();
+
+	void begin(const glm::mat4& view_projection);
+	void addOccluder(const AABB& box);
+	void addTriangle(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c);
+	bool visible(const AABB& box) const;
+	float depth(int x, int y) const { return depths[y * width + x]; }
+
+private:
+	void rasterize(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+
+	glm::mat4 view_projection;
+	std::vector<float> depths; // Window depth in [0, 1] per pixel, 1 is the far plane
+};
@@ -8,6 +8,10 @@
  */
 
 #include "PointLight.h"
+#include "MeshLibrary.h"
+#include "GLState.h"
+#include "CoreRenderer.h"
+#include <glm/gtc/matrix_transform.hpp>
 #include <cmath> // For cos function
 /**
  * The default constructor initializes the PointLight object with a specific color, 
@@ -33,27 +37,37 @@ void PointLight::update(float deltaTime) {
  * The method also sets the spot cutoff to 180, resulting in uniform light distribution.
  */
 void PointLight::addLight() {
-	if (!glIsEnabled(GL_LIGHT0))
+	if (!GLState::isEnabled(GL_LIGHT0))
 		return;
-	glLightfv(GL_LIGHT0, GL_DIFFUSE, color);
-	glLightfv(GL_LIGHT0, GL_SPECULAR, color);
-	glLightfv(GL_LIGHT0, GL_POSITION, position);
+	GLState::light(GL_LIGHT0, GL_DIFFUSE, color);
+	GLState::light(GL_LIGHT0, GL_SPECULAR, color);
+	GLState::light(GL_LIGHT0, GL_POSITION, position);
 	//The initial spot cutoff is 180, resulting in uniform light distribution.
-	glLightf(GL_LIGHT1, GL_SPOT_CUTOFF, 180.0f);
+	GLState::light(GL_LIGHT1, GL_SPOT_CUTOFF, 180.0f);
 }
 /**
  * This method draws a visual representation of the point light source as a sphere 
- * with the color of the light source.
+ * with the color of the light source. The sphere is tessellated for its size on screen.
  */
 void PointLight::draw()
 {
-	if (!glIsEnabled(GL_LIGHT0))
+	if (!GLState::isEnabled(GL_LIGHT0))
 		return;
+	constexpr int level_slices[] = { 100, 24, 12, 6 };
+	const glm::vec3 center(position[0], position[1], position[2]);
+	const int slices = level_slices[lod.select(center, 0.2f)];
+
+	if (CoreRenderer::active()) {
+		CoreRenderer::drawUnlit(MeshLibrary::sphere(slices, slices), glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(0.2f)), color);
+		CoreRenderer::end();
+		return;
+	}
+
 	glPushMatrix();
-	glDisable(GL_LIGHTING);
+	GLState::disable(GL_LIGHTING);
 	glColor4fv(color);
-	glutSolidSphere(0.2, 100, 100);
-	glEnable(GL_LIGHTING);
+	MeshLibrary::solidSphere(0.2, slices, slices);
+	GLState::enable(GL_LIGHTING);
 	glPopMatrix();
 }
 /**
@@ -61,12 +75,12 @@ void PointLight::draw()
  */
 void PointLight::disable()
 {
-	glDisable(GL_LIGHT0);
+	GLState::disable(GL_LIGHT0);
 }
 /**
  * This method enables the point light source.
  */
 void PointLight::enable()
 {
-	glEnable(GL_LIGHT0);
+	GLState::enable(GL_LIGHT0);
 }
\ No newline at end of file
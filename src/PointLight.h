@@ -1,5 +1,7 @@
 #pragma once
+#include <GL/glew.h>
 #include <GL/freeglut.h>
+#include "LevelOfDetail.h"
 
 /*
 PointLight is light source with uniform light distribution.
@@ -11,6 +13,7 @@ public:
 	GLfloat position[4];
 	GLfloat speed;
 	GLfloat time;
+	LevelOfDetail lod{ { 200.0f, 40.0f, 10.0f } }; // Tessellation level of the sphere drawn by draw()
 	
 	PointLight();
 	void PointLight::update(float deltaTime);
@@ -0,0 +1,135 @@
+/**
+ * The ProgramBinaryCache class stores program binaries (GL 4.1 or GL_ARB_get_program_binary) in
+ * files named after a 64-bit FNV-1a hash of the program sources and the GL vendor, renderer and
+ * version strings, so a driver update or another GPU never picks up a stale binary. The sources
+ * hold several NUL-separated parts (the shader stages and attribute bindings), so every byte of
+ * them is hashed, followed by their length.
+ *
+ * A file holds a small header (magic number, binary format and length) followed by the binary.
+ * The magic number changes with the key, so files written under an older key are never loaded.
+ * Drivers may still refuse a binary they wrote themselves; load() then reports a miss and the
+ * caller compiles the program from source, which replaces the file.
+ */
+
+#include "ProgramBinaryCache.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+bool ProgramBinaryCache::enabled = true;
+std::string ProgramBinaryCache::prefix = "shader_cache_";
+unsigned int ProgramBinaryCache::loaded = 0;
+unsigned int ProgramBinaryCache::compiled = 0;
+
+namespace {
+    const uint32_t magic = 0x32434250; // "PBC2"
+}
+
+/**
+ * This method tells whether the driver can return program binaries in at least one format.
+ */
+bool ProgramBinaryCache::supported()
+{
+    if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary)
+        return false;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+}
+
+/**
+ * This method returns the cache key of a program with the given concatenated sources, which may
+ * contain NUL separators.
+ */
+uint64_t ProgramBinaryCache::key(const std::string& sources)
+{
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const char* bytes, size_t length) {
+        for (size_t i = 0; i < length; ++i) {
+            hash ^= static_cast<unsigned char>(bytes[i]);
+            hash *= 1099511628211ull;
+        }
+        for (int i = 0; i < 8; ++i) { // The length separates the strings
+            hash ^= static_cast<unsigned char>(static_cast<uint64_t>(length) >> (8 * i));
+            hash *= 1099511628211ull;
+        }
+    };
+    auto mix_string = [&mix](const GLubyte* text) {
+        const char* chars = reinterpret_cast<const char*>(text);
+        mix(chars, chars ? std::strlen(chars) : 0);
+    };
+    mix(sources.data(), sources.size());
+    mix_string(glGetString(GL_VENDOR));
+    mix_string(glGetString(GL_RENDERER));
+    mix_string(glGetString(GL_VERSION));
+    return hash;
+}
+
+/**
+ * This method loads the cached binary into the program and returns true if it linked.
+ */
+bool ProgramBinaryCache::load(GLuint program, uint64_t key)
+{
+    if (!enabled || !supported())
+        return false;
+
+    FILE* file = std::fopen(path(key).c_str(), "rb");
+    if (!file)
+        return false;
+
+    uint32_t header[3] = { 0, 0, 0 };
+    std::vector<char> binary;
+    bool read = std::fread(header, sizeof(header), 1, file) == 1 && header[0] == magic && header[2] > 0;
+    if (read) {
+        binary.resize(header[2]);
+        read = std::fread(binary.data(), binary.size(), 1, file) == 1;
+    }
+    std::fclose(file);
+    if (!read)
+        return false;
+
+    glProgramBinary(program, header[1], binary.data(), static_cast<GLsizei>(binary.size()));
+    GLint status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    if (status == GL_TRUE)
+        ++loaded;
+    return status == GL_TRUE;
+}
+
+/**
+ * This method writes the binary of a linked program to the cache. The program should have been
+ * linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+ */
+void ProgramBinaryCache::store(GLuint program, uint64_t key)
+{
+    ++compiled;
+    if (!enabled || !supported())
+        return;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    FILE* file = std::fopen(path(key).c_str(), "wb");
+    if (!file)
+        return;
+    const uint32_t header[3] = { magic, static_cast<uint32_t>(format), static_cast<uint32_t>(length) };
+    std::fwrite(header, sizeof(header), 1, file);
+    std::fwrite(binary.data(), binary.size(), 1, file);
+    std::fclose(file);
+}
+
+/**
+ * This helper returns the file name of the given key.
+ */
+std::string ProgramBinaryCache::path(uint64_t key)
+{
+    char name[17];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return prefix + name + ".bin";
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <GL/glew.h>
+
+/*
+ProgramBinaryCache keeps linked GLSL programs on disk, keyed by their sources and the driver, so a
+warm start loads each program instead of compiling and linking it again.
+*/
+class ProgramBinaryCache
+{
+public:
+	static bool supported();
+	static uint64_t key(const std::string& sources);
+	static bool load(GLuint program, uint64_t key);
+	static void store(GLuint program, uint64_t key);
+
+	static unsigned int hits() { return loaded; }
+	static unsigned int misses() { return compiled; }
+
+	static bool enabled; // When false every program is compiled from source
+	static std::string prefix; // Path prefix of the cache files
+
+private:
+	static std::string path(uint64_t key);
+
+	static unsigned int loaded, compiled;
+};
@@ -0,0 +1,202 @@
+/**
+ * The Quadtree class stores the bounding boxes of the scene objects over the ground plane. Each item
+ * is kept in the deepest node whose square contains the item's x-z extent, so large objects stay near
+ * the root and small ones sink into the leaves. After all items are inserted, build() computes the
+ * 3D bounds of every subtree and packs the boxes four by four for the SIMD frustum test.
+ *
+ * A query walks the tree from the root. The four children of a node are tested with one
+ * Frustum::test(...) call; children outside the frustum are skipped with everything below them,
+ * and children completely inside are accepted without testing their items.
+ */
+
+#include "Quadtree.h"
+#include <limits>
+
+/**
+ * The constructor creates an empty tree covering the given rectangle of the ground plane.
+ */
+Quadtree::Quadtree(const glm::vec2& area_min, const glm::vec2& area_max, int max_depth)
+    : area_min(area_min), area_max(area_max), max_depth(max_depth), item_count(0)
+{
+    clear();
+}
+
+/**
+ * This method removes all items.
+ */
+void Quadtree::clear()
+{
+    nodes.clear();
+    item_count = 0;
+    createNode(area_min, area_max);
+}
+
+/**
+ * This method adds an item. build() must be called before the next query.
+ */
+void Quadtree::insert(uint32_t id, const AABB& box)
+{
+    int node = 0;
+    for (int depth = 0; depth < max_depth; ++depth) {
+        if (nodes[node].children[0] < 0)
+            split(node);
+
+        int inside_child = -1;
+        for (int child : nodes[node].children) {
+            const Node& candidate = nodes[child];
+            if (box.min.x >= candidate.area_min.x && box.max.x <= candidate.area_max.x &&
+                box.min.z >= candidate.area_min.y && box.max.z <= candidate.area_max.y) {
+                inside_child = child;
+                break;
+            }
+        }
+        if (inside_child < 0)
+            break;
+        node = inside_child;
+    }
+
+    nodes[node].ids.push_back(id);
+    nodes[node].boxes.push_back(box);
+    ++item_count;
+}
+
+/**
+ * This method computes the bounds of the subtrees and packs the boxes for querying.
+ */
+void Quadtree::build()
+{
+    finish(0);
+}
+
+/**
+ * This method appends the ids of the items overlapping the frustum to 'visible' and updates the
+ * statistics returned by stats().
+ */
+void Quadtree::query(const Frustum& frustum, std::vector<uint32_t>& visible)
+{
+    last_stats = Stats();
+    const size_t first = visible.size();
+
+    const Node& root = nodes[0];
+    ++last_stats.boxes_tested;
+    if (frustum.intersects(root.bounds))
+        visit(0, frustum, false, visible);
+
+    last_stats.visible = visible.size() - first;
+    last_stats.culled = item_count - last_stats.visible;
+}
+
+/**
+ * This helper appends a node for the given square and returns its index.
+ */
+int Quadtree::createNode(const glm::vec2& node_min, const glm::vec2& node_max)
+{
+    Node node;
+    node.area_min = node_min;
+    node.area_max = node_max;
+    node.children[0] = node.children[1] = node.children[2] = node.children[3] = -1;
+    node.child_boxes.clear();
+    nodes.push_back(node);
+    return static_cast<int>(nodes.size()) - 1;
+}
+
+/**
+ * This helper creates the four children of a leaf.
+ */
+void Quadtree::split(int node)
+{
+    const glm::vec2 low = nodes[node].area_min;
+    const glm::vec2 high = nodes[node].area_max;
+    const glm::vec2 middle = (low + high) * 0.5f;
+
+    // createNode may reallocate the node vector, so the children are stored afterwards
+    const int children[4] = {
+        createNode(low, middle),
+        createNode(glm::vec2(middle.x, low.y), glm::vec2(high.x, middle.y)),
+        createNode(glm::vec2(low.x, middle.y), glm::vec2(middle.x, high.y)),
+        createNode(middle, high),
+    };
+    for (int i = 0; i < 4; ++i)
+        nodes[node].children[i] = children[i];
+}
+
+/**
+ * This helper computes the bounds of a subtree and packs its boxes. Empty subtrees get an empty
+ * box, which no frustum intersects.
+ */
+AABB Quadtree::finish(int node)
+{
+    const float huge = std::numeric_limits<float>::max();
+    AABB bounds = { glm::vec3(huge), glm::vec3(-huge) };
+
+    Node* current = &nodes[node];
+    current->packs.assign((current->boxes.size() + 3) / 4, AABB4());
+    for (AABB4& pack : current->packs)
+        pack.clear();
+    for (size_t i = 0; i < current->boxes.size(); ++i) {
+        current->packs[i / 4].set(static_cast<int>(i % 4), current->boxes[i]);
+        bounds.min = glm::min(bounds.min, current->boxes[i].min);
+        bounds.max = glm::max(bounds.max, current->boxes[i].max);
+    }
+
+    if (current->children[0] >= 0) {
+        for (int i = 0; i < 4; ++i) {
+            const AABB child = finish(nodes[node].children[i]);
+            nodes[node].child_boxes.set(i, child);
+            bounds.min = glm::min(bounds.min, child.min);
+            bounds.max = glm::max(bounds.max, child.max);
+        }
+    }
+
+    nodes[node].bounds = bounds;
+    return bounds;
+}
+
+/**
+ * This helper collects the visible items of a node that overlaps the frustum. When the node is
+ * completely inside, everything below it is visible and no more tests are needed.
+ */
+void Quadtree::visit(int node, const Frustum& frustum, bool inside, std::vector<uint32_t>& visible)
+{
+    if (inside) {
+        acceptAll(node, visible);
+        return;
+    }
+    ++last_stats.nodes_visited;
+
+    const Node& current = nodes[node];
+    for (size_t pack = 0; pack < current.packs.size(); ++pack) {
+        int intersecting, fully_inside;
+        frustum.test(current.packs[pack], intersecting, fully_inside);
+        last_stats.boxes_tested += 4;
+        for (int lane = 0; lane < 4; ++lane) {
+            if (intersecting & (1 << lane))
+                visible.push_back(current.ids[pack * 4 + lane]);
+        }
+    }
+
+    if (current.children[0] < 0)
+        return;
+
+    int intersecting, fully_inside;
+    frustum.test(current.child_boxes, intersecting, fully_inside);
+    last_stats.boxes_tested += 4;
+    for (int i = 0; i < 4; ++i) {
+        if (intersecting & (1 << i))
+            visit(current.children[i], frustum, (fully_inside & (1 << i)) != 0, visible);
+    }
+}
+
+/**
+ * This helper appends every item of a subtree.
+ */
+void Quadtree::acceptAll(int node, std::vector<uint32_t>& visible)
+{
+    ++last_stats.nodes_visited;
+    const Node& current = nodes[node];
+    visible.insert(visible.end(), current.ids.begin(), current.ids.end());
+    if (current.children[0] >= 0) {
+        for (int child : current.children)
+            acceptAll(child, visible);
+    }
+}
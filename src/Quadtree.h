@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Frustum.h"
+
+/*
+Quadtree partitions the ground plane (x-z) into nested squares. Items are bounding boxes with an
+id; a query returns the ids of the items inside a view frustum, testing four boxes at a time.
+*/
+class Quadtree
+{
+public:
+	struct Stats {
+		size_t nodes_visited = 0;
+		size_t boxes_tested = 0;
+		size_t visible = 0;
+		size_t culled = 0;
+	};
+
+	Quadtree(const glm::vec2& area_min, const glm::vec2& area_max, int max_depth = 5);
+
+	void clear();
+	void insert(uint32_t id, const AABB& box);
+	void build();
+	void query(const Frustum& frustum, std::vector<uint32_t>& visible);
+	size_t size() const { return item_count; }
+	const Stats& stats() const { return last_stats; }
+
+private:
+	struct Node {
+		glm::vec2 area_min, area_max; // Square of the ground plane covered by the node
+		AABB bounds; // Bounds of everything stored in the node and below it
+		int children[4]; // -1 when the node is a leaf
+		std::vector<uint32_t> ids;
+		std::vector<AABB> boxes;
+		std::vector<AABB4> packs; // The boxes, four per pack, filled by build()
+		AABB4 child_boxes; // Bounds of the four children, filled by build()
+	};
+
+	int createNode(const glm::vec2& area_min, const glm::vec2& area_max);
+	void split(int node);
+	AABB finish(int node);
+	void visit(int node, const Frustum& frustum, bool inside, std::vector<uint32_t>& visible);
+	void acceptAll(int node, std::vector<uint32_t>& visible);
+
+	std::vector<Node> nodes;
+	glm::vec2 area_min, area_max;
+	int max_depth;
+	size_t item_count;
+	Stats last_stats;
+};
@@ -0,0 +1,180 @@
+/**
+ * The QualityGovernor class adapts the detail of the scene to the machine it runs on.
+ *
+ * update() is called once per frame with the work of the previous frame (FramePacer): the longer
+ * of its CPU and GPU times, which leaves out the frame rate cap's sleep, the idle time between
+ * frames drawn on demand and the swap's wait for the vertical blank. After a window of 90 frames it
+ * takes their median and 90th percentile. The slow frames decide, because they are the ones seen
+ * as stutter:
+ * - when the 90th percentile is over the target by more than 15%, the preset goes down one step at
+ *   once;
+ * - when it is under 75% of the target for a few windows in a row, the preset goes up one step.
+ * The gap between the two thresholds, and the calm windows needed to go up, keep the governor from
+ * flipping between two presets. When a step up is undone by the very next window, twice as many
+ * calm windows are needed before trying it again; a step up that holds resets that count.
+ *
+ * Each preset sets the expensive knobs of the scene together: the stalks of the GPU wheat field,
+ * the tessellation of the cow and the light spheres (through their level of detail), the recursion
+ * depth of the trees, the sides of the fence posts, the far plane and the lighting (spotlight
+ * shadows and the number of local lights per object or cluster). The last preset is the full
+ * scene, which is where the governor starts. Every decision is printed and kept for the menu. The
+ * wheat density and the shadows can also be set in the menu: once the user moves one of them away
+ * from the value of the current preset, the governor leaves it as the user set it from then on.
+ *
+ * Pinned to a preset, for benchmarks or comparisons, the governor applies it and ignores the frame
+ * times. Since the work excludes the vertical sync, a target at the refresh interval keeps the
+ * frames within it while leaving room to go up.
+ */
+
+#include "QualityGovernor.h"
+#include "Context.h"
+#include <algorithm>
+#include <cctype>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+const QualityGovernor::Preset QualityGovernor::presets[QualityGovernor::preset_count] = {
+    { "Low", 4.0f, 0.35f, 2, 6, 70.0f, 0 },
+    { "Medium", 6.0f, 0.6f, 1, 10, 100.0f, 1 },
+    { "High", 8.0f, 0.8f, 0, 14, 125.0f, 2 },
+    { "Full", 10.0f, 1.0f, 0, 20, 150.0f, 2 },
+};
+
+namespace {
+    const int base_windows_to_raise = 3;
+    const int max_windows_to_raise = 48;
+    const unsigned int kept_decisions = 8;
+}
+
+QualityGovernor::QualityGovernor() : current(-1), p50(0.0), p90(0.0), calm_windows(0),
+    windows_to_raise(base_windows_to_raise), just_raised(false), user_wheat(false), user_shadows(false)
+{
+    frames.reserve(window_size);
+}
+
+/**
+ * This method returns the preset with the given name, in any case, or -1.
+ */
+int QualityGovernor::find(const std::string& name)
+{
+    for (int i = 0; i < preset_count; ++i) {
+        const std::string preset = presets[i].name;
+        if (preset.size() == name.size() && std::equal(preset.begin(), preset.end(), name.begin(),
+            [](char a, char b) { return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b)); }))
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * This method is called at the start of every frame with the work of the previous one. It
+ * applies the pinned preset, or collects the time and decides on the preset once a window is full.
+ */
+void QualityGovernor::update(Context& context, double frame_milliseconds)
+{
+    if (pinned >= preset_count)
+        pinned = preset_count - 1;
+    if (pinned >= 0) {
+        if (current != pinned) {
+            record(std::string("pinned to ") + presets[pinned].name);
+            apply(context, pinned);
+        }
+        frames.clear();
+        return;
+    }
+    if (current < 0)
+        apply(context, preset_count - 1);
+    if (!automatic || frame_milliseconds <= 0.0) {
+        frames.clear();
+        return;
+    }
+
+    frames.push_back(frame_milliseconds);
+    if (frames.size() >= window_size) {
+        decide(context);
+        frames.clear();
+    }
+}
+
+/**
+ * This method sets the knobs of the scene to the given preset.
+ */
+void QualityGovernor::apply(Context& context, int preset)
+{
+    // The knobs also in the menu are left alone once the user moved them away from the last preset
+    if (current >= 0) {
+        user_wheat = user_wheat || context.wheatCrop.stalksPerUnit != presets[current].wheatDensity;
+        user_shadows = user_shadows || context.shadows.enabled != (presets[current].lighting >= 2);
+    }
+
+    current = std::min(std::max(preset, 0), preset_count - 1);
+    const Preset& values = presets[current];
+
+    if (!user_wheat)
+        context.wheatCrop.stalksPerUnit = values.wheatDensity;
+    context.cow.setDetail(values.objectDetail);
+    context.pointlight.lod.detail = values.objectDetail;
+    context.spotlight.lod.detail = values.objectDetail;
+    context.forest.droppedLevels = values.treeLevelsDropped;
+    context.fence.postSlices = values.fenceSlices;
+    context.farPlane = values.farPlane;
+    if (!user_shadows)
+        context.shadows.enabled = values.lighting >= 2;
+    context.lights.lightLimit = values.lighting >= 1 ? 0 : 2;
+    context.shadows.invalidate(); // The fence is a static caster
+}
+
+/**
+ * This helper takes the percentiles of the window and moves the preset one step if needed.
+ */
+void QualityGovernor::decide(Context& context)
+{
+    std::vector<double> sorted(frames);
+    std::sort(sorted.begin(), sorted.end());
+    p50 = sorted[sorted.size() / 2];
+    p90 = sorted[sorted.size() * 9 / 10];
+
+    std::ostringstream percentiles;
+    percentiles << std::fixed << std::setprecision(1) << "median " << p50 << " ms, 90th percentile " << p90
+        << " ms, target " << targetMilliseconds << " ms: ";
+
+    if (p90 > targetMilliseconds * 1.15f) {
+        if (just_raised)
+            windows_to_raise = std::min(windows_to_raise * 2, max_windows_to_raise);
+        just_raised = false;
+        calm_windows = 0;
+        if (current > 0) {
+            record(percentiles.str() + "lowering quality to " + presets[current - 1].name);
+            apply(context, current - 1);
+        }
+        return;
+    }
+
+    if (just_raised)
+        windows_to_raise = base_windows_to_raise;
+    just_raised = false;
+
+    if (p90 < targetMilliseconds * 0.75f && current < preset_count - 1) {
+        if (++calm_windows >= windows_to_raise) {
+            record(percentiles.str() + "raising quality to " + presets[current + 1].name);
+            apply(context, current + 1);
+            calm_windows = 0;
+            just_raised = true;
+        }
+    }
+    else {
+        calm_windows = 0;
+    }
+}
+
+/**
+ * This helper prints a decision and keeps the last few for the menu.
+ */
+void QualityGovernor::record(const std::string& decision)
+{
+    std::cout << "Quality governor: " << decision << std::endl;
+    log.push_back(decision);
+    if (log.size() > kept_decisions)
+        log.erase(log.begin());
+}
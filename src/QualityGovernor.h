@@ -0,0 +1,57 @@
+#pragma once
+#include <string>
+#include <vector>
+
+class Context;
+
+/*
+QualityGovernor holds the frame time within a target on any machine by trading scene detail for
+speed. It keeps the work times of the recent frames and, once a window of them is complete, steps
+through a ladder of quality presets from their percentiles: down when the slow frames miss the
+target, up when even they leave plenty of room. It can be pinned to one preset instead.
+*/
+class QualityGovernor
+{
+public:
+	struct Preset {
+		const char* name;
+		float wheatDensity; // Stalks per unit of the GPU wheat field
+		float objectDetail; // Level of detail scale of the cow and the light spheres
+		int treeLevelsDropped; // Levels of recursion dropped from every tree
+		int fenceSlices; // Sides of the fence posts
+		float farPlane; // Distance of the far clipping plane
+		int lighting; // 0: no shadows and two local lights, 1: no shadows, 2: shadows
+	};
+
+	static constexpr int preset_count = 4;
+	static constexpr int window_size = 90; // Frames whose percentiles are compared with the target
+	static const Preset presets[preset_count]; // From the cheapest to the full scene
+
+	QualityGovernor();
+
+	static int find(const std::string& name);
+	void update(Context& context, double frame_milliseconds);
+	void apply(Context& context, int preset);
+
+	int preset() const { return current; }
+	double median() const { return p50; }
+	double slowFrames() const { return p90; }
+	const std::vector<std::string>& decisions() const { return log; }
+
+	bool automatic = true; // Choose the preset from the frame times
+	int pinned = -1; // Preset used whatever the frame times, -1 for none
+	float targetMilliseconds = 1000.0f / 60.0f; // Frame time to stay within
+
+private:
+	void decide(Context& context);
+	void record(const std::string& decision);
+
+	int current; // Preset applied, -1 before the first frame
+	std::vector<double> frames; // Work times of the frames of the current window
+	double p50, p90;
+	int calm_windows; // Windows in a row with room to spare
+	int windows_to_raise; // Calm windows needed to go up a preset, doubled when going up failed
+	bool just_raised; // The preset was raised at the end of the previous window
+	bool user_wheat, user_shadows; // The user set these knobs in the menu, so presets leave them alone
+	std::vector<std::string> log;
+};
@@ -0,0 +1,92 @@
+/**
+ * The RedrawScheduler class replaces the unconditional glutPostRedisplay() at the end of every
+ * frame. display() calls endFrame(...) last, telling whether something animates at full rate this
+ * frame (an ImGui widget being dragged, the cow walking).
+ *
+ * In on-demand mode the next frame is requested right away only when:
+ * - input arrived: the input callbacks call invalidate(), which asks for two frames, because ImGui
+ *   reacts to an event (hover, click) in the frame after the one that received it;
+ * - something animates at full rate;
+ * - the watched scene state changed during the frame. The memory ranges given to watch(...) (the
+ *   camera, the lights, the cow's pose, scene settings) are hashed after each frame, so changes
+ *   made by code rather than input are drawn as well.
+ *
+ * Otherwise a GLUT timer draws the next frame after 1 / idleRate seconds, which keeps the ambient
+ * animations (the point light's sweep, the tail, the fireflies) going at a low cost. With an idle
+ * rate of 0 nothing is drawn until the next change.
+ */
+
+#include "RedrawScheduler.h"
+#include <algorithm>
+#include <GL/freeglut.h>
+
+bool RedrawScheduler::tick_scheduled = false;
+RedrawScheduler* RedrawScheduler::ticking = nullptr;
+
+RedrawScheduler::RedrawScheduler() : last_signature(0), pending(0), ticks(0) {}
+
+/**
+ * This method adds a range of memory whose changes make the scene dirty.
+ */
+void RedrawScheduler::watch(const void* data, size_t size)
+{
+    watched.emplace_back(data, size);
+}
+
+/**
+ * This method marks the scene dirty after input, and asks for the given number of frames.
+ */
+void RedrawScheduler::invalidate(int frames)
+{
+    pending = std::max(pending, frames);
+    glutPostRedisplay();
+}
+
+/**
+ * This method is called at the end of each frame and requests the next one: at once when drawing
+ * continuously, after input, while animating or after a change of the watched state, and from the
+ * idle timer otherwise.
+ */
+void RedrawScheduler::endFrame(bool animating)
+{
+    pending = std::max(pending - 1, 0);
+    const uint64_t current = signature();
+    const bool changed = current != last_signature;
+    last_signature = current;
+
+    if (!onDemand || animating || changed || pending > 0) {
+        glutPostRedisplay();
+        return;
+    }
+
+    if (!tick_scheduled && idleRate > 0.0f) {
+        tick_scheduled = true;
+        ticking = this;
+        glutTimerFunc(static_cast<unsigned int>(1000.0f / idleRate), tick, 0);
+    }
+}
+
+/**
+ * This helper hashes the watched memory (FNV-1a).
+ */
+uint64_t RedrawScheduler::signature() const
+{
+    uint64_t hash = 14695981039346656037ull;
+    for (const auto& range : watched) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(range.first);
+        for (size_t i = 0; i < range.second; ++i)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * This helper is the idle timer: it draws the next frame of the ambient animations.
+ */
+void RedrawScheduler::tick(int)
+{
+    tick_scheduled = false;
+    if (ticking)
+        ++ticking->ticks;
+    glutPostRedisplay();
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/*
+RedrawScheduler decides when the window is drawn again. Continuously, every frame asks for the
+next one. On demand, a frame is only drawn after input, while something animates at full rate or
+when watched scene state changed; otherwise the ambient animations advance at a low tick rate.
+*/
+class RedrawScheduler
+{
+public:
+	RedrawScheduler();
+
+	void watch(const void* data, size_t size);
+	void invalidate(int frames = 2);
+	void endFrame(bool animating);
+	unsigned int idleTicks() const { return ticks; }
+
+	bool onDemand = false; // Draw only when something changed, instead of continuously
+	float idleRate = 4.0f; // Frames per second of the ambient animations while nothing else changes, 0 for none
+
+private:
+	uint64_t signature() const;
+	static void tick(int);
+
+	std::vector<std::pair<const void*, size_t>> watched; // Memory compared after every frame
+	uint64_t last_signature;
+	int pending; // Frames still to draw after input
+	unsigned int ticks; // Frames drawn by the idle timer
+
+	static bool tick_scheduled;
+	static RedrawScheduler* ticking; // Scheduler waiting for the idle timer
+};
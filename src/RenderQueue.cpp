@@ -0,0 +1,131 @@
+/**
+ * The RenderQueue class orders the draw items of a frame by a 64-bit key:
+ *
+ *   opaque:      pass (2 bits) | material (16) | mesh (16) | depth (24)
+ *   transparent: pass (2 bits) | inverted depth (24) | material (16) | mesh (16)
+ *
+ * Opaque items are therefore grouped by material, then by mesh, and drawn front to back inside each
+ * group, which keeps state changes low and lets the depth test reject hidden fragments early.
+ * Transparent items come after all opaque ones, farthest first, so blending sees what is behind them.
+ *
+ * The depth is the view-space distance of the item center, quantized to 24 bits over 256 units.
+ * Items spreading over the whole scene have no single distance and are submitted without a center;
+ * they get depth 0, so among the opaque items only their material and mesh order them.
+ * The keys are sorted with an LSD radix sort, one pass per byte; passes over a byte that is the
+ * same in all keys are skipped.
+ */
+
+#include "RenderQueue.h"
+#include <algorithm>
+
+/**
+ * This method starts a frame: it drops the previous items and records the view matrix used to
+ * compute the depth of the submitted items.
+ */
+void RenderQueue::begin(const glm::mat4& view_matrix)
+{
+    items.clear();
+    view = view_matrix;
+}
+
+/**
+ * This method adds a draw item. The center (in world coordinates) gives the item's depth.
+ */
+void RenderQueue::submit(Pass pass, uint16_t material, uint16_t mesh, const glm::vec3& center, std::function<void()> draw)
+{
+    const float depth = -(view * glm::vec4(center, 1.0f)).z;
+    items.push_back(Item{ makeKey(pass, material, mesh, depth), std::move(draw) });
+}
+
+/**
+ * This method adds a draw item without a depth, for objects spread over the scene whose parts are
+ * at every distance (the forest, the fence, the wheat, the ground).
+ */
+void RenderQueue::submit(Pass pass, uint16_t material, uint16_t mesh, std::function<void()> draw)
+{
+    items.push_back(Item{ makeKey(pass, material, mesh, 0.0f), std::move(draw) });
+}
+
+/**
+ * This method sorts the items and draws them.
+ */
+void RenderQueue::flush()
+{
+    entries.resize(items.size());
+    for (size_t i = 0; i < items.size(); ++i)
+        entries[i] = SortEntry{ items[i].key, static_cast<uint32_t>(i) };
+    if (sorting)
+        radixSort();
+
+    for (const SortEntry& entry : entries)
+        items[entry.item].draw();
+
+    last_count = items.size();
+    items.clear();
+}
+
+/**
+ * This method returns the id of a material, registering it on first use. Id 0 is reserved for
+ * items with mixed materials.
+ */
+uint16_t RenderQueue::materialId(const Material& material)
+{
+    auto found = std::find(materials.begin(), materials.end(), material);
+    if (found == materials.end()) {
+        materials.push_back(material);
+        found = materials.end() - 1;
+    }
+    return static_cast<uint16_t>(found - materials.begin() + 1);
+}
+
+/**
+ * This method returns the id of a mesh (any object owning vertex buffers), registering it on
+ * first use. Id 0 is reserved for items without a single mesh.
+ */
+uint16_t RenderQueue::meshId(const void* mesh)
+{
+    auto found = meshes.find(mesh);
+    if (found == meshes.end())
+        found = meshes.emplace(mesh, static_cast<uint16_t>(meshes.size() + 1)).first;
+    return found->second;
+}
+
+/**
+ * This helper builds the sort key of an item.
+ */
+uint64_t RenderQueue::makeKey(Pass pass, uint16_t material, uint16_t mesh, float depth)
+{
+    const float range = 256.0f;
+    const uint64_t max_depth = (1u << 24) - 1;
+    const uint64_t quantized = static_cast<uint64_t>(std::min(std::max(depth, 0.0f) / range, 1.0f) * max_depth);
+
+    const uint64_t key = static_cast<uint64_t>(pass) << 62;
+    if (pass == Transparent)
+        return key | (max_depth - quantized) << 32 | static_cast<uint64_t>(material) << 16 | mesh;
+    return key | static_cast<uint64_t>(material) << 40 | static_cast<uint64_t>(mesh) << 24 | quantized;
+}
+
+/**
+ * This helper sorts the entries by key with a stable LSD radix sort over the eight bytes.
+ */
+void RenderQueue::radixSort()
+{
+    scratch.resize(entries.size());
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t offsets[256] = {};
+        for (const SortEntry& entry : entries)
+            ++offsets[(entry.key >> shift) & 0xff];
+        if (entries.empty() || offsets[(entries[0].key >> shift) & 0xff] == entries.size())
+            continue; // The byte is the same in all keys
+
+        size_t total = 0;
+        for (size_t& offset : offsets) {
+            const size_t count = offset;
+            offset = total;
+            total += count;
+        }
+        for (const SortEntry& entry : entries)
+            scratch[offsets[(entry.key >> shift) & 0xff]++] = entry;
+        entries.swap(scratch);
+    }
+}
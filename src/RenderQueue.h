@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "Material.h"
+
+/*
+RenderQueue collects the draw items of a frame, each with a 64-bit sort key, and draws them sorted:
+opaque items grouped by material and mesh and front to back, then transparent items back to front.
+*/
+class RenderQueue
+{
+public:
+	enum Pass { Opaque = 0, Transparent = 1 };
+
+	static constexpr uint16_t mixed = 0; // Material or mesh id of items that set up their own state
+
+	void begin(const glm::mat4& view_matrix);
+	void submit(Pass pass, uint16_t material, uint16_t mesh, const glm::vec3& center, std::function<void()> draw);
+	void submit(Pass pass, uint16_t material, uint16_t mesh, std::function<void()> draw);
+	void flush();
+
+	uint16_t materialId(const Material& material);
+	uint16_t meshId(const void* mesh);
+	size_t itemCount() const { return last_count; }
+
+	bool sorting = true; // When false items are drawn in submission order
+
+private:
+	struct Item {
+		uint64_t key;
+		std::function<void()> draw;
+	};
+	struct SortEntry {
+		uint64_t key;
+		uint32_t item;
+	};
+
+	static uint64_t makeKey(Pass pass, uint16_t material, uint16_t mesh, float depth);
+	void radixSort();
+
+	std::vector<Item> items;
+	std::vector<SortEntry> entries;
+	std::vector<SortEntry> scratch;
+	glm::mat4 view = glm::mat4(1.0f);
+	std::vector<Material> materials;
+	std::unordered_map<const void*, uint16_t> meshes;
+	size_t last_count = 0;
+};
@@ -0,0 +1,153 @@
+/**
+ * The SceneCulling class gives every object of the scene a bounding box and tests the boxes against
+ * the view frustum once per frame. The trees, fence sections, wheat field tiles and static batch
+ * groups are inserted into a quadtree by build(); the cow, the two light gizmos, the ground, the
+ * farmhouse and the lake are packed into two sets of four boxes and tested with the SIMD frustum test.
+ *
+ * The results are plain visibility arrays that the objects' draw methods accept, and counters of the
+ * visible and culled objects for the Performance menu. build() must be called again when static
+ * objects are added or removed.
+ *
+ * With occlusion culling on, the objects inside the frustum are also tested against an OcclusionBuffer
+ * holding the solid cube of the farmhouse and boxes inside the visible tree trunks. The ground is not
+ * an occluder: it is flat at y = 0, where it cannot hide anything of the meadow, which all stands on it.
+ */
+
+#include "SceneCulling.h"
+#include "Context.h"
+#include <algorithm>
+
+SceneCulling::SceneCulling() : quadtree(glm::vec2(-51.0f), glm::vec2(51.0f)), visible_count(0), culled_count(0), occluded_count(0) {}
+
+/**
+ * This method fills the quadtree with the static objects of the context.
+ */
+void SceneCulling::build(const Context& context)
+{
+    quadtree.clear();
+    for (size_t i = 0; i < context.forest.size(); ++i)
+        quadtree.insert(itemId(TreeItem, i), context.forest.bounds(i));
+    for (size_t i = 0; i < context.fence.sectionCount(); ++i)
+        quadtree.insert(itemId(FenceSectionItem, i), context.fence.sectionBounds(i));
+    for (int i = 0; i < WheatField::tileCount(); ++i)
+        quadtree.insert(itemId(WheatTileItem, i), context.wheatCrop.tileBounds(i));
+    for (size_t i = 0; i < context.staticScene.groupCount(); ++i)
+        quadtree.insert(itemId(StaticGroupItem, i), context.staticScene.groupBounds(i));
+    quadtree.build();
+
+    trees.assign(context.forest.size(), 1);
+    fenceSections.assign(context.fence.sectionCount(), 1);
+    wheatTiles.assign(WheatField::tileCount(), 1);
+    staticGroups.assign(context.staticScene.groupCount(), 1);
+}
+
+/**
+ * This method computes the visibility of every object for the given projection * view matrix.
+ */
+void SceneCulling::update(const Context& context, const glm::mat4& view_projection)
+{
+    const size_t total = quadtree.size() + 6;
+    if (!enabled) {
+        std::fill(trees.begin(), trees.end(), 1);
+        std::fill(fenceSections.begin(), fenceSections.end(), 1);
+        std::fill(wheatTiles.begin(), wheatTiles.end(), 1);
+        std::fill(staticGroups.begin(), staticGroups.end(), 1);
+        cow = pointlight = spotlight = ground = farmhouse = lake = true;
+        visible_count = total;
+        culled_count = 0;
+        occluded_count = 0;
+        return;
+    }
+
+    const Frustum frustum(view_projection);
+
+    // Static objects
+    std::fill(trees.begin(), trees.end(), 0);
+    std::fill(fenceSections.begin(), fenceSections.end(), 0);
+    std::fill(wheatTiles.begin(), wheatTiles.end(), 0);
+    std::fill(staticGroups.begin(), staticGroups.end(), 0);
+
+    visible_ids.clear();
+    quadtree.query(frustum, visible_ids);
+    std::vector<char>* lists[] = { &trees, &fenceSections, &wheatTiles, &staticGroups };
+    for (uint32_t id : visible_ids) {
+        std::vector<char>& list = *lists[id >> 24];
+        const size_t index = id & 0xffffff;
+        if (index < list.size())
+            list[index] = 1;
+    }
+
+    // Moving and unbatched objects, four at a time
+    const glm::vec3 cow_position(context.cow.local_coords[3]);
+    const glm::vec3 pointlight_position(context.pointlight.position[0], context.pointlight.position[1], context.pointlight.position[2]);
+    const glm::vec3 spotlight_position(context.spotlight.position[0], context.spotlight.position[1], context.spotlight.position[2]);
+    const AABB boxes[6] = {
+        { cow_position - glm::vec3(1.5f, 1.5f, 1.5f), cow_position + glm::vec3(1.5f, 1.5f, 1.5f) },
+        { pointlight_position - glm::vec3(0.2f), pointlight_position + glm::vec3(0.2f) },
+        { spotlight_position - glm::vec3(0.7f), spotlight_position + glm::vec3(0.7f) },
+        context.ground.bounds(),
+        context.farmhouse.bounds(),
+        context.lake.bounds(),
+    };
+    bool* results[6] = { &cow, &pointlight, &spotlight, &ground, &farmhouse, &lake };
+
+    size_t dynamic_visible = 0;
+    for (int first = 0; first < 6; first += 4) {
+        AABB4 pack;
+        pack.clear();
+        for (int lane = 0; lane < 4 && first + lane < 6; ++lane)
+            pack.set(lane, boxes[first + lane]);
+
+        int intersecting, inside;
+        frustum.test(pack, intersecting, inside);
+        for (int lane = 0; lane < 4 && first + lane < 6; ++lane) {
+            *results[first + lane] = (intersecting & (1 << lane)) != 0;
+            dynamic_visible += *results[first + lane] ? 1 : 0;
+        }
+    }
+
+    visible_count = visible_ids.size() + dynamic_visible;
+    occluded_count = 0;
+    if (occlusion) {
+        occlusion_buffer.begin(view_projection);
+        occlusionCull(context, results, boxes, 6);
+        visible_count -= occluded_count;
+    }
+    culled_count = total - visible_count;
+}
+
+/**
+ * This method rasterizes the visible occluders and hides the visible objects that are behind them.
+ */
+void SceneCulling::occlusionCull(const Context& context, bool* dynamic_results[], const AABB dynamic_boxes[], int dynamic_count)
+{
+    if (farmhouse)
+        occlusion_buffer.addOccluder(context.farmhouse.occluder());
+    for (size_t i = 0; i < trees.size(); ++i) {
+        if (trees[i])
+            occlusion_buffer.addOccluder(context.forest.occluder(i));
+    }
+
+    for (uint32_t id : visible_ids) {
+        const size_t index = id & 0xffffff;
+        AABB box;
+        std::vector<char>* list;
+        switch (id >> 24) {
+        case TreeItem: list = &trees; box = context.forest.bounds(index); break;
+        case FenceSectionItem: list = &fenceSections; box = context.fence.sectionBounds(index); break;
+        case WheatTileItem: list = &wheatTiles; box = context.wheatCrop.tileBounds(static_cast<int>(index)); break;
+        default: list = &staticGroups; box = context.staticScene.groupBounds(index); break;
+        }
+        if (index < list->size() && !occlusion_buffer.visible(box)) {
+            (*list)[index] = 0;
+            ++occluded_count;
+        }
+    }
+
+    for (int i = 0; i < dynamic_count; ++i) {
+        if (*dynamic_results[i] && !occlusion_buffer.visible(dynamic_boxes[i])) {
+            *dynamic_results[i] = false;
+            ++occluded_count;
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Frustum.h"
+#include "Quadtree.h"
+#include "OcclusionBuffer.h"
+
+class Context;
+
+/*
+SceneCulling decides each frame which objects of the Context are inside the view frustum. Objects
+that never move are kept in a quadtree over the meadow; the few moving ones are tested directly.
+The objects left are then tested against a small depth buffer of the largest occluders.
+*/
+class SceneCulling
+{
+public:
+	SceneCulling();
+
+	void build(const Context& context);
+	void update(const Context& context, const glm::mat4& view_projection);
+
+	size_t visibleCount() const { return visible_count; }
+	size_t culledCount() const { return culled_count; }
+	size_t occludedCount() const { return occluded_count; }
+	const Quadtree::Stats& quadtreeStats() const { return quadtree.stats(); }
+
+	bool enabled = true; // When false everything is reported visible
+	bool occlusion = true; // Also hide the objects behind the farmhouse and the tree trunks
+
+	// Visibility of the last update, one entry per tree, fence section, wheat tile and static batch group
+	std::vector<char> trees;
+	std::vector<char> fenceSections;
+	std::vector<char> wheatTiles;
+	std::vector<char> staticGroups;
+
+	// Visibility of the moving and the unbatched objects
+	bool cow = true;
+	bool pointlight = true;
+	bool spotlight = true;
+	bool ground = true;
+	bool farmhouse = true;
+	bool lake = true;
+
+private:
+	enum Kind : uint32_t { TreeItem, FenceSectionItem, WheatTileItem, StaticGroupItem };
+
+	void occlusionCull(const Context& context, bool* dynamic_results[], const AABB dynamic_boxes[], int dynamic_count);
+
+	static uint32_t itemId(Kind kind, size_t index) { return static_cast<uint32_t>(kind) << 24 | static_cast<uint32_t>(index); }
+
+	Quadtree quadtree;
+	OcclusionBuffer occlusion_buffer;
+	std::vector<uint32_t> visible_ids;
+	size_t visible_count;
+	size_t culled_count;
+	size_t occluded_count;
+};
@@ -0,0 +1,270 @@
+/**
+ * The ShaderProgram class is a thin wrapper around an OpenGL program object. build(...) compiles
+ * a vertex and a fragment shader, binds the requested generic attribute locations and links them.
+ * buildCompute(...) does the same for a single compute shader.
+ * Failures are reported on the console, in the same way the scene reports other problems.
+ * Linked programs are kept in the ProgramBinaryCache, so later runs skip the compilation.
+ */
+
+#include "ShaderProgram.h"
+#include "GLState.h"
+#include "ProgramBinaryCache.h"
+#include <iostream>
+
+ShaderProgram::ShaderProgram() : program(0) {}
+
+ShaderProgram::~ShaderProgram()
+{
+    if (program)
+        glDeleteProgram(program);
+}
+
+/**
+ * This method builds the program from the given sources. The attributes are (location, name) pairs
+ * bound before linking. It returns false, leaving the program invalid, on any error.
+ * A binary of the same program cached by an earlier run is loaded instead when the driver accepts it.
+ */
+bool ShaderProgram::build(const char* vertex_source, const char* fragment_source,
+    const std::vector<std::pair<GLuint, const char*>>& attributes)
+{
+    if (!GLEW_VERSION_2_0)
+        return false;
+
+    std::string sources = std::string(vertex_source) + '\0' + fragment_source;
+    for (const auto& attribute : attributes)
+        sources += '\0' + std::to_string(attribute.first) + attribute.second;
+    const uint64_t cache_key = ProgramBinaryCache::key(sources);
+    if (loadCached(cache_key))
+        return true;
+
+    const GLuint vertex_shader = compile(GL_VERTEX_SHADER, vertex_source);
+    const GLuint fragment_shader = compile(GL_FRAGMENT_SHADER, fragment_source);
+    if (!vertex_shader || !fragment_shader) {
+        glDeleteShader(vertex_shader);
+        glDeleteShader(fragment_shader);
+        return false;
+    }
+
+    GLuint linked = glCreateProgram();
+    glAttachShader(linked, vertex_shader);
+    glAttachShader(linked, fragment_shader);
+    for (const auto& attribute : attributes)
+        glBindAttribLocation(linked, attribute.first, attribute.second);
+    const bool linked_ok = link(linked, cache_key);
+    glDeleteShader(vertex_shader);
+    glDeleteShader(fragment_shader);
+    return linked_ok;
+}
+
+/**
+ * This method builds the program from a single compute shader (OpenGL 4.3 or ARB_compute_shader).
+ * It returns false, leaving the program invalid, on any error.
+ */
+bool ShaderProgram::buildCompute(const char* compute_source)
+{
+    if (!GLEW_VERSION_4_3 && !GLEW_ARB_compute_shader)
+        return false;
+
+    const uint64_t cache_key = ProgramBinaryCache::key(std::string("compute") + '\0' + compute_source);
+    if (loadCached(cache_key))
+        return true;
+
+    const GLuint compute_shader = compile(GL_COMPUTE_SHADER, compute_source);
+    if (!compute_shader)
+        return false;
+
+    const GLuint linked = glCreateProgram();
+    glAttachShader(linked, compute_shader);
+    const bool linked_ok = link(linked, cache_key);
+    glDeleteShader(compute_shader);
+    return linked_ok;
+}
+
+/**
+ * This helper loads the program from the ProgramBinaryCache. It returns false when there is no
+ * cached binary the driver accepts.
+ */
+bool ShaderProgram::loadCached(uint64_t cache_key)
+{
+    const GLuint cached = glCreateProgram();
+    if (!ProgramBinaryCache::load(cached, cache_key)) {
+        glDeleteProgram(cached);
+        return false;
+    }
+    if (program)
+        glDeleteProgram(program);
+    program = cached;
+    return true;
+}
+
+/**
+ * This helper links a program with its shaders attached, and on success stores it in the cache
+ * and makes it the program of this object. On failure the log is printed and the program deleted.
+ */
+bool ShaderProgram::link(GLuint linked, uint64_t cache_key)
+{
+    if (ProgramBinaryCache::supported())
+        glProgramParameteri(linked, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(linked);
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(linked, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        GLchar log[1024];
+        glGetProgramInfoLog(linked, sizeof(log), nullptr, log);
+        std::cout << "Shader program link failed: " << log << std::endl;
+        glDeleteProgram(linked);
+        return false;
+    }
+
+    ProgramBinaryCache::store(linked, cache_key);
+    if (program)
+        glDeleteProgram(program);
+    program = linked;
+    return true;
+}
+
+/**
+ * This method makes the program current.
+ */
+void ShaderProgram::use() const
+{
+    glUseProgram(program);
+}
+
+/**
+ * This method switches back to the fixed-function pipeline.
+ */
+void ShaderProgram::useFixedFunction()
+{
+    glUseProgram(0);
+}
+
+/**
+ * This method returns GLSL source, valid in 1.20 and 3.30, of a function giving the threshold of a
+ * 4 x 4 ordered dither at a window position. A fragment is kept when its opacity is above the
+ * threshold, so a fraction of the pixels equal to the opacity is drawn (see screenDoorPattern()).
+ */
+const char* ShaderProgram::screenDoor()
+{
+    return R"(
+float screenDoor(vec2 window)
+{
+    vec2 cell = mod(floor(window), 4.0);
+    vec2 low = mod(cell, 2.0);
+    vec2 high = floor(cell * 0.5);
+    float value = 4.0 * mod(2.0 * low.x + 3.0 * low.y, 4.0) + mod(2.0 * high.x + 3.0 * high.y, 4.0);
+    return (value + 0.5) / 16.0;
+}
+)";
+}
+
+/**
+ * This method returns the 32 x 32 polygon stipple drawing the same pixels as screenDoor() for the
+ * given opacity, for the fixed-function pipeline.
+ */
+void ShaderProgram::screenDoorPattern(float opacity, GLubyte pattern[128])
+{
+    const int b2[2][2] = { { 0, 3 }, { 2, 1 } }; // [x][y] of the 2 x 2 Bayer matrix
+    for (int y = 0; y < 32; ++y) {
+        for (int x = 0; x < 32; ++x) {
+            const int value = 4 * b2[x % 2][y % 2] + b2[(x / 2) % 2][(y / 2) % 2];
+            const GLubyte bit = static_cast<GLubyte>(0x80 >> (x % 8));
+            if ((value + 0.5f) / 16.0f < opacity)
+                pattern[y * 4 + x / 8] |= bit;
+            else
+                pattern[y * 4 + x / 8] &= ~bit;
+        }
+    }
+}
+
+/**
+ * This method returns GLSL 1.20 source of a function reproducing the fixed-function per-vertex
+ * lighting of GL_LIGHT0..7 (local viewer, attenuation and spotlight cone). The enabled lights are
+ * passed in the lightEnabled uniform array, since a shader cannot query glIsEnabled.
+ */
+const char* ShaderProgram::fixedFunctionLighting()
+{
+    return R"(
+uniform bool lightEnabled[8];
+
+vec4 fixedLighting(vec3 eyePosition, vec3 eyeNormal, vec4 ambient, vec4 diffuse, vec4 specular, float shininess)
+{
+    vec4 color = gl_LightModel.ambient * ambient;
+    vec3 toViewer = normalize(-eyePosition);
+    for (int i = 0; i < 8; ++i) {
+        if (!lightEnabled[i])
+            continue;
+        vec4 lightPosition = gl_LightSource[i].position;
+        vec3 toLight;
+        float attenuation = 1.0;
+        if (lightPosition.w != 0.0) {
+            vec3 offset = lightPosition.xyz / lightPosition.w - eyePosition;
+            float distance = length(offset);
+            toLight = offset / distance;
+            attenuation = 1.0 / (gl_LightSource[i].constantAttenuation + gl_LightSource[i].linearAttenuation * distance
+                + gl_LightSource[i].quadraticAttenuation * distance * distance);
+            if (gl_LightSource[i].spotCutoff <= 90.0) {
+                float spotCos = dot(-toLight, normalize(gl_LightSource[i].spotDirection));
+                attenuation *= spotCos < gl_LightSource[i].spotCosCutoff ? 0.0 : pow(spotCos, gl_LightSource[i].spotExponent);
+            }
+        }
+        else {
+            toLight = normalize(lightPosition.xyz);
+        }
+        float diffuseFactor = max(dot(eyeNormal, toLight), 0.0);
+        vec4 term = gl_LightSource[i].ambient * ambient + gl_LightSource[i].diffuse * diffuse * diffuseFactor;
+        if (diffuseFactor > 0.0) {
+            float highlight = max(dot(eyeNormal, normalize(toLight + toViewer)), 0.0);
+            term += gl_LightSource[i].specular * specular * (shininess > 0.0 ? pow(highlight, shininess) : 1.0);
+        }
+        color += attenuation * term;
+    }
+    color = clamp(color, 0.0, 1.0);
+    color.a = diffuse.a;
+    return color;
+}
+)";
+}
+
+/**
+ * This method passes the enabled state of GL_LIGHT0..7 to the lightEnabled uniform of the
+ * fixedFunctionLighting() function. The program must be current.
+ */
+void ShaderProgram::uploadLightState() const
+{
+    GLint enabled[8];
+    for (int i = 0; i < 8; ++i)
+        enabled[i] = GLState::isEnabled(GL_LIGHT0 + i);
+    glUniform1iv(uniform("lightEnabled"), 8, enabled);
+}
+
+/**
+ * This method returns the location of a uniform, or -1 when the program does not use it.
+ */
+GLint ShaderProgram::uniform(const char* name) const
+{
+    return glGetUniformLocation(program, name);
+}
+
+/**
+ * This helper compiles a single shader stage, returning 0 on error.
+ */
+GLuint ShaderProgram::compile(GLenum type, const char* source)
+{
+    const GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        GLchar log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        const char* stage = type == GL_VERTEX_SHADER ? "Vertex" : type == GL_FRAGMENT_SHADER ? "Fragment" : "Compute";
+        std::cout << stage << " shader compile failed: " << log << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
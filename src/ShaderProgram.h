@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+#include <GL/glew.h>
+
+/*
+ShaderProgram compiles and links a GLSL vertex/fragment or compute program. Compile and link errors are
+printed to the console and leave the program invalid, so callers can fall back to fixed function.
+*/
+class ShaderProgram
+{
+public:
+	ShaderProgram();
+	ShaderProgram(const ShaderProgram&) = delete;
+	ShaderProgram& operator=(const ShaderProgram&) = delete;
+	~ShaderProgram();
+
+	bool build(const char* vertex_source, const char* fragment_source,
+		const std::vector<std::pair<GLuint, const char*>>& attributes = {});
+	bool buildCompute(const char* compute_source);
+	bool valid() const { return program != 0; }
+	void use() const;
+	static void useFixedFunction();
+	static const char* fixedFunctionLighting();
+	static const char* screenDoor();
+	static void screenDoorPattern(float opacity, GLubyte pattern[128]);
+	void uploadLightState() const;
+	GLint uniform(const char* name) const;
+	GLuint id() const { return program; }
+
+private:
+	static GLuint compile(GLenum type, const char* source);
+	bool loadCached(uint64_t cache_key);
+	bool link(GLuint linked, uint64_t cache_key);
+
+	GLuint program;
+};
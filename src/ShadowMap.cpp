@@ -0,0 +1,157 @@
+/**
+ * The ShadowMap class implements shadow mapping for the spotlight with a cached static part.
+ *
+ * The light's view looks from the spotlight's position at its target, and its perspective covers
+ * the spotlight cone. The farmhouse, trees, fence and ground never move, so their depth is
+ * rendered once into a cached depth texture, and again only when the spotlight's position, target
+ * or cutoff differ from the ones the cache was rendered for. Every frame the cached depth is
+ * copied into the final depth texture with a framebuffer blit, which is a plain copy on the GPU,
+ * and the dynamic casters (the cow) are drawn over it with the depth test.
+ *
+ * The casters are drawn by the callers' functions with both the fixed-function matrices and the
+ * CoreRenderer frame set to the light's view, with a polygon offset against shadow acne. The final
+ * texture compares depths itself (GL_COMPARE_REF_TO_TEXTURE), so the CoreRenderer fragment shader
+ * reads it through a sampler2DShadow with filtered percentage-closer lookups.
+ */
+
+#include "ShadowMap.h"
+#include "CoreRenderer.h"
+#include <algorithm>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+ShadowMap::ShadowMap() : textures{ 0, 0 }, framebuffers{ 0, 0 }, view(1.0f), projection(1.0f), light_matrix(1.0f),
+    key{}, cached(false), complete(false), static_renders(0) {}
+
+ShadowMap::~ShadowMap()
+{
+    if (textures[0]) {
+        glDeleteFramebuffers(2, framebuffers);
+        glDeleteTextures(2, textures);
+    }
+}
+
+/**
+ * This method tells whether depth textures can be rendered to (framebuffer objects).
+ */
+bool ShadowMap::supported()
+{
+    return GLEW_VERSION_3_0 != 0;
+}
+
+/**
+ * This method brings the shadow map up to date for this frame: it renders the static casters
+ * again if the spotlight changed, copies them into the final map and draws the dynamic casters.
+ */
+void ShadowMap::update(const SpotLight& spot, const std::function<void()>& static_casters, const std::function<void()>& dynamic_casters)
+{
+    if (!supported())
+        return;
+    if (!textures[0])
+        create();
+    if (!complete)
+        return; // Nothing can be rendered into incomplete framebuffers, even if re-enabled
+
+    const GLfloat current[7] = { spot.position[0], spot.position[1], spot.position[2],
+        spot.target[0], spot.target[1], spot.target[2], spot.cutoff };
+    if (!std::equal(current, current + 7, key))
+        cached = false;
+
+    GLint previous_framebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+
+    if (!cached) {
+        std::copy(current, current + 7, key);
+        const glm::vec3 position(spot.position[0], spot.position[1], spot.position[2]);
+        const glm::vec3 target(spot.target[0], spot.target[1], spot.target[2]);
+        const glm::vec3 direction = glm::normalize(target - position);
+        const glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        view = glm::lookAt(position, target, up);
+        projection = glm::perspective(glm::radians(std::min(2.0f * spot.cutoff + 2.0f, 170.0f)), 1.0f, 0.5f, 150.0f);
+        light_matrix = projection * view;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[0]);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        render(framebuffers[0], static_casters);
+        cached = true;
+        ++static_renders;
+    }
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+    glBlitFramebuffer(0, 0, size, size, 0, 0, size, size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    render(framebuffers[1], dynamic_casters);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+}
+
+/**
+ * This helper creates the two depth textures and their framebuffers.
+ */
+void ShadowMap::create()
+{
+    glGenTextures(2, textures);
+    glGenFramebuffers(2, framebuffers);
+
+    GLint previous_framebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+
+    complete = true;
+    const GLfloat border[4] = { 1.0f, 1.0f, 1.0f, 1.0f }; // Outside the map everything is lit
+    for (int i = 0; i < 2; ++i) {
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, i ? GL_LINEAR : GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, i ? GL_LINEAR : GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+        if (i) {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, textures[i], 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cout << "Shadow map framebuffer is incomplete, the spotlight casts no shadows" << std::endl;
+            complete = false;
+            enabled = false;
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+}
+
+/**
+ * This helper draws casters into a framebuffer from the light's view. It leaves the matrices,
+ * the viewport and the polygon offset as it found them; the CoreRenderer frame has to be set
+ * again for the camera afterwards.
+ */
+void ShadowMap::render(GLuint framebuffer, const std::function<void()>& casters) const
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glPushAttrib(GL_VIEWPORT_BIT | GL_POLYGON_BIT | GL_TRANSFORM_BIT);
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadMatrixf(glm::value_ptr(projection));
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadMatrixf(glm::value_ptr(view));
+
+    glViewport(0, 0, size, size);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+    CoreRenderer::shadow(nullptr); // The map must not be read while it is drawn
+    CoreRenderer::beginFrame(view, projection, 0.0f);
+    casters();
+
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+    glPopAttrib();
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <functional>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "Spotlight.h"
+
+/*
+ShadowMap renders the depth of the scene as seen from the spotlight. The static casters are kept in
+a cached depth map that is rendered again only when the spotlight moves or changes its cone, or after
+invalidate() when a static caster changed; each frame the cache is copied into the final map and only
+the dynamic casters are drawn on top of it.
+*/
+class ShadowMap
+{
+public:
+	static constexpr int size = 1024;
+
+	ShadowMap();
+	ShadowMap(const ShadowMap&) = delete;
+	ShadowMap& operator=(const ShadowMap&) = delete;
+	~ShadowMap();
+
+	static bool supported();
+
+	void update(const SpotLight& spot, const std::function<void()>& static_casters, const std::function<void()>& dynamic_casters);
+	void invalidate() { cached = false; }
+	const glm::mat4& matrix() const { return light_matrix; }
+	GLuint texture() const { return textures[1]; }
+	bool ready() const { return cached; }
+	unsigned int staticRenders() const { return static_renders; }
+
+	bool enabled = true; // When false the spotlight casts no shadows
+
+private:
+	void create();
+	void render(GLuint framebuffer, const std::function<void()>& casters) const;
+
+	GLuint textures[2]; // Cached static depth and final depth
+	GLuint framebuffers[2];
+	glm::mat4 view, projection, light_matrix;
+	GLfloat key[7]; // Spotlight position, target and cutoff the cache was rendered for
+	bool cached;
+	bool complete; // Both framebuffers are complete
+	unsigned int static_renders;
+};
@@ -0,0 +1,8 @@
+#pragma once
+
+// SIMD_SSE is defined when the compiler targets SSE, which then can be used through <xmmintrin.h>.
+// Code using it keeps a scalar path for other targets.
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SIMD_SSE 1
+#endif
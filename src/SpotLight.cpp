@@ -7,6 +7,11 @@
  */
 
 #include "SpotLight.h"
+#include "MeshLibrary.h"
+#include "GLState.h"
+#include "CoreRenderer.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 /**
  * The default constructor initializes the SpotLight object with a specific position, color, target, cutoff angle, 
@@ -24,52 +29,69 @@ SpotLight::SpotLight():position{ 1.0f, 2.5f, 4.0f , 1.0f },
  * cutoff angle, and spotlight exponent.
  */
 void SpotLight::addlight() {
-	if (!glIsEnabled(GL_LIGHT1))
+	if (!GLState::isEnabled(GL_LIGHT1))
 		return;
-	glLightfv(GL_LIGHT1, GL_DIFFUSE, color);
-	glLightfv(GL_LIGHT1, GL_SPECULAR, color);
-	glLightfv(GL_LIGHT1, GL_POSITION, position);
+	GLState::light(GL_LIGHT1, GL_DIFFUSE, color);
+	GLState::light(GL_LIGHT1, GL_SPECULAR, color);
+	GLState::light(GL_LIGHT1, GL_POSITION, position);
 	GLfloat direction[3] = { target[0] - position[0],
 		target[1] - position[1],
 		target[2] - position[2] };
-	glLightfv(GL_LIGHT1, GL_SPOT_DIRECTION, direction);
-	glLightf(GL_LIGHT1, GL_SPOT_CUTOFF, cutoff);
-	glLightf(GL_LIGHT1, GL_SPOT_EXPONENT, exponent);
+	GLState::light(GL_LIGHT1, GL_SPOT_DIRECTION, direction);
+	GLState::light(GL_LIGHT1, GL_SPOT_CUTOFF, cutoff);
+	GLState::light(GL_LIGHT1, GL_SPOT_EXPONENT, exponent);
 }
 
 /**
  * This method draws a visual representation of the spotlight as a cone and cylinder 
- * with a sphere at the tip using OpenGL.
+ * with a sphere at the tip using OpenGL. The shapes are tessellated for their size on screen.
  */
 void SpotLight::draw() {
-	if (!glIsEnabled(GL_LIGHT1))
+	if (!GLState::isEnabled(GL_LIGHT1))
 		return;
 
-	glPushMatrix();
-	GLfloat up[3] = { 0, 1, 0 };
-	lookAt(position, target, up);
+	constexpr int level_slices[] = { 100, 24, 12, 6 };
+	const int slices = level_slices[lod.select(glm::vec3(position[0], position[1], position[2]), 0.7f)];
+	const int body_slices = slices < 10 ? slices : 10;
+
+	const glm::mat4 orientation = lookAt(glm::vec3(position[0], position[1], position[2]), glm::vec3(target[0], target[1], target[2]), glm::vec3(0, 1, 0));
 
 	constexpr GLfloat ambient[4] = { 0.8f, 0.8f, 0.8f, 1.0f };
 	constexpr GLfloat diffuse[4] = { 0.01f, 0.01f, 0.01f, 1.0f };
 	constexpr GLfloat specular[4] = { 0.5f, 0.5f, 0.5f, 1.0f };
 	constexpr GLfloat shininess = 32.0f;
 
-	glMaterialfv(GL_FRONT, GL_AMBIENT, ambient);
-	glMaterialfv(GL_FRONT, GL_DIFFUSE, diffuse);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, specular);
-	glMaterialf(GL_FRONT, GL_SHININESS, shininess);
+	if (CoreRenderer::active()) {
+		const glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(position[0], position[1], position[2])) * orientation;
+		const Material body = { { diffuse[0], diffuse[1], diffuse[2], diffuse[3] }, { specular[0], specular[1], specular[2], specular[3] }, shininess, false };
+		CoreRenderer::draw(MeshLibrary::cone(body_slices, body_slices), glm::scale(model, glm::vec3(0.3f, 0.3f, 0.6f)), body, ambient);
+		CoreRenderer::draw(MeshLibrary::cylinder(body_slices, body_slices),
+			glm::scale(glm::translate(model, glm::vec3(0.0f, 0.0f, 0.1f)), glm::vec3(0.2f, 0.2f, 0.39f)), body, ambient);
+		const GLfloat bulb[4] = { color[0], color[1], color[2], 1.0f };
+		CoreRenderer::drawUnlit(MeshLibrary::sphere(slices, slices), glm::scale(model, glm::vec3(0.2f)), bulb);
+		CoreRenderer::end();
+		return;
+	}
+
+	glPushMatrix();
+	glMultMatrixf(glm::value_ptr(orientation));
+
+	GLState::material(GL_FRONT, GL_AMBIENT, ambient);
+	GLState::material(GL_FRONT, GL_DIFFUSE, diffuse);
+	GLState::material(GL_FRONT, GL_SPECULAR, specular);
+	GLState::material(GL_FRONT, GL_SHININESS, shininess);
 
-	glutSolidCone(0.3, 0.6, 10, 10);
+	MeshLibrary::solidCone(0.3, 0.6, body_slices, body_slices);
 	glPushMatrix();
 	glTranslatef(0, 0, 0.1f);
-	glutSolidCylinder(0.2, 0.39, 10, 10);
+	MeshLibrary::solidCylinder(0.2, 0.39, body_slices, body_slices);
 	glPopMatrix();
 	
 	
-	glDisable(GL_LIGHTING);
+	GLState::disable(GL_LIGHTING);
 	glColor3fv(color);
-	glutSolidSphere(0.2, 100, 100);
-	glEnable(GL_LIGHTING);
+	MeshLibrary::solidSphere(0.2, slices, slices);
+	GLState::enable(GL_LIGHTING);
 	glPopMatrix();
 }
 /**
@@ -77,7 +99,7 @@ void SpotLight::draw() {
  */
 void SpotLight::disable()
 {
-	glDisable(GL_LIGHT1);
+	GLState::disable(GL_LIGHT1);
 }
 
 /**
@@ -85,70 +107,18 @@ void SpotLight::disable()
  */
 void SpotLight::enable()
 {
-	glEnable(GL_LIGHT1);
+	GLState::enable(GL_LIGHT1);
 }
 
 /**
- * This helper function normalizes a 3D vector (makes it have a length of 1). 
- * It is used for operations with vectors in 3D space.
+ * This helper function returns a viewing rotation. It is used to orient the spotlight in the 3D space.
+ * It uses the eye position, a target point and an up vector to construct a rotation matrix with glm.
  */
-void SpotLight::normalize(const GLfloat* vec, GLfloat* output)
+glm::mat4 SpotLight::lookAt(const glm::vec3& eye, const glm::vec3& center, const glm::vec3& up)
 {
-	GLfloat length = sqrtf(vec[0] * vec[0] + vec[1] * vec[1] + vec[2] * vec[2]);
-	output[0] /= length;
-	output[1] /= length;
-	output[2] /= length;
-}
+	const glm::vec3 f = glm::normalize(center - eye);
+	const glm::vec3 s = glm::normalize(glm::cross(f, glm::normalize(up)));
+	const glm::vec3 u = glm::cross(s, f);
 
-/**
- * This helper function calculates the cross product of two 3D vectors. 
- * The cross product of two vectors is a vector that is perpendicular to both input vectors.
- */
-void SpotLight::cross(const GLfloat* vec1, const GLfloat* vec2, GLfloat * output) {
-	output[0] = vec1[1] * vec2[2] - vec1[2] * vec2[1];
-	output[1] = vec1[2] * vec2[0] - vec1[0] * vec2[2];
-	output[2] = vec1[0] * vec2[1] - vec1[1] * vec2[0];
+	return glm::mat4(glm::vec4(s, 0.0f), glm::vec4(u, 0.0f), glm::vec4(-f, 0.0f), glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
 }
-
-/**
- * This helper function sets up a viewing transformation. It is used to orient the spotlight in the 3D space.
- * It uses the eye position, a target point and an up vector to construct a rotation matrix.
- */
-void SpotLight::lookAt(GLfloat* eye, GLfloat* center, GLfloat* up)
-{
-	GLfloat f[3] = { center[0] - eye[0],
-		center[1] - eye[1],
-		center[2] - eye[2] };
-
-	normalize(f, f);
-	GLfloat u[3];
-	normalize(up, u);
-	GLfloat s[3];
-	cross(f, u, s);
-	normalize(s, s);
-	cross(s, f, u);
-	normalize(u, u);
-
-	GLfloat rotationMatrix[16];
-	rotationMatrix[0] = s[0];
-	rotationMatrix[1] = s[1];
-	rotationMatrix[2] = s[2];
-	rotationMatrix[3] = 0;
-
-	rotationMatrix[4] = u[0];
-	rotationMatrix[5] = u[1];
-	rotationMatrix[6] = u[2];
-	rotationMatrix[7] = 0;
-
-	rotationMatrix[8] = -f[0];
-	rotationMatrix[9] = -f[1];
-	rotationMatrix[10] = -f[2];
-	rotationMatrix[11] = 0;
-
-	rotationMatrix[12] = 0;
-	rotationMatrix[13] = 0;
-	rotationMatrix[14] = 0;
-	rotationMatrix[15] = 1;
-
-	glMultMatrixf(rotationMatrix);
-}
\ No newline at end of file
@@ -1,6 +1,9 @@
 ﻿#pragma once
 #include <math.h>
+#include <GL/glew.h>
 #include <GL/freeglut.h>
+#include <glm/glm.hpp>
+#include "LevelOfDetail.h"
 
 /*
 Spotlight object handling position, target and other lighting properties.
@@ -12,6 +15,7 @@ public:
 	GLfloat color[3] = { 1.0f, 1.0f, 1.0f };
 	GLfloat cutoff = 30.0f;
 	GLfloat exponent = 0.0f;
+	LevelOfDetail lod{ { 200.0f, 40.0f, 10.0f } }; // Tessellation level of the gizmo drawn by draw()
 
 	SpotLight();
 	void addlight();
@@ -20,7 +24,5 @@ public:
 	void enable();
 	~SpotLight() = default;
 private:
-	void normalize(const GLfloat* vec, GLfloat* output);
-	void cross(const GLfloat* vec1, const GLfloat* vec2, GLfloat * output);
-	void lookAt(GLfloat* eye, GLfloat* center, GLfloat* up);
+	static glm::mat4 lookAt(const glm::vec3& eye, const glm::vec3& center, const glm::vec3& up);
 };
\ No newline at end of file
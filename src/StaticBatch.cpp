@@ -0,0 +1,115 @@
+/**
+ * The StaticBatch class bakes static scene objects (ground, farmhouse, lake) once at startup.
+ * Objects add their shapes with group(...), which returns the Geometry collecting everything drawn
+ * with the same material and primitive type. upload() concatenates the groups into one buffer,
+ * and submit() queues one glDrawElements call per group. Blended groups are queued as transparent.
+ */
+
+#include "StaticBatch.h"
+#include "GLState.h"
+#include "CoreRenderer.h"
+#include "LightManager.h"
+
+/**
+ * This method returns the geometry of the group matching the material, primitive type and
+ * line width, creating the group if it does not exist yet.
+ */
+Geometry& StaticBatch::group(const Material& material, GLenum mode, GLfloat line_width)
+{
+    for (Group& group : groups) {
+        if (group.material == material && group.mode == mode && group.line_width == line_width)
+            return group.geometry;
+    }
+
+    groups.push_back(Group{ material, mode, line_width, Geometry(), 0, 0, AABB{ glm::vec3(0.0f), glm::vec3(0.0f) } });
+    return groups.back().geometry;
+}
+
+/**
+ * This method merges all groups into a single vertex/index buffer and uploads it.
+ * The CPU copy of each group is released afterwards.
+ */
+void StaticBatch::upload()
+{
+    Geometry merged;
+    for (Group& group : groups) {
+        group.first = static_cast<GLsizei>(merged.indices.size());
+        group.count = static_cast<GLsizei>(group.geometry.indices.size());
+        group.bounds = AABB{ glm::vec3(0.0f), glm::vec3(0.0f) };
+        if (!group.geometry.vertices.empty()) {
+            glm::vec3 low(group.geometry.vertices[0].position[0], group.geometry.vertices[0].position[1], group.geometry.vertices[0].position[2]);
+            glm::vec3 high = low;
+            for (const Vertex& vertex : group.geometry.vertices) {
+                const glm::vec3 position(vertex.position[0], vertex.position[1], vertex.position[2]);
+                low = glm::min(low, position);
+                high = glm::max(high, position);
+            }
+            group.bounds = AABB{ low, high };
+        }
+        merged.append(group.geometry);
+        group.geometry = Geometry();
+    }
+
+    buffer.upload(merged);
+}
+
+/**
+ * This method draws the opaque triangle groups right away, without the render queue, as the
+ * shadow casters of the static scene.
+ */
+void StaticBatch::drawOpaque() const
+{
+    for (const Group& group : groups) {
+        if (group.count != 0 && !group.material.blend && group.mode == GL_TRIANGLES)
+            drawGroup(group);
+    }
+}
+
+/**
+ * This method submits every group (or those whose entry in 'visible' is non-zero) as one item
+ * of the render queue. Blended groups go to the transparent pass, so they are drawn after all
+ * opaque geometry. When lights are given, each group is lit by the local lights nearest to it.
+ */
+void StaticBatch::submit(RenderQueue& queue, const std::vector<char>* visible, const LightManager* lights) const
+{
+    const uint16_t mesh = queue.meshId(this);
+    for (size_t i = 0; i < groups.size(); ++i) {
+        const Group& group = groups[i];
+        if (group.count == 0 || (visible && (i >= visible->size() || !(*visible)[i])))
+            continue;
+        const RenderQueue::Pass pass = group.material.blend ? RenderQueue::Transparent : RenderQueue::Opaque;
+        const glm::vec3 center = (group.bounds.min + group.bounds.max) * 0.5f;
+        queue.submit(pass, queue.materialId(group.material), mesh, center, [this, &group, lights]() {
+            if (lights)
+                lights->apply(group.bounds);
+            drawGroup(group);
+        });
+    }
+}
+
+/**
+ * This helper draws one group with a single draw call, through the CoreRenderer when it is active.
+ */
+void StaticBatch::drawGroup(const Group& group) const
+{
+    if (group.material.blend)
+        GLState::enable(GL_BLEND);
+    if (group.mode == GL_LINES)
+        glLineWidth(group.line_width);
+
+    if (CoreRenderer::active()) {
+        CoreRenderer::draw(buffer, group.mode, group.first, group.count, glm::mat4(1.0f), group.material);
+        CoreRenderer::end();
+    }
+    else {
+        buffer.bind();
+        group.material.apply();
+        buffer.drawElements(group.mode, group.first, group.count);
+        buffer.unbind();
+    }
+
+    if (group.mode == GL_LINES)
+        glLineWidth(1.0f);
+    if (group.material.blend)
+        GLState::disable(GL_BLEND);
+}
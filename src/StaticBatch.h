@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+#include "Geometry.h"
+#include "Material.h"
+#include "MeshBuffer.h"
+#include "RenderQueue.h"
+#include "Frustum.h"
+
+class LightManager;
+
+/*
+StaticBatch holds the never-moving geometry of the scene baked into a single vertex/index buffer,
+grouped by material and primitive type, so that each group is drawn with one call per frame through the render queue.
+*/
+class StaticBatch
+{
+public:
+	StaticBatch() = default;
+	Geometry& group(const Material& material, GLenum mode = GL_TRIANGLES, GLfloat line_width = 1.0f);
+	void upload();
+	void drawOpaque() const;
+	void submit(RenderQueue& queue, const std::vector<char>* visible = nullptr, const LightManager* lights = nullptr) const;
+	AABB groupBounds(size_t group) const { return groups[group].bounds; }
+	size_t groupCount() const { return groups.size(); }
+
+private:
+	struct Group {
+		Material material;
+		GLenum mode;
+		GLfloat line_width;
+		Geometry geometry;
+		GLsizei first;
+		GLsizei count;
+		AABB bounds; // Bounding box of the group, for culling and depth sorting
+	};
+
+	void drawGroup(const Group& group) const;
+
+	std::vector<Group> groups;
+	MeshBuffer buffer;
+};
@@ -0,0 +1,155 @@
+/**
+ * The StreamBuffer class implements a triple-buffered streaming ring buffer.
+ *
+ * Where buffer storage is available (OpenGL 4.4 or ARB_buffer_storage) the buffer holds three
+ * regions and stays mapped for its whole life, persistent and coherent, so write() is a memcpy.
+ * The first write of a frame moves to the next region, and endFrame() puts a fence after the
+ * frame's commands; a region is written again only after its fence, two frames later, so the GPU
+ * is normally long done with it and the wait returns at once. Waits that did block are counted.
+ *
+ * Otherwise the buffer is a single region that is orphaned with glBufferData at the start of each
+ * frame, and each write() is a glBufferSubData into the fresh storage. The driver keeps the old
+ * storage alive for the commands still reading it, so this path does not wait either.
+ *
+ * Offsets are aligned to the target's offset alignment (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for
+ * uniform blocks). A frame writing more than a region continues in the next one.
+ */
+
+#include "StreamBuffer.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+StreamBuffer::StreamBuffer(GLenum target, GLsizeiptr region_size) : target(target), region_size(region_size),
+    alignment(16), buffer(0), mapped(nullptr), fences{}, region(0), head(0), open(false), written(0),
+    last_written(0), wait_count(0), advances(0) {}
+
+StreamBuffer::~StreamBuffer()
+{
+    for (GLsync& fence : fences) {
+        if (fence)
+            glDeleteSync(fence);
+    }
+    if (buffer) {
+        if (mapped) {
+            glBindBuffer(target, buffer);
+            glUnmapBuffer(target);
+            glBindBuffer(target, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+}
+
+/**
+ * This method tells whether the buffer can be persistently mapped.
+ */
+bool StreamBuffer::persistentSupported()
+{
+    return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+}
+
+/**
+ * This method copies size bytes into the ring and returns their offset in the buffer.
+ */
+GLintptr StreamBuffer::write(const void* data, GLsizeiptr size)
+{
+    if (!buffer)
+        create();
+    if (!open) {
+        advance();
+        open = true;
+    }
+
+    GLsizeiptr offset = (head + alignment - 1) / alignment * alignment;
+    if (offset + size > region_size) {
+        // The frame has filled its region: fence what was written and go on in the next one
+        if (mapped)
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        advance();
+        offset = 0;
+    }
+
+    const GLintptr position = (mapped ? region * region_size : 0) + offset;
+    if (mapped) {
+        std::memcpy(mapped + position, data, size);
+    }
+    else {
+        glBindBuffer(target, buffer);
+        glBufferSubData(target, position, size, data);
+        glBindBuffer(target, 0);
+    }
+    head = offset + size;
+    written += size;
+    return position;
+}
+
+/**
+ * This method ends the frame: its region is fenced, and the next write starts a new region.
+ */
+void StreamBuffer::endFrame()
+{
+    if (!open)
+        return;
+    if (mapped)
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    open = false;
+    last_written = written;
+    written = 0;
+}
+
+/**
+ * This helper creates the buffer, persistently mapped when possible.
+ */
+void StreamBuffer::create()
+{
+    if (target == GL_UNIFORM_BUFFER) {
+        GLint uniform_alignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_alignment);
+        alignment = std::max<GLsizeiptr>(alignment, uniform_alignment);
+    }
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(target, buffer);
+    if (persistentSupported()) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, regions * region_size, nullptr, flags);
+        mapped = static_cast<char*>(glMapBufferRange(target, 0, regions * region_size, flags));
+        if (!mapped) {
+            std::cout << "Could not map the stream buffer persistently, orphaning it every frame instead" << std::endl;
+            glDeleteBuffers(1, &buffer); // Buffer storage is immutable, so start over with a new buffer
+            glGenBuffers(1, &buffer);
+            glBindBuffer(target, buffer);
+        }
+    }
+    if (!mapped)
+        glBufferData(target, region_size, nullptr, GL_STREAM_DRAW);
+    glBindBuffer(target, 0);
+    region = regions - 1;
+}
+
+/**
+ * This helper moves to the next region: the persistent ring waits for the region's fence, the
+ * fallback orphans the buffer.
+ */
+void StreamBuffer::advance()
+{
+    head = 0;
+    ++advances;
+    if (!mapped) {
+        glBindBuffer(target, buffer);
+        glBufferData(target, region_size, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(target, 0);
+        return;
+    }
+
+    region = (region + 1) % regions;
+    GLsync& fence = fences[region];
+    if (fence) {
+        if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+            ++wait_count;
+            glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <GL/glew.h>
+
+/*
+StreamBuffer is a ring buffer for data written once per frame and read by the GPU in the same
+frame (uniform blocks of the frame and of each draw). Data is copied in and referenced by its
+offset, so nothing is uploaded with separate calls and the CPU never waits for the GPU to finish
+reading older frames: each of the three regions of the ring is reused only after its fence.
+*/
+class StreamBuffer
+{
+public:
+	static constexpr int regions = 3;
+
+	StreamBuffer(GLenum target, GLsizeiptr region_size);
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer& operator=(const StreamBuffer&) = delete;
+	~StreamBuffer();
+
+	static bool persistentSupported();
+
+	GLintptr write(const void* data, GLsizeiptr size);
+	void endFrame();
+	GLuint id() const { return buffer; }
+	bool persistent() const { return mapped != nullptr; }
+	GLsizeiptr bytesWritten() const { return last_written; }
+	unsigned int waits() const { return wait_count; }
+	unsigned int generation() const { return advances; } // Changes whenever writing moves to a new region
+
+private:
+	void create();
+	void advance();
+
+	GLenum target;
+	GLsizeiptr region_size;
+	GLsizeiptr alignment;
+	GLuint buffer;
+	char* mapped; // Whole ring when persistently mapped, else null
+	GLsync fences[regions];
+	int region;
+	GLsizeiptr head; // Next free byte of the current region
+	bool open; // A frame has written into the current region
+	GLsizeiptr written, last_written;
+	unsigned int wait_count;
+	unsigned int advances;
+};
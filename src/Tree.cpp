@@ -1,50 +1,104 @@
 /**
  * The Tree class represents a tree in a 3D virtual environment using OpenGL.
- * It provides a method to draw the tree using recursion for the branches. The leaves 
- * are represented by green spheres and the branches are represented by cylinders.
+ * The tree is built by recursion over the branches: the leaves are represented by green spheres
+ * and the branches are represented by brown cylinders. The recursion is evaluated only once per
+ * tree template (recursion depth) into a single mesh with per-vertex colors, which is shared by
+ * every tree of that template and drawn with one call.
  */
 
-#include <GL/glut.h>
 #include "Tree.h"
+#include <GL/glut.h>
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
 
 /**
- * This method draws the entire tree. It initiates the drawing process 
- * by rotating the initial drawing axis and calling the drawBranch method 
- * to recursively draw the branches of the tree.
+ * The constructor creates a tree whose branches split depth times before ending in leaves.
  */
-void Tree::draw() {
-    glPushMatrix();
-    glRotatef(-90, 1.0, 0.0, 0.0);
-    drawBranch(3);
-    glPopMatrix();
+Tree::Tree(int depth) : recursion_depth(depth) {}
+
+/**
+ * This method draws the entire tree from its template mesh at the current position.
+ * The colors of the mesh replace the ambient and diffuse material.
+ * Each level of detail above 0 drops one level of recursion, down to a single branch with leaves.
+ */
+void Tree::draw(int lod) const {
+    constexpr Material bark = { { 1.0f, 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, 0.0f, false };
+    bark.apply();
+    mesh(depth(lod)).draw();
 }
 
 /**
- * This method draws a single branch of the tree. If the depth is 0, a leaf is drawn as a green sphere.
- * Otherwise, a cylinder is drawn to represent the branch, and the method is recursively called to draw
- * three smaller branches off the end of the current branch.
- * The branch thickness decreases as the depth increases, and the branches diverge at 60-degree angles.
+ * This method returns the mesh of the tree template with the given depth, baking it on first use.
+ * Like the original drawing, the trunk is rotated from the Z axis to grow upwards along Y.
  */
-void Tree::drawBranch(int depth) {
-    GLUquadric* quadratic = gluNewQuadric();
+const Mesh& Tree::mesh(int depth) {
+    static std::map<int, std::unique_ptr<Mesh>> templates;
 
-    if (depth == 0) {
-        glColor3f(0.0, 1.0, 0.0); // Green
-        glutSolidSphere(0.2, 10, 10);
-        glColor3f(0.65, 0.16, 0.16); // Brown
+    std::unique_ptr<Mesh>& mesh = templates[depth];
+    if (!mesh) {
+        Geometry geometry;
+        bakeBranch(geometry, glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1, 0, 0)), depth);
+        mesh.reset(new Mesh(geometry));
     }
-    else {
-        gluCylinder(quadratic, 0.1, 0.08, 0.5, 10, 10);
-        glTranslatef(0, 0, 0.5);
-
-        for (int i = 0; i < 3; ++i) {
-            glPushMatrix();
-            glRotatef(60 * (i - 1), 0, 1, 0);
-            glRotatef(30, 1, 0, 0);
-            drawBranch(depth - 1);
-            glPopMatrix();
+    return *mesh;
+}
+
+/**
+ * This method returns the bounding box of the tree template with the given depth, around the
+ * trunk base. The x-z extent is widened to a square that holds the tree at any rotation about Y.
+ */
+const AABB& Tree::bounds(int depth) {
+    static std::map<int, AABB> boxes;
+
+    auto found = boxes.find(depth);
+    if (found == boxes.end()) {
+        Geometry geometry;
+        bakeBranch(geometry, glm::rotate(glm::mat4(1.0f), glm::radians(-90.0f), glm::vec3(1, 0, 0)), depth);
+
+        float radius = 0.0f, bottom = 0.0f, top = 0.0f;
+        for (const Vertex& vertex : geometry.vertices) {
+            radius = std::max(radius, std::sqrt(vertex.position[0] * vertex.position[0] + vertex.position[2] * vertex.position[2]));
+            bottom = std::min(bottom, vertex.position[1]);
+            top = std::max(top, vertex.position[1]);
         }
+        found = boxes.emplace(depth, AABB{ glm::vec3(-radius, bottom, -radius), glm::vec3(radius, top, radius) }).first;
     }
+    return found->second;
+}
 
-    gluDeleteQuadric(quadratic);
+/**
+ * This method returns a box inside the trunk of every tree template, around the trunk base.
+ * The trunk is a tube of radius 0.1 narrowing to 0.08 over its length of 0.5, so the square
+ * inscribed in its top stays inside it at any rotation about Y.
+ */
+AABB Tree::occluder() {
+    const float half_width = 0.08f * 0.7071f;
+    return AABB{ glm::vec3(-half_width, 0.0f, -half_width), glm::vec3(half_width, 0.5f, half_width) };
+}
+
+/**
+ * This method bakes a single branch of the tree. If the depth is 0, a leaf is added as a green sphere.
+ * Otherwise, a cylinder is added to represent the branch, and the method is recursively called to add
+ * three smaller branches off the end of the current branch.
+ * The branch thickness decreases along the branch, and the branches diverge at 60-degree angles.
+ */
+void Tree::bakeBranch(Geometry& geometry, const glm::mat4& transform, int depth) {
+    const size_t first = geometry.vertices.size();
+
+    if (depth == 0) {
+        geometry.addSphere(transform, 0.2f, 10, 10);
+        geometry.paint(first, glm::vec4(0.0f, 1.0f, 0.0f, 1.0f)); // Green
+        return;
+    }
+
+    geometry.addTube(transform, 0.1f, 0.08f, 0.5f, 10, 10);
+    geometry.paint(first, glm::vec4(0.65f, 0.16f, 0.16f, 1.0f)); // Brown
+
+    const glm::mat4 tip = glm::translate(transform, glm::vec3(0.0f, 0.0f, 0.5f));
+    for (int i = 0; i < 3; ++i) {
+        glm::mat4 branch = glm::rotate(tip, glm::radians(60.0f * (i - 1)), glm::vec3(0, 1, 0));
+        branch = glm::rotate(branch, glm::radians(30.0f), glm::vec3(1, 0, 0));
+        bakeBranch(geometry, branch, depth - 1);
+    }
 }
@@ -1,5 +1,22 @@
+#pragma once
+#include <map>
+#include <memory>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+#include "Frustum.h"
+
 class Tree {
 public:
-    void draw();
-    void drawBranch(int depth);
-};
\ No newline at end of file
+    Tree(int depth = 3);
+    void draw(int lod = 0) const;
+    int depth() const { return recursion_depth; }
+    int depth(int lod) const { return recursion_depth - lod > 1 ? recursion_depth - lod : 1; }
+    static const Mesh& mesh(int depth);
+    static const AABB& bounds(int depth);
+    static AABB occluder();
+
+private:
+    static void bakeBranch(Geometry& geometry, const glm::mat4& transform, int depth);
+
+    int recursion_depth;
+};
@@ -0,0 +1,243 @@
+/**
+ * The TreeImpostors class bakes and draws billboard impostors of the tree templates.
+ *
+ * bake() renders every template with lighting off from `angles` directions around the Y axis into
+ * a framebuffer object, one row of tile_size x tile_size views per template, so the atlas holds the
+ * plain colors of the tree on a transparent background. The views are orthographic and cover the
+ * same square around the trunk for every angle.
+ *
+ * Every frame, begin() and end() enclose one add() per far tree. Each tree becomes two triangles of a
+ * quad standing on its base and turned about Y towards the camera; all quads are drawn with a single
+ * call. The quads are lit like the rest of the scene through their normal, which leans from the
+ * camera direction upwards, and the atlas colors modulate the lit color. The vertex alpha lets trees
+ * fade in at the distance where they replace the full mesh.
+ */
+
+#include "TreeImpostors.h"
+#include "Tree.h"
+#include "Material.h"
+#include "GLState.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+TreeImpostors::TreeImpostors() : texture(0), rows(0), eye(0.0f) {}
+
+TreeImpostors::~TreeImpostors()
+{
+    if (texture)
+        glDeleteTextures(1, &texture);
+}
+
+/**
+ * This method tells whether impostors can be baked, which needs framebuffer objects.
+ */
+bool TreeImpostors::supported()
+{
+    return GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object;
+}
+
+/**
+ * This method renders the templates with the given recursion depths into a new atlas.
+ * The current framebuffer, viewport, matrices and enable state are kept.
+ */
+void TreeImpostors::bake(const std::vector<int>& depths)
+{
+    templates.clear();
+    if (!supported() || depths.empty())
+        return;
+
+    rows = 0;
+    for (int depth : depths) {
+        const AABB& bounds = Tree::bounds(depth);
+        // The views turn about the trunk, so the square must hold the farthest point of the box from it
+        const float reach_x = std::max(std::abs(bounds.min.x), std::abs(bounds.max.x));
+        const float reach_z = std::max(std::abs(bounds.min.z), std::abs(bounds.max.z));
+        const float size = std::max(2.0f * glm::length(glm::vec2(reach_x, reach_z)), bounds.max.y - bounds.min.y);
+        templates[depth] = Template{ rows++, size, bounds.min.y };
+    }
+    const int width = angles * tile_size;
+    const int height = rows * tile_size;
+
+    if (!texture)
+        glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 4); // Keep the smallest mipmaps from mixing neighboring views
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    GLint previous_framebuffer = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous_framebuffer);
+
+    GLuint framebuffer = 0, depth_buffer = 0;
+    glGenFramebuffers(1, &framebuffer);
+    glGenRenderbuffers(1, &depth_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_buffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "Tree impostor framebuffer is incomplete, distant trees are drawn in full" << std::endl;
+        templates.clear();
+    }
+    else {
+        glPushAttrib(GL_ENABLE_BIT | GL_VIEWPORT_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_TRANSFORM_BIT);
+        glMatrixMode(GL_PROJECTION);
+        glPushMatrix();
+        glMatrixMode(GL_MODELVIEW);
+        glPushMatrix();
+
+        glDisable(GL_LIGHTING);
+        glDisable(GL_BLEND);
+        glDisable(GL_SCISSOR_TEST);
+        glEnable(GL_DEPTH_TEST);
+        glDepthMask(GL_TRUE);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glViewport(0, 0, width, height);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        for (const auto& entry : templates) {
+            const Template& tree = entry.second;
+            const float radius = Tree::bounds(entry.first).max.x;
+            const glm::mat4 projection = glm::ortho(-0.5f * tree.size, 0.5f * tree.size, tree.bottom, tree.bottom + tree.size,
+                0.0f, 2.0f * radius + 2.0f);
+            glMatrixMode(GL_PROJECTION);
+            glLoadMatrixf(glm::value_ptr(projection));
+
+            for (int angle = 0; angle < angles; ++angle) {
+                const float radians = 2.0f * glm::pi<float>() * angle / angles;
+                const glm::vec3 direction(std::sin(radians), 0.0f, std::cos(radians));
+                const glm::mat4 view = glm::lookAt(direction * (radius + 1.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+                glMatrixMode(GL_MODELVIEW);
+                glLoadMatrixf(glm::value_ptr(view));
+                glViewport(angle * tile_size, tree.row * tile_size, tile_size, tile_size);
+                Tree::mesh(entry.first).draw();
+            }
+        }
+
+        glMatrixMode(GL_PROJECTION);
+        glPopMatrix();
+        glMatrixMode(GL_MODELVIEW);
+        glPopMatrix();
+        glPopAttrib();
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, previous_framebuffer);
+    glDeleteRenderbuffers(1, &depth_buffer);
+    glDeleteFramebuffers(1, &framebuffer);
+
+    if (!templates.empty()) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // The enable state was restored behind the state cache's back
+    GLState::invalidate();
+}
+
+/**
+ * This method starts collecting the impostors of a frame seen from the given camera position.
+ */
+void TreeImpostors::begin(const glm::vec3& camera)
+{
+    eye = camera;
+    vertices.clear();
+}
+
+/**
+ * This method adds the impostor of a tree of the given template, with the given opacity.
+ * Templates that were not baked are skipped.
+ */
+void TreeImpostors::add(int depth, const InstanceData& instance, float alpha)
+{
+    const auto found = templates.find(depth);
+    if (found == templates.end())
+        return;
+    const Template& tree = found->second;
+
+    // Direction from the tree to the camera in the ground plane
+    const glm::vec3 position(instance.position[0], instance.position[1], instance.position[2]);
+    glm::vec2 to_eye(eye.x - position.x, eye.z - position.z);
+    const float distance = glm::length(to_eye);
+    to_eye = distance > 1e-4f ? to_eye / distance : glm::vec2(0.0f, 1.0f);
+
+    // The baked view nearest to that direction, in the tree's own rotated frame
+    const float turns = (std::atan2(to_eye.x, to_eye.y) - instance.rotation) / (2.0f * glm::pi<float>());
+    const int view = ((static_cast<int>(std::floor(turns * angles + 0.5f)) % angles) + angles) % angles;
+
+    const glm::vec3 right = glm::vec3(to_eye.y, 0.0f, -to_eye.x) * (0.5f * tree.size * instance.scale[0]);
+    const glm::vec3 bottom = position + glm::vec3(0.0f, tree.bottom * instance.scale[1], 0.0f);
+    const glm::vec3 top = bottom + glm::vec3(0.0f, tree.size * instance.scale[1], 0.0f);
+    const glm::vec3 normal = glm::normalize(glm::vec3(to_eye.x, 1.0f, to_eye.y));
+
+    // Texture rectangle of the view, half a texel inside to keep neighbors out
+    const float width = static_cast<float>(angles * tile_size);
+    const float height = static_cast<float>(rows * tile_size);
+    const float u0 = (view * tile_size + 0.5f) / width, u1 = ((view + 1) * tile_size - 0.5f) / width;
+    const float v0 = (tree.row * tile_size + 0.5f) / height, v1 = ((tree.row + 1) * tile_size - 0.5f) / height;
+
+    const glm::vec3 corners[4] = { bottom - right, bottom + right, top + right, top - right };
+    const glm::vec2 texcoords[4] = { { u0, v0 }, { u1, v0 }, { u1, v1 }, { u0, v1 } };
+    const int order[6] = { 0, 1, 2, 0, 2, 3 };
+    for (int corner : order) {
+        vertices.push_back(QuadVertex{
+            { corners[corner].x, corners[corner].y, corners[corner].z },
+            { normal.x, normal.y, normal.z },
+            { instance.tint[0], instance.tint[1], instance.tint[2], alpha },
+            { texcoords[corner].x, texcoords[corner].y } });
+    }
+}
+
+/**
+ * This method draws the impostors added since begin() with one call.
+ */
+void TreeImpostors::end()
+{
+    if (vertices.empty() || !texture)
+        return;
+
+    constexpr Material canopy = { { 1.0f, 1.0f, 1.0f, 1.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, 0.0f, false };
+    canopy.apply();
+
+    GLState::enable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    GLState::enable(GL_ALPHA_TEST);
+    glAlphaFunc(GL_GREATER, 0.1f);
+    GLState::enable(GL_BLEND);
+    GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+    GLState::enable(GL_COLOR_MATERIAL);
+
+    const QuadVertex* base = vertices.data();
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(QuadVertex), base->position);
+    glNormalPointer(GL_FLOAT, sizeof(QuadVertex), base->normal);
+    glColorPointer(4, GL_FLOAT, sizeof(QuadVertex), base->color);
+    glTexCoordPointer(2, GL_FLOAT, sizeof(QuadVertex), base->texcoord);
+    glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices.size()));
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+
+    GLState::disable(GL_COLOR_MATERIAL);
+    GLState::disable(GL_BLEND);
+    GLState::disable(GL_ALPHA_TEST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    GLState::disable(GL_TEXTURE_2D);
+}
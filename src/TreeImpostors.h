@@ -0,0 +1,53 @@
+#pragma once
+#include <map>
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "InstanceBuffer.h"
+
+/*
+TreeImpostors replaces distant trees with textured quads. Every tree template is rendered once from
+several angles around the Y axis into a texture atlas; a far tree is then drawn as an upright quad
+turned towards the camera, textured with the view of its template nearest to the camera direction.
+*/
+class TreeImpostors
+{
+public:
+	static constexpr int angles = 8;
+	static constexpr int tile_size = 128;
+
+	TreeImpostors();
+	TreeImpostors(const TreeImpostors&) = delete;
+	TreeImpostors& operator=(const TreeImpostors&) = delete;
+	~TreeImpostors();
+
+	static bool supported();
+
+	void bake(const std::vector<int>& depths);
+	bool contains(int depth) const { return templates.count(depth) != 0; }
+
+	void begin(const glm::vec3& eye);
+	void add(int depth, const InstanceData& instance, float alpha);
+	void end();
+	size_t quadCount() const { return vertices.size() / 6; }
+
+private:
+	struct Template {
+		int row; // Row of the template's views in the atlas
+		float size; // Side of the square the views cover, in template units
+		float bottom; // Lowest point of the template
+	};
+
+	struct QuadVertex {
+		GLfloat position[3];
+		GLfloat normal[3];
+		GLfloat color[4];
+		GLfloat texcoord[2];
+	};
+
+	std::map<int, Template> templates;
+	GLuint texture;
+	int rows;
+	glm::vec3 eye;
+	std::vector<QuadVertex> vertices;
+};
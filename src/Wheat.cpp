@@ -7,6 +7,8 @@
 
 #include "Wheat.h"
 
+const Material Wheat::color = { { 0.9f, 0.7f, 0.1f, 1.0f }, { 1.0f, 1.0f, 1.0f, 1.0f }, 128.0f, false }; // Wheat color
+
 /**
  * This is the constructor for the Wheat class. It initializes a wheat stalk's position 
  * in 3D space to the given parameters.
@@ -18,24 +20,20 @@ Wheat::Wheat(GLfloat x, GLfloat y, GLfloat z) {
 }
 
 /**
- * This method draws a wheat stalk in 3D space. The wheat stalk is represented as a vertical line 
- * segment of a certain length. The base of the wheat stalk is located at the position specified 
- * in the constructor, and the wheat stalk extends upwards from this point. The wheat stalk is 
- * colored using the wheatColor array to appear golden.
+ * This method draws a wheat stalk in 3D space into the given immediate batch. The wheat stalk is
+ * represented as a vertical line segment of a certain length. The base of the wheat stalk is located
+ * at the position specified in the constructor, and the wheat stalk extends upwards from this point.
+ * The wheat stalk is colored using the color material to appear golden. All stalks share the
+ * material, so the whole field is merged into a single draw call when the batch is flushed.
  */
-void Wheat::draw() {
-    glPushMatrix();
-
-    constexpr GLfloat wheat_color[] = { 0.9f, 0.7f, 0.1f, 1.0f }; // Wheat color
-    glMaterialfv(GL_FRONT, GL_AMBIENT_AND_DIFFUSE, wheat_color);
-
-    glTranslatef(position[0], position[1], position[2]);
-    glBegin(GL_LINES);
-    glVertex3f(0.0f, 0.0f, 0.0f);
-    glVertex3f(0.0f, 0.5f, 0.0f); // The y coordinate can be changed to control the height of the wheat
-    glEnd();
+void Wheat::draw(ImmediateBatch& batch) {
+    batch.material(color);
 
-    glPopMatrix();
+    batch.begin(GL_LINES);
+    batch.normal3f(0.0f, 1.0f, 0.0f);
+    batch.vertex3f(position[0], position[1], position[2]);
+    batch.vertex3f(position[0], position[1] + 0.5f, position[2]); // The y offset can be changed to control the height of the wheat
+    batch.end();
 }
 
 // Create a static method to generate a field of wheat
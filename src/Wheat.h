@@ -1,14 +1,17 @@
 #pragma once
 #include <vector>
+#include "ImmediateBatch.h"
 #include <GL/glut.h>
 
 class Wheat {
 public:
     Wheat(GLfloat x, GLfloat y, GLfloat z);
 
-    void draw();
+    void draw(ImmediateBatch& batch);
     static void createField(std::vector<Wheat>& field);
 
+    static const Material color; // Golden material shared by every stalk
+
 private:
     GLfloat position[3];
 };
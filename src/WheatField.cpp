@@ -0,0 +1,252 @@
+/**
+ * The WheatField class renders a crop field of up to millions of wheat stalks without any
+ * per-stalk data on the CPU. The field rectangle is divided into a grid of cells, one per stalk,
+ * and the grid is drawn with glDrawElementsInstanced calls of a two-vertex line, one per tile of
+ * the field (8 x 8 tiles), so tiles outside the view can be skipped.
+ *
+ * The vertex shader turns the instance ID into a cell, jitters the stalk inside the cell and picks
+ * its height and lean from a hash of the cell and the seed. A stalk is kept with a probability
+ * taken from the density texture, scaled down with the distance from the camera. Dropped stalks
+ * are moved outside the clip volume, so they produce no fragments.
+ *
+ * Given the local lights, each tile is lit by the lights nearest to it.
+ */
+
+#include "WheatField.h"
+#include "LightManager.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include "Wheat.h"
+
+static const char* const vertex_body = R"(
+uniform sampler2D densityMap;
+uniform vec4 field; // Minimum corner (x, z) followed by the maximum corner
+uniform vec2 grid; // Columns and rows of stalks
+uniform vec3 tile; // First column and row of the tile being drawn, and its number of columns
+uniform float seed;
+uniform vec3 fade; // Fade start distance, fade end distance and the far density
+varying vec4 litColor;
+
+float hash(vec2 p)
+{
+    vec3 p3 = fract(vec3(p.xyx) * 0.1031);
+    p3 += dot(p3, p3.yzx + 33.33);
+    return fract((p3.x + p3.y) * p3.z);
+}
+
+void main()
+{
+    float id = float(gl_InstanceIDARB);
+    float row = floor(id / tile.z);
+    vec2 cell = tile.xy + vec2(id - row * tile.z, row);
+    vec2 key = cell + vec2(seed * 0.618, seed * 1.618);
+
+    vec2 size = field.zw - field.xy;
+    vec2 ground = field.xy + (cell + vec2(hash(key), hash(key + 17.0))) * size / grid;
+    float density = texture2DLod(densityMap, (ground - field.xy) / size, 0.0).r;
+
+    vec3 camera = gl_ModelViewMatrixInverse[3].xyz;
+    float distance = length(vec3(ground.x, 0.0, ground.y) - camera);
+    float keep = density * mix(1.0, fade.z, smoothstep(fade.x, fade.y, distance));
+    if (hash(key + 43.0) >= keep) {
+        litColor = vec4(0.0);
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+        return;
+    }
+
+    float height = 0.4 + 0.2 * hash(key + 71.0);
+    vec2 lean = (vec2(hash(key + 5.0), hash(key + 9.0)) - 0.5) * 0.1 * gl_Vertex.y;
+    vec4 eye = gl_ModelViewMatrix * vec4(ground.x + lean.x, gl_Vertex.y * height, ground.y + lean.y, 1.0);
+    litColor = fixedLighting(eye.xyz, normalize(gl_NormalMatrix * vec3(0.0, 1.0, 0.0)), gl_FrontMaterial.ambient,
+        gl_FrontMaterial.diffuse, gl_FrontMaterial.specular, gl_FrontMaterial.shininess);
+    gl_Position = gl_ProjectionMatrix * eye;
+}
+)";
+
+static const char* const fragment_source = R"(
+#version 120
+varying vec4 litColor;
+
+void main()
+{
+    gl_FragColor = litColor;
+}
+)";
+
+/**
+ * The constructor stores the field rectangle (in the x-z plane) and the seed, and prepares the
+ * default density map. No OpenGL calls are made until the field is first drawn.
+ */
+WheatField::WheatField(const glm::vec2& field_min, const glm::vec2& field_max, unsigned int seed)
+    : field_min(field_min), field_max(field_max), seed(seed), density_texture(0), density_width(0), density_height(0)
+{
+    createDefaultDensityMap();
+}
+
+WheatField::~WheatField()
+{
+    if (density_texture)
+        glDeleteTextures(1, &density_texture);
+}
+
+/**
+ * This method tells whether the field can be drawn on the GPU (instanced draws and shaders).
+ */
+bool WheatField::available()
+{
+    return GLEW_VERSION_3_1 && GLEW_ARB_draw_instanced && program().valid();
+}
+
+/**
+ * This method replaces the density map. Each value (0-255) is the chance of a stalk growing in that
+ * part of the field; the map is stretched over the field rectangle and sampled bilinearly.
+ */
+void WheatField::setDensityMap(int width, int height, const std::vector<GLubyte>& values)
+{
+    density_width = width;
+    density_height = height;
+    density = values;
+    if (density_texture) {
+        glDeleteTextures(1, &density_texture);
+        density_texture = 0;
+    }
+}
+
+/**
+ * This method returns the number of stalk instances drawn, before the density map and the
+ * distance thinning drop some of them.
+ */
+GLsizei WheatField::stalkCount() const
+{
+    const glm::vec2 size = field_max - field_min;
+    const double columns = std::ceil(size.x * stalksPerUnit);
+    const double rows = std::ceil(size.y * stalksPerUnit);
+
+    // Instance IDs are converted to float in the shader, which is exact up to 2^24
+    return static_cast<GLsizei>(std::min(columns * rows, 16777216.0));
+}
+
+/**
+ * This method returns the bounding box of a tile, including the tallest and most leaning stalks.
+ */
+AABB WheatField::tileBounds(int tile) const
+{
+    const glm::vec2 size = (field_max - field_min) / static_cast<float>(tiles_per_side);
+    const glm::vec2 low = field_min + size * glm::vec2(tile % tiles_per_side, tile / tiles_per_side);
+    const glm::vec2 high = low + size;
+    return AABB{ glm::vec3(low.x - 0.05f, 0.0f, low.y - 0.05f), glm::vec3(high.x + 0.05f, 0.6f, high.y + 0.05f) };
+}
+
+/**
+ * This method draws the tiles of the field whose entry in 'visible_tiles' is non-zero (or all of
+ * them) with the current wheat material and lights, and with the local lights nearest to each
+ * tile when given.
+ */
+void WheatField::draw(const std::vector<char>* visible_tiles, const LightManager* lights)
+{
+    if (!density_texture) {
+        glGenTextures(1, &density_texture);
+        glBindTexture(GL_TEXTURE_2D, density_texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE8, density_width, density_height, 0,
+            GL_LUMINANCE, GL_UNSIGNED_BYTE, density.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+    if (stalk.indexCount() == 0) {
+        // A unit line from the ground up; the shader scales and places it
+        Geometry line;
+        line.indices.push_back(line.addVertex(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+        line.indices.push_back(line.addVertex(glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)));
+        stalk.upload(line);
+    }
+
+    const glm::vec2 size = field_max - field_min;
+    const GLsizei instances = stalkCount();
+    const GLfloat columns = std::ceil(size.x * stalksPerUnit);
+    const GLfloat rows = std::ceil(instances / columns);
+
+    const ShaderProgram& shader = program();
+    shader.use();
+    shader.uploadLightState();
+    glUniform1i(shader.uniform("densityMap"), 0);
+    glUniform4f(shader.uniform("field"), field_min.x, field_min.y, field_max.x, field_max.y);
+    glUniform2f(shader.uniform("grid"), columns, rows);
+    glUniform1f(shader.uniform("seed"), static_cast<GLfloat>(seed % 4096));
+    glUniform3f(shader.uniform("fade"), fadeStart, std::max(fadeEnd, fadeStart + 0.01f), farDensity); // smoothstep needs start < end
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, density_texture);
+    Wheat::color.apply();
+
+    const GLint tile_location = shader.uniform("tile");
+    stalk.bind();
+    for (int tile = 0; tile < tileCount(); ++tile) {
+        if (visible_tiles && (tile >= static_cast<int>(visible_tiles->size()) || !(*visible_tiles)[tile]))
+            continue;
+
+        // Tiles split the columns and rows as evenly as possible
+        const int tile_x = tile % tiles_per_side, tile_y = tile / tiles_per_side;
+        const GLfloat first_column = std::floor(columns * tile_x / tiles_per_side);
+        const GLfloat last_column = std::floor(columns * (tile_x + 1) / tiles_per_side);
+        const GLfloat first_row = std::floor(rows * tile_y / tiles_per_side);
+        const GLfloat last_row = std::floor(rows * (tile_y + 1) / tiles_per_side);
+        const GLsizei tile_instances = static_cast<GLsizei>((last_column - first_column) * (last_row - first_row));
+        if (tile_instances == 0)
+            continue;
+
+        if (lights) {
+            lights->apply(tileBounds(tile));
+            shader.uploadLightState();
+        }
+        glUniform3f(tile_location, first_column, first_row, last_column - first_column);
+        stalk.drawElementsInstanced(GL_LINES, 0, stalk.indexCount(), tile_instances);
+    }
+    stalk.unbind();
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    ShaderProgram::useFixedFunction();
+}
+
+/**
+ * This method returns the wheat shader, building it on first use.
+ */
+ShaderProgram& WheatField::program()
+{
+    static ShaderProgram shader;
+    static bool built = false;
+    if (!built && GLEW_VERSION_3_1 && GLEW_ARB_draw_instanced) {
+        built = true;
+        const std::string vertex_source = std::string("#version 120\n#extension GL_ARB_draw_instanced : require\n")
+            + ShaderProgram::fixedFunctionLighting() + vertex_body;
+        shader.build(vertex_source.c_str(), fragment_source);
+    }
+    return shader;
+}
+
+/**
+ * This helper builds the default density map: wheat grows in the quadrants x, z >= 0 and x, z <= 0
+ * of the field, like the original grid of stalks, with patchy density and soft borders.
+ */
+void WheatField::createDefaultDensityMap()
+{
+    const int resolution = 64;
+    std::vector<GLubyte> values(resolution * resolution);
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> patch(0.75f, 1.0f);
+
+    for (int row = 0; row < resolution; ++row) {
+        for (int column = 0; column < resolution; ++column) {
+            const float x = field_min.x + (column + 0.5f) / resolution * (field_max.x - field_min.x);
+            const float z = field_min.y + (row + 0.5f) / resolution * (field_max.y - field_min.y);
+            const bool planted = (x >= 0.0f && z >= 0.0f) || (x <= 0.0f && z <= 0.0f);
+            values[row * resolution + column] = planted ? static_cast<GLubyte>(255.0f * patch(random)) : 0;
+        }
+    }
+    setDensityMap(resolution, resolution, values);
+}
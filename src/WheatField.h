@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "MeshBuffer.h"
+#include "ShaderProgram.h"
+#include "Frustum.h"
+
+class LightManager;
+
+/*
+WheatField draws a whole crop field with one instanced call. It stores only the field rectangle,
+a seed and a density texture; every stalk is generated in the vertex shader from its instance ID.
+*/
+class WheatField
+{
+public:
+	WheatField(const glm::vec2& field_min, const glm::vec2& field_max, unsigned int seed = 1);
+	WheatField(const WheatField&) = delete;
+	WheatField& operator=(const WheatField&) = delete;
+	~WheatField();
+
+	static bool available();
+	void setDensityMap(int width, int height, const std::vector<GLubyte>& values);
+	void draw(const std::vector<char>* visible_tiles = nullptr, const LightManager* lights = nullptr);
+	GLsizei stalkCount() const;
+	static int tileCount() { return tiles_per_side * tiles_per_side; }
+	AABB tileBounds(int tile) const;
+
+	float stalksPerUnit = 10.0f; // Grid resolution of the field (stalks per unit along each axis)
+	float fadeStart = 15.0f; // Distance from the camera where the field starts to thin out
+	float fadeEnd = 60.0f; // Distance from the camera where the field is thinnest
+	float farDensity = 0.1f; // Fraction of the stalks kept beyond fadeEnd
+
+private:
+	static constexpr int tiles_per_side = 8; // The field is drawn as tiles, so hidden tiles can be skipped
+
+	static ShaderProgram& program();
+	void createDefaultDensityMap();
+
+	glm::vec2 field_min;
+	glm::vec2 field_max;
+	unsigned int seed;
+	GLuint density_texture;
+	int density_width;
+	int density_height;
+	std::vector<GLubyte> density;
+	MeshBuffer stalk;
+};
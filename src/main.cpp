@@ -10,9 +10,18 @@
 #include "imgui.h"
 #include "imgui_impl_freeglut.h"
 #include "imgui_impl_opengl2.h"
+#include <GL/glew.h>
 #include <GL\freeglut.h>
 #include "Context.h"
 #include "Menu.h" 
+#include "Benchmark.h"
+#include "GLState.h"
+#include "LevelOfDetail.h"
+#include "CoreRenderer.h"
+#include "ImGuiRenderer.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <string>
+#include <cstdlib>
 
 using namespace std;
 
@@ -53,24 +62,23 @@ bool checkCollision(float x, float z) {
 */
 
 void keyboard(int key, int, int) {
-	GLfloat viewModelMatrix[16];
-	glGetFloatv(GL_MODELVIEW_MATRIX, viewModelMatrix);
-	glLoadMatrixf(context.cow.local_coords);
+	MatrixStack move;
+	move.load(context.cow.local_coords);
 
-	std::function<void()> nextMove;
+	std::function<void(MatrixStack&)> nextMove;
 
 	switch (key) {
 	case GLUT_KEY_LEFT:
-		nextMove = []() { glRotatef(7, 0, 1, 0); };
+		nextMove = [](MatrixStack& transform) { transform.rotate(7, glm::vec3(0, 1, 0)); };
 		break;
 	case GLUT_KEY_RIGHT:
-		nextMove = []() { glRotatef(-7, 0, 1, 0); };
+		nextMove = [](MatrixStack& transform) { transform.rotate(-7, glm::vec3(0, 1, 0)); };
 		break;
 	case GLUT_KEY_UP:
-		nextMove = []() { glTranslated(0, 0, 0.2); };
+		nextMove = [](MatrixStack& transform) { transform.translate(glm::vec3(0, 0, 0.2f)); };
 		break;
 	case GLUT_KEY_DOWN:
-		nextMove = []() { glTranslated(0, 0, -0.2); };
+		nextMove = [](MatrixStack& transform) { transform.translate(glm::vec3(0, 0, -0.2f)); };
 		break;
 	default:
 		// No valid key press detected, so the cow isn't moving.
@@ -81,20 +89,16 @@ void keyboard(int key, int, int) {
 	context.cow.is_moving = true;  // The cow is moving now
 
 	// apply the potential movement
-	nextMove();
+	nextMove(move);
 
 	// check if there will be a collision
-	GLfloat nextModelMatrix[16];
-	glGetFloatv(GL_MODELVIEW_MATRIX, nextModelMatrix);
-	if (!checkCollision(nextModelMatrix[12], nextModelMatrix[14])) {
+	const glm::vec3 nextPosition = move.position();
+	if (!checkCollision(nextPosition.x, nextPosition.z)) {
 		// no collision, apply the movement
-		glGetFloatv(GL_MODELVIEW_MATRIX, context.cow.local_coords);
+		context.cow.local_coords = move.top();
 	}
 
-	// load the old matrix again
-	glLoadMatrixf(viewModelMatrix);
-
-	glutPostRedisplay();
+	context.redraw.invalidate();
 }
 
 void normalKeys(unsigned char key, int, int) {
@@ -147,15 +151,74 @@ void normalKeys(unsigned char key, int, int) {
 	// Update camera view
 	context.camera.UpdateView();
 
-	glutPostRedisplay();
+	context.redraw.invalidate();
+}
+
+/*
+* mouse, motion, mouseWheel, reshape: These functions pass the mouse and window events on to ImGui,
+* like the handlers installed by ImGui_ImplFreeGLUT_InstallFuncs, and ask for the frames that show
+* their effect when the scene is redrawn on demand.
+*/
+void mouse(int button, int state, int x, int y) {
+	ImGui_ImplFreeGLUT_MouseFunc(button, state, x, y);
+	context.redraw.invalidate();
+}
+
+void motion(int x, int y) {
+	ImGui_ImplFreeGLUT_MotionFunc(x, y);
+	context.redraw.invalidate();
+}
+
+void mouseWheel(int button, int dir, int x, int y) {
+	ImGui_ImplFreeGLUT_MouseWheelFunc(button, dir, x, y);
+	context.redraw.invalidate();
+}
+
+void reshape(int w, int h) {
+	ImGui_ImplFreeGLUT_ReshapeFunc(w, h);
+	context.redraw.invalidate();
+}
+
+/*
+* applyLocalLights: On the fixed-function path, this function binds the local lights influencing
+* the given bounding sphere the most to the OpenGL lights left free by the scene lights. It is
+* called right before an object is drawn.
+*/
+void applyLocalLights(const glm::vec3& center, float radius) {
+	if (!CoreRenderer::active())
+		context.lights.apply(center, radius);
+}
+
+/*
+* localLights: This function returns the local lights for objects that pick them per part (tree,
+* tile or fence section) on the fixed-function path, and nullptr with the shader-based renderer,
+* which lights every pixel from its cluster.
+*/
+const LightManager* localLights() {
+	return CoreRenderer::active() ? nullptr : &context.lights;
+}
+
+/*
+* releaseLocalLights: On the fixed-function path, this function switches the local lights off for
+* an object drawn in one piece over the whole meadow, which has no nearest lights.
+*/
+void releaseLocalLights() {
+	if (!CoreRenderer::active())
+		context.lights.release();
 }
 
 /*
 * drawScene: This function is responsible for drawing all the objects in the scene. It is called
-* within the 'display' function.
+* within the 'display' function. It sets up the lights, submits every object to the render queue
+* and flushes the queue, which draws the objects sorted by pass, material, mesh and depth.
 */
 void drawScene() {
-	
+	RenderQueue& queue = context.renderQueue;
+	queue.begin(context.view.top());
+	// Find the objects inside the view frustum; only those are submitted
+	context.culling.update(context, context.projection.top() * context.view.top());
+	const SceneCulling& visible = context.culling;
+
 	glPushMatrix();
 	// Translate to the point light position
 	glTranslatef(context.pointlight.position[0], context.pointlight.position[1], context.pointlight.position[2]);
@@ -169,44 +232,134 @@ void drawScene() {
 
 	glPopMatrix();
 
-	glPushMatrix();
-	glTranslatef(context.spotlight.position[0], context.spotlight.position[1], context.spotlight.position[2]);
-	context.spotlight.draw(); // draw the spotlight (static) in the scene
-	glPopMatrix();
+	// The shader-based renderer reads the same lights from its frame uniform block
+	if (CoreRenderer::active()) {
+		CoreRenderer::lights(context.pointlight, context.spotlight);
+	}
 
-	glPushMatrix();
-	glTranslatef(context.pointlight.position[0], context.pointlight.position[1], context.pointlight.position[2]);
-	context.pointlight.draw(); // Draw the 'moving' ambient light
-	glPopMatrix();
+	if (visible.spotlight) {
+		const glm::vec3 spotlightPosition(context.spotlight.position[0], context.spotlight.position[1], context.spotlight.position[2]);
+		queue.submit(RenderQueue::Opaque, RenderQueue::mixed, RenderQueue::mixed, spotlightPosition, []() {
+			glPushMatrix();
+			glTranslatef(context.spotlight.position[0], context.spotlight.position[1], context.spotlight.position[2]);
+			context.spotlight.draw(); // draw the spotlight (static) in the scene
+			glPopMatrix();
+		});
+	}
 
-	glPushMatrix();
-	context.ground.draw(); // Draw the ground on the scene
-	glPopMatrix();
+	if (visible.pointlight) {
+		const glm::vec3 pointlightPosition(context.pointlight.position[0], context.pointlight.position[1], context.pointlight.position[2]);
+		queue.submit(RenderQueue::Opaque, RenderQueue::mixed, RenderQueue::mixed, pointlightPosition, []() {
+			glPushMatrix();
+			glTranslatef(context.pointlight.position[0], context.pointlight.position[1], context.pointlight.position[2]);
+			context.pointlight.draw(); // Draw the 'moving' ambient light
+			glPopMatrix();
+		});
+	}
 
-	glPushMatrix();
-	context.forest.draw(); // Draw the forest on the scene
-	glPopMatrix();
+	// The forest, the wheat field, the fence and the ground spread over the whole meadow, so they have no
+	// single depth: they are submitted without one and are only grouped by their material and mesh.
+	queue.submit(RenderQueue::Opaque, RenderQueue::mixed, queue.meshId(&context.forest), []() {
+		glPushMatrix();
+		context.forest.draw(&context.culling.trees, localLights()); // Draw the visible trees of the forest
+		glPopMatrix();
+	});
+
+	if (context.gpuWheat && WheatField::available()) {
+		queue.submit(RenderQueue::Opaque, queue.materialId(Wheat::color), queue.meshId(&context.wheatCrop), []() {
+			context.wheatCrop.draw(&context.culling.wheatTiles, localLights()); // Generate and draw the visible wheat tiles on the GPU
+		});
+	}
+	else {
+		queue.submit(RenderQueue::Opaque, queue.materialId(Wheat::color), queue.meshId(&context.wheatField), []() {
+			releaseLocalLights();
+			// Record each stalk of wheat in the wheat field, then draw them all at once
+			for (auto& wheat : context.wheatField) {
+				wheat.draw(context.immediateBatch);
+			}
+			context.immediateBatch.flush();
+		});
+	}
 
-	glPushMatrix();
-	context.farmhouse.draw();  // Draw the farmhouse on the scene
-	glPopMatrix();
+	if (visible.cow) {
+		const glm::vec3 cowPosition(context.cow.local_coords[3]);
+		queue.submit(RenderQueue::Opaque, RenderQueue::mixed, RenderQueue::mixed, cowPosition, []() {
+			applyLocalLights(glm::vec3(context.cow.local_coords[3]), 1.5f);
+			glPushMatrix();
+			glMultMatrixf(glm::value_ptr(context.cow.local_coords)); // Apply the cow's transformation matrix
+			context.cow.draw();
+			glPopMatrix();
+		});
+	}
 
-	glPushMatrix();
-	context.lake.draw();  // Draw the lake on the scene
-	glPopMatrix();
-	
-	// Draw each stalk of wheat in the wheat field
-	glPushMatrix();
-	for (auto& wheat : context.wheatField) {
-		wheat.draw();
+	queue.submit(RenderQueue::Opaque, RenderQueue::mixed, queue.meshId(&context.fence), []() {
+		context.fence.draw(&context.culling.fenceSections, localLights()); // Draw the sections of the fence around the scene that are in view
+	});
+
+	if (context.staticBatching || CoreRenderer::active()) {
+		// Submit the baked ground, farmhouse and lake. The lake surface is blended, so it is transparent.
+		context.staticScene.submit(queue, &visible.staticGroups, CoreRenderer::active() ? nullptr : &context.lights);
 	}
-	glPopMatrix();
+	else {
+		if (visible.ground) {
+			queue.submit(RenderQueue::Opaque, RenderQueue::mixed, RenderQueue::mixed, []() {
+				releaseLocalLights();
+				context.ground.draw(context.immediateBatch); // Draw the ground on the scene
+				context.immediateBatch.flush();
+			});
+		}
+
+		if (visible.farmhouse) {
+			queue.submit(RenderQueue::Opaque, RenderQueue::mixed, RenderQueue::mixed, glm::vec3(5.0f, 0.0f, -10.0f), []() {
+				context.lights.apply(context.farmhouse.occluder());
+				glPushMatrix();
+				context.farmhouse.draw();  // Draw the farmhouse on the scene
+				glPopMatrix();
+			});
+		}
+
+		if (visible.lake) {
+			const glm::vec3 lakeCenter((context.lake.start_x + context.lake.end_x) * 0.5f, context.lake.y,
+				(context.lake.start_z + context.lake.end_z) * 0.5f);
+			queue.submit(RenderQueue::Transparent, RenderQueue::mixed, RenderQueue::mixed, lakeCenter, []() {
+				context.lights.apply(context.lake.bounds());
+				context.lake.draw(context.immediateBatch);  // Draw the lake on the scene
+				context.immediateBatch.flush();
+			});
+		}
+	}
+
+	// Draw everything: opaque items by material and front to back, then transparent items back to front
+	queue.flush();
+}
+
+/*
+* bakeStaticScene: This function bakes the objects that never move (ground, farmhouse and lake)
+* into the static batch of the context. It is called once, after the OpenGL context is created.
+*/
+void bakeStaticScene() {
+	context.ground.bake(context.staticScene);
+	context.farmhouse.bake(context.staticScene);
+	context.lake.bake(context.staticScene);
+	context.staticScene.upload();
+}
+
+/*
+* drawStaticCasters, drawDynamicCasters: These functions draw the objects casting the spotlight's
+* shadows. The static ones are cached in the shadow map until the spotlight changes; the dynamic
+* ones (the cow) are drawn into it every frame.
+*/
+void drawStaticCasters() {
+	context.staticScene.drawOpaque(); // Ground and farmhouse
+	context.forest.drawCasters();
+	context.fence.draw();
+}
 
+void drawDynamicCasters() {
 	glPushMatrix();
-	glMultMatrixf(context.cow.local_coords); // Apply the cow's transformation matrix
+	glMultMatrixf(glm::value_ptr(context.cow.local_coords));
 	context.cow.draw();
 	glPopMatrix();
-	context.fence.draw({ 0, 1 }); // Draw the fence around the scene at the given location
 }
 
 /*
@@ -216,13 +369,19 @@ void drawScene() {
 * the objects, it handles the GUI display.
 */
 void display() {
-	static float time = 0.0f; // A static variable is declared to keep track of time. Being static, it preserves its value across function calls.
+	// Wait for the frame rate cap and for queued frames first, so the frame uses the latest input.
+	context.framePacer.beginFrame();
+
+	// Let the quality governor adjust the detail of the scene from the work the last frame took.
+	context.quality.update(context, context.framePacer.workMilliseconds());
+
+	// The time advances with the clock rather than per frame, so the sweep keeps its speed when frames
+	// are only drawn on demand.
+	const float time = glutGet(GLUT_ELAPSED_TIME) * 0.0003f;
 
 	// Position of pointlight oscillates along x-axis, with the oscillation determined by the sine of the time variable.
 	context.pointlight.position[0] = 15.0f * sin(time); 
 
-	time += 0.005f; // The time variable is incremented by a small amount after each call.
-
 	// Start a new frame in the ImGui context, using the OpenGL2 and FreeGLUT bindings.
 	ImGui_ImplOpenGL2_NewFrame();
 	ImGui_ImplFreeGLUT_NewFrame();
@@ -236,97 +395,132 @@ void display() {
 	// Obtain a reference to the ImGui context's IO structure.
 	ImGuiIO& io = ImGui::GetIO();
 
-	// Set the viewport to match the ImGui context's display size.
-	glViewport(0, 0, (GLsizei)io.DisplaySize.x, (GLsizei)io.DisplaySize.y);
+	// Draw the scene into the offscreen target when the resolution is scaled, and set the viewport
+	// to its size, which is the window's display size otherwise.
+	context.resolution.begin((int)io.DisplaySize.x, (int)io.DisplaySize.y);
+	const float viewportWidth = (float)context.resolution.width(), viewportHeight = (float)context.resolution.height();
 
 	// Clear the color, depth, and stencil buffers to prepare for new rendering.
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 
-	// Load the projection matrix and reset it.
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-
-	// Set the perspective for the view.
-	gluPerspective(40.0, io.DisplaySize.x / io.DisplaySize.y, 1.0, 150.0);
+	// Compute the perspective projection on the CPU and load it.
+	context.projection.loadIdentity();
+	context.projection.perspective(40.0f, io.DisplaySize.x / io.DisplaySize.y, 1.0f, context.farPlane);
+	context.projection.apply(GL_PROJECTION);
 
-	// Load the modelview matrix and reset it.
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
+	// Reset the view matrix.
+	context.view.loadIdentity();
 	
 	// If the cow has a next move defined, execute it and update the cow's local transformation matrix.
 	if (context.cow.next_move) {
 		context.cow.is_moving = true;
-		GLfloat viewModelMatrix[16];
 
-		// Capture the current modelview matrix.
-		glGetFloatv(GL_MODELVIEW_MATRIX, viewModelMatrix);
-
-		// Load the cow's current local transformation matrix, execute the next move, and reset the move.
-		glLoadMatrixf(context.cow.local_coords);
-		context.cow.next_move();
+		// Start from the cow's current local transformation matrix, execute the next move, and reset the move.
+		MatrixStack move;
+		move.load(context.cow.local_coords);
+		context.cow.next_move(move);
 		context.cow.next_move = nullptr;
-
-		// Capture the updated transformation matrix and restore the original modelview matrix.
-		glGetFloatv(GL_MODELVIEW_MATRIX, context.cow.local_coords);
-		glLoadMatrixf(viewModelMatrix);
+		context.cow.local_coords = move.top();
 	}
+
+	// Advance the tail and legs once per frame, before the shadow pass and the scene draw the cow. The
+	// legs step only while the cow walks, which the step clears, so the walk is kept for the scheduler.
+	const bool cowWalking = context.cow.is_moving;
+	context.cow.update_constant_movement();
 	
 	// Check if the first-person view from the cow is enabled.
 	if (context.isCowView) {
-		GLfloat viewModelMatrix[16];
-		glGetFloatv(GL_MODELVIEW_MATRIX, viewModelMatrix);
-		glLoadMatrixf(context.cow.local_coords);
-
-		// Apply the cow's current head rotation and position offsets to the view matrix.
-		glRotatef(context.cow.head_vertical_angle, 1, 0, 0);
-		glRotatef(context.cow.head_horizontal_angle, 0, 1, 0);
-		glTranslated(0, 0.75, 0.9);
-
-		// Capture the updated view matrix.
-		GLfloat cameraPoseInDogView[16];
-		glGetFloatv(GL_MODELVIEW_MATRIX, cameraPoseInDogView);
-
-		// Restore the original view matrix.
-		glLoadMatrixf(viewModelMatrix);
-
-		// Calculate the view angles based on the updated view matrix.
-		GLfloat zAngle = atan2(-cameraPoseInDogView[2], cameraPoseInDogView[0]);
-		GLfloat yAngle = atan2(-cameraPoseInDogView[9], cameraPoseInDogView[5]);
+		// Apply the cow's current head rotation and position offsets to the cow's transformation.
+		MatrixStack head;
+		head.load(context.cow.local_coords);
+		head.rotate(context.cow.head_vertical_angle, glm::vec3(1, 0, 0));
+		head.rotate(context.cow.head_horizontal_angle, glm::vec3(0, 1, 0));
+		head.translate(glm::vec3(0, 0.75f, 0.9f));
+		const glm::mat4& cameraPoseInDogView = head.top();
+
+		// Calculate the view angles based on the head's orientation.
+		GLfloat zAngle = atan2(-cameraPoseInDogView[0][2], cameraPoseInDogView[0][0]);
+		GLfloat yAngle = atan2(-cameraPoseInDogView[2][1], cameraPoseInDogView[1][1]);
 		
 		// Apply the calculated view angles to the view matrix.
-		gluLookAt(cameraPoseInDogView[12], cameraPoseInDogView[13], cameraPoseInDogView[14],
-			sin(zAngle) + cameraPoseInDogView[12],-yAngle + cameraPoseInDogView[13],
-			cos(zAngle) + cameraPoseInDogView[14],0, 1, 0);
+		const glm::vec3 eye = head.position();
+		context.view.lookAt(eye, eye + glm::vec3(sin(zAngle), -yAngle, cos(zAngle)), glm::vec3(0, 1, 0));
 	}
 	else
 	{
 		// In case of third-person view, set the view matrix based on the camera's position and target.
-		gluLookAt(context.camera.camera_position[0], context.camera.camera_position[1],
-			context.camera.camera_position[2],context.camera.camera_target[0], context.camera.camera_target[1],
-			context.camera.camera_target[2], 0, 1, 0);
+		context.view.load(context.camera.ViewMatrix());
 	}
 
+	// Load the view matrix as the modelview matrix the scene is drawn with.
+	context.view.apply(GL_MODELVIEW);
+
+	// Let the objects pick their level of detail from their size in this view.
+	LevelOfDetail::beginFrame(context.view.top(), context.projection.top(), viewportHeight);
+
 	// Set the global ambient light intensity.
 	GLfloat globalAmbientVec[4] = { context.globalAmbient, context.globalAmbient, context.globalAmbient, 1.0 };
 	glLightModelfv(GL_LIGHT_MODEL_AMBIENT, globalAmbientVec);
 
+	// Place the lanterns and fireflies when the night scene is switched on, and move the fireflies.
+	if (context.night) {
+		if (context.lights.size() == 0)
+			context.nightLights.populate(context.lights, context.fence, context.lake);
+		context.nightLights.animate(context.lights, glutGet(GLUT_ELAPSED_TIME) / 1000.0f);
+	}
+	else {
+		context.lights.clear();
+	}
+
+	// Hand the matrices, the global ambient light, the clustered local lights and the spotlight's
+	// shadows to the shader-based renderer, if it is used.
+	if (CoreRenderer::active()) {
+		const bool shadows = context.shadows.enabled && ShadowMap::supported() && GLState::isEnabled(GL_LIGHT1);
+		static unsigned int shadowed_forest = context.forest.changes();
+		if (context.forest.changes() != shadowed_forest) {
+			shadowed_forest = context.forest.changes();
+			context.shadows.invalidate(); // The trees are static casters
+		}
+		if (shadows) {
+			context.shadows.update(context.spotlight, drawStaticCasters, drawDynamicCasters);
+		}
+		CoreRenderer::beginFrame(context.view.top(), context.projection.top(), context.globalAmbient);
+		CoreRenderer::shadow(shadows && context.shadows.ready() ? &context.shadows : nullptr);
+		context.lights.update(context.view.top(), context.projection.top(), viewportWidth, viewportHeight);
+		CoreRenderer::clusters(context.lights);
+	}
+	else {
+		context.lights.pack(context.view.top()); // Lit per object on the fixed-function path
+	}
+
 	// Draw the scene
 	drawScene();	
-	
 
-	// ImGui doesn't handle lighting well, so disable lighting, render ImGui's data, then re-enable lighting.
-	glDisable(GL_LIGHTING);
-	ImGui_ImplOpenGL2_RenderDrawData(ImGui::GetDrawData());
-	glEnable(GL_LIGHTING);
+	// Scale the scene up to the window, so the menu below is drawn at the window's full resolution.
+	context.resolution.end();
 
-	// Flush OpenGL's command buffer to make sure all commands get executed.
-	glFlush();
+	// Draw the menu from its vertex buffers, uploaded again only when it changed.
+	ImGuiRenderer::render(ImGui::GetDrawData());
+
+	// Fence this frame's uniform data in the stream buffer of the shader-based renderer.
+	CoreRenderer::endFrame();
+
+	// End the CPU and GPU times of the frame, before the swap can wait for the vertical blank.
+	context.framePacer.beforeSwap();
 
 	// Swap the front and back buffers, which displays the scene that we just rendered.
 	glutSwapBuffers();
 
-	// Post a redisplay event to trigger a new display callback.
-	glutPostRedisplay();
+	// Fence the frame, so the next one can wait until few enough frames are queued.
+	context.framePacer.endFrame();
+
+	// Publish this frame's count of forwarded and dropped state calls.
+	GLState::endFrame();
+
+	// Post a redisplay event to trigger a new display callback: at once, or on demand only while a
+	// widget is dragged, the cow walks or the scene changed, and at the idle tick rate otherwise. The
+	// point light's sweep is an ambient animation and goes at the idle tick rate.
+	context.redraw.endFrame(ImGui::IsAnyItemActive() || cowWalking);
 }
 
 /*
@@ -337,6 +531,54 @@ void display() {
 int main(int argc, char** argv) {
     // Initialize GLUT
     glutInit(&argc, argv);
+
+    // Read the command line options: --lod-bias <value> scales the level of detail of the whole scene,
+    // --renderer core draws it with the shader-based renderer instead of the fixed-function pipeline,
+    // --vsync off|on|adaptive, --max-frames-in-flight <n> and --fps-cap <fps> pace the display loop,
+    // --on-demand redraws the scene only when it changes, --dynamic-resolution <ms> scales the
+    // resolution of the scene to keep its GPU time within the given budget, --quality auto|low|medium|high|full
+    // lets the quality governor choose the detail of the scene or pins it to a preset, and
+    // --quality-target <ms> sets the frame time the governor aims for.
+    bool benchmarkForest = false;
+    for (int i = 1; i < argc; ++i) {
+        if (string(argv[i]) == "--benchmark-forest")
+            benchmarkForest = true;
+        else if (string(argv[i]) == "--lod-bias" && i + 1 < argc)
+            LevelOfDetail::bias = static_cast<float>(atof(argv[++i]));
+        else if (string(argv[i]) == "--renderer" && i + 1 < argc)
+            CoreRenderer::enabled = string(argv[++i]) == "core";
+        else if (string(argv[i]) == "--vsync" && i + 1 < argc) {
+            const string mode = argv[++i];
+            context.framePacer.vsync = mode == "off" ? FramePacer::VSyncOff : mode == "adaptive" ? FramePacer::VSyncAdaptive : FramePacer::VSyncOn;
+        }
+        else if (string(argv[i]) == "--max-frames-in-flight" && i + 1 < argc)
+            context.framePacer.maxFramesInFlight = atoi(argv[++i]);
+        else if (string(argv[i]) == "--fps-cap" && i + 1 < argc)
+            context.framePacer.frameRateCap = static_cast<float>(atof(argv[++i]));
+        else if (string(argv[i]) == "--on-demand")
+            context.redraw.onDemand = true;
+        else if (string(argv[i]) == "--quality" && i + 1 < argc) {
+            const string preset = argv[++i];
+            context.quality.pinned = QualityGovernor::find(preset);
+            if (context.quality.pinned < 0 && preset != "auto")
+                cout << "Unknown quality preset: " << preset << endl;
+        }
+        else if (string(argv[i]) == "--quality-target" && i + 1 < argc)
+            context.quality.targetMilliseconds = static_cast<float>(atof(argv[++i]));
+        else if (string(argv[i]) == "--dynamic-resolution" && i + 1 < argc) {
+            context.resolution.enabled = true;
+            context.resolution.budgetMilliseconds = static_cast<float>(atof(argv[++i]));
+        }
+        else
+            cout << "Unknown option: " << argv[i] << endl;
+    }
+
+    // The core renderer needs OpenGL 3.3. The compatibility profile is requested because the menu
+    // is still drawn by ImGui's OpenGL 2 backend.
+    if (CoreRenderer::enabled) {
+        glutInitContextVersion(3, 3);
+        glutInitContextProfile(GLUT_COMPATIBILITY_PROFILE);
+    }
     
     // Set the option for GLUT's behaviour when the window is closed. In this case, it's set to return from the main loop.
     glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
@@ -353,6 +595,15 @@ int main(int argc, char** argv) {
     // Create a window with a title.
     glutCreateWindow("Cow in the meadow - Maman17 - Project - 203439385");
 
+    // Load the OpenGL extensions (vertex buffer objects and later) now that a context exists.
+    GLenum glewStatus = glewInit();
+    if (glewStatus != GLEW_OK) {
+        cout << "Failed to initialize GLEW: " << glewGetErrorString(glewStatus) << endl;
+    }
+    if (CoreRenderer::enabled && !CoreRenderer::available()) {
+        cout << "OpenGL 3.3 is not available, falling back to the fixed-function renderer" << endl;
+    }
+
     // Set the function to call when GLUT needs to display (or re-display) the window.
     glutDisplayFunc(display);
 
@@ -370,13 +621,20 @@ int main(int argc, char** argv) {
     glutSpecialFunc(keyboard);
     glutKeyboardFunc(normalKeys);
 
+    // Replace ImGui's mouse and window handlers with ones that also mark the scene for redrawing.
+    glutMouseFunc(mouse);
+    glutMotionFunc(motion);
+    glutPassiveMotionFunc(motion);
+    glutMouseWheelFunc(mouseWheel);
+    glutReshapeFunc(reshape);
+
     // Set up OpenGL. This includes enabling smooth shading, lighting, and depth testing, and setting blending options.
     glShadeModel(GL_SMOOTH);
-    glEnable(GL_LIGHTING);
+    GLState::enable(GL_LIGHTING);
     glLightModeli(GL_LIGHT_MODEL_LOCAL_VIEWER, GL_TRUE);
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_NORMALIZE);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::enable(GL_DEPTH_TEST);
+    GLState::enable(GL_NORMALIZE);
+    GLState::blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     // Initialize a wheat field in the global context by creating a grid of Wheat objects.
 	Wheat::createField(context.wheatField);
@@ -388,14 +646,50 @@ int main(int argc, char** argv) {
     // Initialize the cow in the global context.
     context.cow.init();
 
+    // Bake the static objects of the scene into vertex buffers.
+    bakeStaticScene();
+
     // Create a forest with 3 trees.
     context.forest = Forest(3); 
 
+    // Render the views of the tree templates that distant trees are drawn with.
+    context.forest.bakeImpostors();
+
+    // Put the bounding boxes of the static objects into the culling quadtree.
+    context.culling.build(context);
+
+    // Redraw on demand when the camera, the lights, the cow or the scene settings change. The point
+    // light's x position sweeps every frame and is left out, like the tail's wiggle.
+    context.redraw.watch(context.camera.camera_position, sizeof(context.camera.camera_position));
+    context.redraw.watch(context.camera.camera_target, sizeof(context.camera.camera_target));
+    context.redraw.watch(context.pointlight.color, sizeof(context.pointlight.color));
+    context.redraw.watch(context.pointlight.position + 1, sizeof(context.pointlight.position) - sizeof(GLfloat));
+    context.redraw.watch(context.spotlight.position, sizeof(context.spotlight.position));
+    context.redraw.watch(context.spotlight.target, sizeof(context.spotlight.target));
+    context.redraw.watch(context.spotlight.color, sizeof(context.spotlight.color));
+    context.redraw.watch(&context.spotlight.cutoff, sizeof(context.spotlight.cutoff));
+    context.redraw.watch(&context.spotlight.exponent, sizeof(context.spotlight.exponent));
+    context.redraw.watch(&context.cow.local_coords, sizeof(context.cow.local_coords));
+    context.redraw.watch(&context.cow.head_horizontal_angle, sizeof(GLfloat));
+    context.redraw.watch(&context.cow.head_vertical_angle, sizeof(GLfloat));
+    context.redraw.watch(&context.cow.tail_horizontal_angle, sizeof(GLfloat));
+    context.redraw.watch(&context.cow.tail_vertical_angle, sizeof(GLfloat));
+    context.redraw.watch(&context.globalAmbient, sizeof(context.globalAmbient));
+    context.redraw.watch(&context.isCowView, sizeof(context.isCowView));
+    context.redraw.watch(&context.night, sizeof(context.night));
+
     // Set the GUI style to ImGui's dark style.
     ImGui::StyleColorsDark();
 
-    // Start the GLUT main loop. This will run until it's told to return (see the GLUT_ACTION_ON_WINDOW_CLOSE option set earlier).
-    glutMainLoop();
+    if (benchmarkForest) {
+        // Show the window, then time the forest from 3 to 100,000 trees instead of running interactively.
+        glutMainLoopEvent();
+        Benchmark::forest(context);
+    }
+    else {
+        // Start the GLUT main loop. This will run until it's told to return (see the GLUT_ACTION_ON_WINDOW_CLOSE option set earlier).
+        glutMainLoop();
+    }
 
     // Cleanup ImGui and GLUT after the main loop has exited.
     ImGui_ImplOpenGL2_Shutdown();